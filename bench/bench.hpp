@@ -0,0 +1,80 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <utility>
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+
+/**
+ * @struct bench_result_s
+ * @brief Result of a single benchmark run.
+ */
+struct bench_result_s {
+    std::string name;                                       ///< Benchmark name.
+    uint64_t operations;                                    ///< Number of operations (usually packets) processed.
+    std::chrono::nanoseconds elapsed;                       ///< Total time spent.
+    uint64_t allocations;                                   ///< Heap allocations made during the run.
+    std::vector<std::pair<std::string, double>> counters;   ///< Extra per operation metrics (name, value).
+};
+
+/**
+ * @brief Gets the number of heap allocations (operator new calls) made by the process so far, from every thread.
+ * - Counted by the replacement operator new of bench_alloc.cpp.
+ */
+uint64_t allocation_count();
+
+/**
+ * @brief Prints a benchmark result as a single line: name, ns per operation, allocations per operation and the extra counters.
+ * 
+ * @param result Result to be printed.
+ */
+inline void print_result(const bench_result_s& result)
+{
+    double ns_per_op = result.operations ? (double)result.elapsed.count() / result.operations : 0;
+    double allocs_per_op = result.operations ? (double)result.allocations / result.operations : 0;
+    std::cout << std::left << std::setw(48) << result.name
+              << std::right << std::setw(12) << std::fixed << std::setprecision(1) << ns_per_op << " ns/op"
+              << std::setw(10) << std::setprecision(2) << allocs_per_op << " allocs/op";
+    for (const auto& counter : result.counters)
+    {
+        std::cout << "  " << counter.first << "=" << std::setprecision(3) << counter.second;
+    }
+    std::cout << std::endl;
+}
+
+/**
+ * @brief Runs a function and measures how long it takes and how many heap allocations it makes.
+ * 
+ * @param function Function to be measured.
+ * @param allocations Set to the number of heap allocations made while the function ran.
+ * @return Elapsed time.
+ */
+template <typename F>
+std::chrono::nanoseconds measure(F function, uint64_t& allocations)
+{
+    uint64_t allocations_before = allocation_count();
+    auto start = std::chrono::steady_clock::now();
+    function();
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    allocations = allocation_count() - allocations_before;
+    return elapsed;
+}
+
+// Benchmark groups. Each one prints its own results.
+void bench_serial();
+void bench_pcap();
+void bench_hot_path();
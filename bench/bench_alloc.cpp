@@ -0,0 +1,74 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <cstdlib>
+#include <new>
+#include <atomic>
+
+#include "bench.hpp"
+
+/*
+ * Replacement global operator new/delete that count every heap allocation of the benchmark process,
+ * so each benchmark can report its allocations per packet.
+ */
+
+static std::atomic<uint64_t> allocations(0);
+
+uint64_t allocation_count()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    // malloc(0) may return null, which operator new must not
+    void* pointer = std::malloc(size ? size : 1);
+    if (pointer == nullptr) throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
@@ -0,0 +1,141 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <chrono>
+
+#include "bench.hpp"
+#include "frames.hpp"
+#include "common.hpp"
+#include "framer.hpp"
+#include "command_assembler.hpp"
+#include "payload_handler.hpp"
+#include "crypto_handler.hpp"
+
+/*
+ * Per packet benchmarks of the components every captured packet goes through:
+ * - Framer::process, fed one byte at a time as the serial path does.
+ * - CommandAssembler::convert_to_network_packet, which parses a frame into a packet_data.
+ * - PayloadHandler::getNwkLayer and CryptoHandler::extract_key, run on every packet when key extraction is enabled.
+ *   extract_key is measured on an ordinary secured NWK frame (rejected while parsing, the common case) and on a
+ *   Transport-Key frame (decrypted with the key-transport key).
+ * The pcap serialization (get_packet_header and get_packet_data) is measured by bench_pcap.
+ */
+
+static const int packets_per_run = 200000;
+// Decryption is much slower than parsing, so fewer packets are enough
+static const int crypto_packets_per_run = 5000;
+
+static bench_result_s run_framer(const std::string& name, const std::vector<uint8_t>& frame)
+{
+    uint64_t frames = 0;
+    uint64_t allocations = 0;
+    auto elapsed = measure([&]() {
+        Framer framer;
+        for (int i = 0; i < packets_per_run; i++)
+        {
+            for (uint8_t byte : frame)
+            {
+                FrameState state = framer.process(byte);
+                if (state == FrameState::S_SUCCESS) { frames++; framer.reset(); }
+                if (state == FrameState::S_ERROR) framer.recover();
+            }
+        }
+    }, allocations);
+    return {name, (uint64_t)packets_per_run, elapsed, allocations, {{"frames_ok", (double)frames / packets_per_run}}};
+}
+
+static bench_result_s run_convert(const std::string& name, const std::vector<uint8_t>& frame)
+{
+    CommandAssembler command_assembler;
+    uint64_t bytes = 0;
+    uint64_t allocations = 0;
+    auto elapsed = measure([&]() {
+        for (int i = 0; i < packets_per_run; i++)
+        {
+            packet_data data = command_assembler.convert_to_network_packet(frame.data(), frame.size(), std::chrono::microseconds(0));
+            bytes += data.data.size();
+        }
+    }, allocations);
+    return {name, (uint64_t)packets_per_run, elapsed, allocations, {{"payload_bytes", (double)bytes / packets_per_run}}};
+}
+
+static bench_result_s run_nwk_layer(const std::string& name, const std::vector<uint8_t>& payload)
+{
+    uint64_t found = 0;
+    uint64_t allocations = 0;
+    auto elapsed = measure([&]() {
+        for (int i = 0; i < packets_per_run; i++)
+        {
+            std::vector<uint8_t> nwk_layer;
+            if (PayloadHandler::getNwkLayer(payload, nwk_layer)) found++;
+        }
+    }, allocations);
+    return {name, (uint64_t)packets_per_run, elapsed, allocations, {{"found", (double)found / packets_per_run}}};
+}
+
+static bench_result_s run_extract_key(const std::string& name, const std::vector<uint8_t>& payload)
+{
+    CryptoHandler crypto;
+    crypto.security_level = 5;
+    uint64_t extracted = 0;
+    uint64_t allocations = 0;
+
+    // extract_key reports every key it finds, which would flood the results
+    std::ostringstream discarded;
+    std::streambuf* cout_buffer = std::cout.rdbuf(discarded.rdbuf());
+    auto elapsed = measure([&]() {
+        for (int i = 0; i < crypto_packets_per_run; i++)
+        {
+            if (crypto.extract_key(payload)) extracted++;
+            discarded.str("");
+        }
+    }, allocations);
+    std::cout.rdbuf(cout_buffer);
+
+    return {name, (uint64_t)crypto_packets_per_run, elapsed, allocations, {{"nwk_keys", (double)crypto.nwk_keys.size()}}};
+}
+
+// The Transport-Key frame must give its network key, otherwise the benchmark would only measure a failed decryption
+static bool transport_key_decrypts()
+{
+    const std::vector<uint8_t> expected = {0xD1, 0xF0, 0x4C, 0x8A, 0x3B, 0x6E, 0x29, 0x57, 0xC4, 0x0E, 0x1A, 0xA8, 0x5D, 0x73, 0x26, 0xBF};
+    CryptoHandler crypto;
+    crypto.security_level = 5;
+    std::ostringstream discarded;
+    std::streambuf* cout_buffer = std::cout.rdbuf(discarded.rdbuf());
+    bool extracted = crypto.extract_key(zigbee_transport_key_payload);
+    std::cout.rdbuf(cout_buffer);
+    return extracted && crypto.nwk_keys.size() == 1 && crypto.nwk_keys[0] == expected;
+}
+
+void bench_hot_path()
+{
+    std::vector<uint8_t> ble = make_ti_frame(ble_adv_payload, 123456789);
+    std::vector<uint8_t> zigbee = make_ti_frame(zigbee_data_payload, 123456789);
+
+    print_result(run_framer("framer/process_ble", ble));
+    print_result(run_framer("framer/process_zigbee", zigbee));
+    print_result(run_convert("command/convert_to_network_packet_ble", ble));
+    print_result(run_convert("command/convert_to_network_packet_zigbee", zigbee));
+    print_result(run_nwk_layer("payload/get_nwk_layer_zigbee", zigbee_data_payload));
+    print_result(run_nwk_layer("payload/get_nwk_layer_transport_key", zigbee_transport_key_payload));
+
+    if (!transport_key_decrypts())
+    {
+        std::cout << "[ERROR] crypto: the network key could not be extracted from the Transport-Key frame." << std::endl;
+    }
+    print_result(run_extract_key("crypto/extract_key_zigbee_data", zigbee_data_payload));
+    print_result(run_extract_key("crypto/extract_key_transport_key", zigbee_transport_key_payload));
+}
@@ -0,0 +1,23 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+
+#include "bench.hpp"
+
+int main()
+{
+    std::cout << "Tuxniffer benchmarks" << std::endl;
+    bench_serial();
+    bench_pcap();
+    bench_hot_path();
+    return 0;
+}
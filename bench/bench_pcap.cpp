@@ -0,0 +1,100 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstring>
+
+#include "bench.hpp"
+#include "frames.hpp"
+#include "common.hpp"
+#include "pcap_builder.hpp"
+#include "interface_registry.hpp"
+
+/*
+ * Pcap record serialization benchmark.
+ * Compares the two pass path (get_packet_header + get_packet_data, each parsing the frame and returning vectors)
+ * with PcapBuilder::write_record, which writes the same bytes into a caller buffer in a single pass.
+ */
+
+static const int records_per_run = 200000;
+
+static packet_queue_s make_packet(const std::vector<uint8_t>& payload, uint8_t mode, int channel)
+{
+    std::vector<uint8_t> frame = make_ti_frame(payload, 123456789);
+    packet_queue_s packet;
+    packet.id = 0;
+    InterfaceRegistry::intern("/dev/ttyACM0", mode, channel, packet.interface_id);
+    packet.channel = channel;
+    packet.mode = mode;
+    packet.timestamp = std::chrono::system_clock::now();
+    packet.set_packet(frame.data(), frame.size());
+    return packet;
+}
+
+static bench_result_s run_two_pass(const std::string& name, const packet_queue_s& packet, std::chrono::microseconds start_time)
+{
+    uint64_t bytes = 0;
+    uint64_t allocations = 0;
+    auto elapsed = measure([&]() {
+        for (int i = 0; i < records_per_run; i++)
+        {
+            std::vector<uint8_t> header = PcapBuilder::get_packet_header(packet, start_time);
+            std::vector<uint8_t> data = PcapBuilder::get_packet_data(packet);
+            bytes += header.size() + data.size();
+        }
+    }, allocations);
+    return {name, (uint64_t)records_per_run, elapsed, allocations, {{"bytes/record", (double)bytes / records_per_run}}};
+}
+
+static bench_result_s run_single_pass(const std::string& name, const packet_queue_s& packet, std::chrono::microseconds start_time)
+{
+    uint8_t buffer[PCAP_RECORD_MAX_SIZE];
+    uint64_t bytes = 0;
+    uint64_t allocations = 0;
+    auto elapsed = measure([&]() {
+        for (int i = 0; i < records_per_run; i++)
+        {
+            bytes += PcapBuilder::write_record(packet, start_time, buffer, sizeof(buffer));
+        }
+    }, allocations);
+    return {name, (uint64_t)records_per_run, elapsed, allocations, {{"bytes/record", (double)bytes / records_per_run}}};
+}
+
+static bool same_output(const packet_queue_s& packet, std::chrono::microseconds start_time)
+{
+    std::vector<uint8_t> expected = PcapBuilder::get_packet_header(packet, start_time);
+    std::vector<uint8_t> data = PcapBuilder::get_packet_data(packet);
+    expected.insert(expected.end(), data.begin(), data.end());
+
+    uint8_t buffer[PCAP_RECORD_MAX_SIZE];
+    size_t size = PcapBuilder::write_record(packet, start_time, buffer, sizeof(buffer));
+    return size == expected.size() && std::memcmp(buffer, expected.data(), size) == 0;
+}
+
+void bench_pcap()
+{
+    std::chrono::microseconds start_time(1735689600123456LL);
+    packet_queue_s ble = make_packet(ble_adv_payload, 21, 37);
+    packet_queue_s zigbee = make_packet(zigbee_data_payload, 20, 20);
+
+    if (!same_output(ble, start_time) || !same_output(zigbee, start_time))
+    {
+        std::cout << "[ERROR] pcap: write_record output differs from get_packet_header + get_packet_data." << std::endl;
+    }
+
+    print_result(run_two_pass("pcap/two_pass_ble", ble, start_time));
+    print_result(run_single_pass("pcap/write_record_ble", ble, start_time));
+    print_result(run_two_pass("pcap/two_pass_zigbee", zigbee, start_time));
+    print_result(run_single_pass("pcap/write_record_zigbee", zigbee, start_time));
+}
@@ -0,0 +1,131 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <cerrno>
+
+#include "bench.hpp"
+#include "frames.hpp"
+#include "device.hpp"
+#include "framer.hpp"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+/*
+ * Serial read path benchmark.
+ * A writer thread pushes TI frames into a pipe as fast as possible, emulating the dongle, while the reader
+ * frames them. The pipe read end replaces the serial descriptor, so the real Device::receive_response is used.
+ * The legacy reader reproduces the old byte by byte loop (one read() per byte) for comparison.
+ */
+
+#ifdef __linux__
+
+static const int frames_per_run = 20000;
+
+static std::thread start_writer(int fd, const std::vector<uint8_t>& frame)
+{
+    return std::thread([fd, frame]() {
+        std::vector<uint8_t> chunk;
+        // Write a few frames per call, similar to what a USB CDC endpoint delivers
+        for (int i = 0; i < 4; i++) chunk.insert(chunk.end(), frame.begin(), frame.end());
+        for (int sent = 0; sent < frames_per_run; sent += 4)
+        {
+            size_t offset = 0;
+            while (offset < chunk.size())
+            {
+                ssize_t n = write(fd, chunk.data() + offset, chunk.size() - offset);
+                if (n > 0) offset += n;
+            }
+        }
+    });
+}
+
+static bench_result_s run_legacy(const std::vector<uint8_t>& frame)
+{
+    int fds[2];
+    if (pipe(fds) != 0) return {"serial/legacy_per_byte", 0, std::chrono::nanoseconds(0), 0, {}};
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+    uint64_t syscalls = 0;
+    int frames = 0;
+    std::thread writer = start_writer(fds[1], frame);
+    uint64_t allocations = 0;
+    auto elapsed = measure([&]() {
+        Framer framer;
+        while (frames < frames_per_run)
+        {
+            uint8_t byte;
+            syscalls++;
+            if (read(fds[0], &byte, 1) != 1)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                continue;
+            }
+            FrameState state = framer.process(byte);
+            if (state == FrameState::S_SUCCESS) { frames++; framer.reset(); }
+            if (state == FrameState::S_ERROR) framer.recover();
+        }
+    }, allocations);
+    writer.join();
+    close(fds[0]);
+    close(fds[1]);
+
+    return {"serial/legacy_per_byte", (uint64_t)frames, elapsed, allocations, {{"syscalls/frame", (double)syscalls / frames}}};
+}
+
+static bench_result_s run_buffered(const std::vector<uint8_t>& frame)
+{
+    int fds[2];
+    if (pipe(fds) != 0) return {"serial/buffered_receive_response", 0, std::chrono::nanoseconds(0), 0, {}};
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+    std::mutex cout_mutex;
+    Device device(device_s{"bench", 20, 20, "", 1.0}, 0, cout_mutex);
+    device.serial.descriptor = fds[0];
+
+    int frames = 0;
+    std::thread writer = start_writer(fds[1], frame);
+    uint64_t allocations = 0;
+    auto elapsed = measure([&]() {
+        std::vector<uint8_t> response;
+        while (frames < frames_per_run && device.receive_response(response)) frames++;
+    }, allocations);
+    writer.join();
+    close(fds[0]);
+    close(fds[1]);
+    device.serial.descriptor = INVALID_FILE_DESCRIPTOR;
+
+    return {"serial/buffered_receive_response", (uint64_t)frames, elapsed, allocations,
+            {{"syscalls/frame", (double)device.serial.read_calls / frames}}};
+}
+
+void bench_serial()
+{
+    std::vector<uint8_t> frame = make_ti_frame(ble_adv_payload, 123456789);
+    print_result(run_legacy(frame));
+    print_result(run_buffered(frame));
+}
+
+#else
+
+void bench_serial()
+{
+    std::cout << "serial benchmarks are only available on Linux." << std::endl;
+}
+
+#endif
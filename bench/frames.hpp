@@ -0,0 +1,71 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * Frames used by the benchmarks. The payloads are synthetic frames shaped like real captures (same layout, sizes and fields):
+ * - A BLE ADV_IND advertising packet (radio mode 21), with the local name "Tuxniffer-Bench-01".
+ * - A Zigbee NWK data frame with security enabled (radio mode 20).
+ * - A Zigbee APS Transport-Key command delivering the network key to a joining device, secured with the key-transport
+ *   key derived from the default trust center link key (ZigBeeAlliance09), security level 5. It was built for a chosen network key.
+ * They are wrapped in the TI data stream framing that the sniffer firmware sends:
+ * [SOF 2B] [INFO 0xC0] [LEN 2B] [TIMESTAMP 6B] [0x00] [PAYLOAD N B] [RSSI 1B] [STATUS 1B] [EOF 2B]
+ */
+
+/// BLE ADV_IND payload (access address, header, advertiser address, AD structures and CRC).
+const std::vector<uint8_t> ble_adv_payload = {
+    0xD6, 0xBE, 0x89, 0x8E, 0x40, 0x25, 0x5A, 0x3C, 0x91, 0x7E, 0x22, 0xC4, 0x02, 0x01, 0x1A, 0x0A,
+    0xFF, 0x4C, 0x00, 0x10, 0x05, 0x0B, 0x1C, 0x7A, 0x21, 0x4E, 0x11, 0x09, 0x54, 0x75, 0x78, 0x6E,
+    0x69, 0x66, 0x66, 0x65, 0x72, 0x2D, 0x42, 0x65, 0x6E, 0x63, 0x68, 0x2D, 0x30, 0x31, 0x8A, 0x51, 0x3F
+};
+
+/// IEEE 802.15.4 MAC data frame carrying a secured Zigbee NWK frame.
+const std::vector<uint8_t> zigbee_data_payload = {
+    0x41, 0x88, 0x7A, 0x62, 0x1A, 0xFF, 0xFF, 0x00, 0x00, 0x09, 0x12, 0xFC, 0xFF, 0x00, 0x00, 0x01,
+    0xE4, 0x28, 0x3C, 0x7F, 0x01, 0x00, 0x52, 0x3A, 0x0B, 0xFE, 0xFF, 0x8E, 0x4C, 0x28, 0x00, 0x01,
+    0x53, 0xE2, 0x9B, 0x07, 0x7C, 0x1F, 0xA0, 0x8C, 0xD5, 0x11, 0x73, 0x5E, 0x2A, 0x90, 0x4B, 0xC1,
+    0x66, 0x0D, 0x38, 0x2F, 0xB9, 0x04, 0x71, 0xE6
+};
+
+/// IEEE 802.15.4 MAC data frame carrying an APS Transport-Key command (network key d1f04c8a3b6e2957c40e1aa85d7326bf).
+const std::vector<uint8_t> zigbee_transport_key_payload = {
+    0x41, 0x88, 0x5C, 0x62, 0x1A, 0x3B, 0x7A, 0x00, 0x00, 0x08, 0x00, 0x3B, 0x7A, 0x00, 0x00, 0x1E,
+    0x8F, 0x21, 0x4D, 0x30, 0xA3, 0x02, 0x00, 0x00, 0x28, 0x3C, 0x7F, 0x01, 0x00, 0x52, 0x3A, 0x0B,
+    0x68, 0x90, 0xDD, 0xF7, 0x23, 0x94, 0x52, 0x95, 0x2C, 0xC3, 0x0F, 0xB4, 0xEC, 0xFC, 0x83, 0x68,
+    0x5C, 0x17, 0x1E, 0x93, 0x5E, 0x1A, 0x28, 0xB1, 0x2B, 0x47, 0x82, 0xA7, 0x63, 0x8A, 0x8B, 0x0A,
+    0x15, 0x31, 0x3C, 0x49, 0x08, 0xAC, 0xBE, 0xC3, 0xA7
+};
+
+/**
+ * @brief Wraps a payload in the TI data stream framing.
+ * 
+ * @param payload Over the air payload.
+ * @param timestamp Device timestamp in microseconds (48 bits).
+ * @param rssi RSSI byte.
+ * @return Framed packet as received from the serial port.
+ */
+inline std::vector<uint8_t> make_ti_frame(const std::vector<uint8_t>& payload, uint64_t timestamp, uint8_t rssi = 0xC4)
+{
+    uint16_t length = payload.size() + 9;
+    std::vector<uint8_t> frame = {0x40, 0x53, 0xC0, (uint8_t)(length & 0xFF), (uint8_t)(length >> 8)};
+    for (int i = 0; i < 6; i++) frame.push_back((timestamp >> (8 * i)) & 0xFF);
+    frame.push_back(0x00);
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    frame.push_back(rssi);
+    frame.push_back(0x80); // Status: FCS ok
+    frame.push_back(0x40);
+    frame.push_back(0x45);
+    return frame;
+}
@@ -0,0 +1,124 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <signal.h>
+#include <sys/resource.h>
+
+#include "firmware_emulator.hpp"
+#include "common.hpp"
+
+static volatile int stop_requested = 0;
+
+static void emulator_signal_handler(int)
+{
+    stop_requested = 1;
+}
+
+void print_emulator_help()
+{
+    std::cout << "Usage: ./tuxniffer_emulator [options]" << std::endl;
+    std::cout << "Emulates a TI sniffer on a pseudo-terminal, to be opened by tuxniffer with -p <port>." << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  -h, --help          \tShow this help message and exit." << std::endl;
+    std::cout << "  -r, --rate          \tData frames per second while streaming (default 1000, 0 sends as fast as the host reads)." << std::endl;
+    std::cout << "  -s, --size          \tPayload bytes of each data frame (1 to " << FRAME_DATA_MAX_SIZE - 8 << ", default 56)." << std::endl;
+    std::cout << "  -b, --burst         \tData frames written per call (default 4)." << std::endl;
+    std::cout << "  -f, --fw_id         \tFirmware ID reported by the ping, in hexadecimal (default 21, LAUNCHXL-CC26X2R1)." << std::endl;
+    std::cout << "  -l, --link          \tCreate a symbolic link to the pseudo-terminal (e.g. /tmp/ttyEMU0)." << std::endl;
+    std::cout << "  -t, --time_duration \tSeconds to run. Runs until interrupted when missing." << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> args(argv, argv + argc);
+    emulator_config_s config;
+
+    try
+    {
+        for (size_t i = 1; i < args.size(); ++i) {
+            const std::string& arg = args[i];
+            bool has_value = i + 1 < args.size();
+            if (arg == "-h" || arg == "--help") {
+                print_emulator_help();
+                return 0;
+            }
+            else if ((arg == "-r" || arg == "--rate") && has_value) {
+                config.rate = std::stod(args[++i]);
+            }
+            else if ((arg == "-s" || arg == "--size") && has_value) {
+                config.payload_size = std::stoi(args[++i]);
+            }
+            else if ((arg == "-b" || arg == "--burst") && has_value) {
+                config.burst = std::stoi(args[++i]);
+            }
+            else if ((arg == "-f" || arg == "--fw_id") && has_value) {
+                config.fw_id = static_cast<uint8_t>(std::stoi(args[++i], nullptr, 16));
+            }
+            else if ((arg == "-l" || arg == "--link") && has_value) {
+                config.link = args[++i];
+            }
+            else if ((arg == "-t" || arg == "--time_duration") && has_value) {
+                config.duration = std::stoi(args[++i]);
+            }
+            else {
+                std::cout << "[ERROR] Invalid option " << arg << "." << std::endl;
+                print_emulator_help();
+                return 1;
+            }
+        }
+    }
+    catch (const std::exception&)
+    {
+        std::cout << "[ERROR] Invalid option value." << std::endl;
+        return 1;
+    }
+
+    // The sniffer framer only accepts frames that fit its payload buffer (payload, timestamp, RSSI and status)
+    if (config.payload_size < 1 || config.payload_size > FRAME_DATA_MAX_SIZE - 8 || config.burst < 1 || config.rate < 0) {
+        std::cout << "[ERROR] Invalid rate, size or burst." << std::endl;
+        return 1;
+    }
+
+    FirmwareEmulator emulator(config);
+    if (!emulator.open()) return 1;
+
+    signal(SIGINT, emulator_signal_handler);
+    signal(SIGTERM, emulator_signal_handler);
+    // Writes to a pseudo-terminal closed by the host must not kill the emulator
+    signal(SIGPIPE, SIG_IGN);
+
+    std::cout << "[INFO] Emulated sniffer on " << emulator.get_port();
+    if (!config.link.empty()) std::cout << " (" << config.link << ")";
+    std::cout << "." << std::endl;
+    std::cout << "[INFO] Device time 0 is " << emulator.get_time_base() << " us since epoch." << std::endl;
+    std::cout << std::flush;
+
+    emulator.run(stop_requested);
+    emulator.close();
+
+    const emulator_stats_s& stats = emulator.get_stats();
+    double seconds = std::chrono::duration<double>(stats.streaming).count();
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "[INFO] Commands received: " << stats.commands << "." << std::endl;
+    std::cout << "[INFO] Frames sent: " << stats.frames << " (" << (seconds > 0 ? stats.frames / seconds : 0) << " frames/s, "
+              << (seconds > 0 ? stats.bytes / seconds / 1e6 : 0) << " MB/s over " << std::setprecision(3) << seconds << " s streaming)." << std::endl;
+    std::cout << "[INFO] Frames dropped (host not reading): " << stats.dropped << "." << std::endl;
+    std::cout << "[INFO] Emulator CPU time: " << usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 << " s user, "
+              << usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6 << " s system." << std::endl;
+    return 0;
+}
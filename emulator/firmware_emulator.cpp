@@ -0,0 +1,293 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "firmware_emulator.hpp"
+#include "command_assembler.hpp"
+#include "frames.hpp"
+
+// Info byte of the command responses and of the data frames
+#define EMULATOR_INFO_RESPONSE 0x80
+#define EMULATOR_INFO_DATA 0xC0
+// Response status
+#define EMULATOR_STATUS_OK 0x00
+#define EMULATOR_STATUS_ERROR 0x01
+// Longest wait for the host, so the duration and interruptions are noticed quickly
+#define EMULATOR_POLL_SLICE std::chrono::milliseconds(100)
+
+FirmwareEmulator::FirmwareEmulator(const emulator_config_s& config)
+    : config(config)
+{
+    // The payload repeats a real Zigbee data frame up to the configured size
+    payload.resize(config.payload_size);
+    for (size_t i = 0; i < payload.size(); i++) payload[i] = zigbee_data_payload[i % zigbee_data_payload.size()];
+}
+
+FirmwareEmulator::~FirmwareEmulator()
+{
+    close();
+}
+
+bool FirmwareEmulator::open()
+{
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        std::cout << "[ERROR] Failed to open a pseudo-terminal." << std::endl;
+        close();
+        return false;
+    }
+    port = ptsname(master);
+
+    // Raw mode, so the bytes of the frames are not translated or echoed back
+    struct termios tty;
+    if (tcgetattr(master, &tty) == 0)
+    {
+        cfmakeraw(&tty);
+        tcsetattr(master, TCSANOW, &tty);
+    }
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    if (!config.link.empty())
+    {
+        // Only a previous link is replaced, never a regular file or device
+        struct stat info;
+        if (lstat(config.link.c_str(), &info) == 0 && S_ISLNK(info.st_mode)) unlink(config.link.c_str());
+        if (symlink(port.c_str(), config.link.c_str()) != 0)
+        {
+            std::cout << "[ERROR] Failed to create link " << config.link << " to " << port << "." << std::endl;
+            close();
+            return false;
+        }
+    }
+
+    opened = std::chrono::steady_clock::now();
+    time_base = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    return true;
+}
+
+void FirmwareEmulator::close()
+{
+    if (master >= 0) ::close(master);
+    master = -1;
+    if (!config.link.empty() && !port.empty()) unlink(config.link.c_str());
+    port.clear();
+}
+
+void FirmwareEmulator::run(const volatile int& stop_requested)
+{
+    auto end = config.duration < 0 ? std::chrono::steady_clock::time_point::max()
+                                   : std::chrono::steady_clock::now() + std::chrono::seconds(config.duration);
+    std::vector<uint8_t> chunk(4096);
+
+    while (!stop_requested && std::chrono::steady_clock::now() < end)
+    {
+        std::chrono::nanoseconds wait = EMULATOR_POLL_SLICE;
+        if (streaming) wait = std::min(wait, queue_frames());
+
+        struct pollfd descriptor = {master, POLLIN, 0};
+        if (output_offset < output.size()) descriptor.events |= POLLOUT;
+        struct timespec timeout = {static_cast<time_t>(wait.count() / 1000000000), static_cast<long>(wait.count() % 1000000000)};
+        int ready = ppoll(&descriptor, 1, &timeout, nullptr);
+        if (ready < 0 && errno != EINTR)
+        {
+            std::cout << "[ERROR] Failed to wait for the pseudo-terminal." << std::endl;
+            return;
+        }
+        if (ready <= 0) continue;
+
+        if (descriptor.revents & POLLIN)
+        {
+            ssize_t n = read(master, chunk.data(), chunk.size());
+            if (n > 0)
+            {
+                input.insert(input.end(), chunk.begin(), chunk.begin() + n);
+                handle_input();
+            }
+        }
+        // Nothing is connected to the slave side: wait for the host to open it
+        if (descriptor.revents & POLLHUP)
+        {
+            if (streaming) handle_command(info_stop, {});
+            output.clear();
+            output_offset = 0;
+            usleep(std::chrono::duration_cast<std::chrono::microseconds>(EMULATOR_POLL_SLICE).count());
+            continue;
+        }
+        if (!write_output()) return;
+    }
+    if (streaming) stats.streaming += std::chrono::steady_clock::now() - stream_start;
+}
+
+void FirmwareEmulator::handle_input()
+{
+    size_t position = 0;
+    while (true)
+    {
+        // Skip to the next start of frame
+        while (position + 1 < input.size() && !(input[position] == sof[0] && input[position + 1] == sof[1])) position++;
+        // SOF (2), INFO (1) and LENGTH (2)
+        if (position + 5 > input.size()) break;
+        uint16_t length = input[position + 3] | (input[position + 4] << 8);
+        // Data, FCS (1) and EOF (2)
+        size_t frame_size = 5 + length + 3;
+        if (position + frame_size > input.size()) break;
+
+        const uint8_t* frame = input.data() + position;
+        uint8_t fcs = 0;
+        for (size_t i = 2; i < 5u + length; i++) fcs += frame[i];
+        if (fcs != frame[5 + length] || frame[6 + length] != eof[0] || frame[7 + length] != eof[1])
+        {
+            // Not a command: resynchronize on the next byte
+            position++;
+            continue;
+        }
+        stats.commands++;
+        handle_command(frame[2], std::vector<uint8_t>(frame + 5, frame + 5 + length));
+        position += frame_size;
+    }
+    input.erase(input.begin(), input.begin() + position);
+}
+
+void FirmwareEmulator::handle_command(uint8_t info, const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> response = {EMULATOR_STATUS_OK};
+    auto now = std::chrono::steady_clock::now();
+    switch (info)
+    {
+        case info_ping:
+            // Chip ID (2), chip revision, firmware ID and firmware revision (2)
+            response.insert(response.end(), {0x26, 0x52, 0x10, config.fw_id, 0x01, 0x00});
+            std::cout << "[INFO] Ping (firmware ID 0x" << std::hex << (int)config.fw_id << std::dec << ")." << std::endl;
+            break;
+        case info_start:
+            if (!streaming)
+            {
+                streaming = true;
+                stream_start = now;
+                stream_frames = 0;
+            }
+            std::cout << "[INFO] Stream started (PHY 0x" << std::hex << (int)phy << std::dec << ", " << std::fixed << std::setprecision(3) << frequency << " MHz)." << std::endl;
+            break;
+        case info_stop:
+            if (streaming)
+            {
+                streaming = false;
+                stats.streaming += now - stream_start;
+                std::cout << "[INFO] Stream stopped (" << stats.frames << " frames sent, " << stats.dropped << " dropped)." << std::endl;
+            }
+            break;
+        case info_phy:
+            if (data.size() == 1) phy = data[0];
+            else response[0] = EMULATOR_STATUS_ERROR;
+            break;
+        case info_freq:
+            if (data.size() == 4) frequency = (data[0] | (data[1] << 8)) + (data[2] | (data[3] << 8)) / 65536.0f;
+            else response[0] = EMULATOR_STATUS_ERROR;
+            break;
+        default:
+            std::cout << "[WARNING] Unknown command 0x" << std::hex << (int)info << std::dec << "." << std::endl;
+            response[0] = EMULATOR_STATUS_ERROR;
+            break;
+    }
+    CommandAssembler cmd;
+    std::vector<uint8_t> frame = cmd.assemble_command(EMULATOR_INFO_RESPONSE, response);
+    // Responses are never dropped
+    output.insert(output.end(), frame.begin(), frame.end());
+}
+
+std::chrono::nanoseconds FirmwareEmulator::queue_frames()
+{
+    auto now = std::chrono::steady_clock::now();
+    size_t frame_size = payload.size() + 16;
+    uint64_t due;
+    if (config.rate > 0)
+    {
+        double elapsed = std::chrono::duration<double>(now - stream_start).count();
+        // Frames are sent in whole bursts
+        due = static_cast<uint64_t>(elapsed * config.rate / config.burst) * config.burst;
+    }
+    else
+    {
+        // As fast as the host reads: fill the output up to the limit
+        size_t pending = output.size() - output_offset;
+        due = stream_frames;
+        if (pending < config.output_limit) due += (config.output_limit - pending) / frame_size;
+    }
+
+    uint64_t device_time = std::chrono::duration_cast<std::chrono::microseconds>(now - opened).count();
+    uint64_t stream_time = std::chrono::duration_cast<std::chrono::microseconds>(stream_start - opened).count();
+    uint16_t length = static_cast<uint16_t>(payload.size() + 9);
+    for (; stream_frames < due; stream_frames++)
+    {
+        if (output.size() - output_offset + frame_size > config.output_limit)
+        {
+            stats.dropped++;
+            continue;
+        }
+        // The MAC sequence number counts the frames, so losses can be spotted downstream
+        if (payload.size() > 2) payload[2] = static_cast<uint8_t>(stream_frames);
+        // Paced frames are stamped with the time they were due, like packets spread over the air
+        if (config.rate > 0) device_time = stream_time + static_cast<uint64_t>(stream_frames * 1000000 / config.rate);
+        output.insert(output.end(), {sof[0], sof[1], EMULATOR_INFO_DATA, static_cast<uint8_t>(length & 0xFF), static_cast<uint8_t>(length >> 8)});
+        for (int i = 0; i < 6; i++) output.push_back((device_time >> (i * 8)) & 0xFF);
+        output.push_back(0x00);
+        output.insert(output.end(), payload.begin(), payload.end());
+        output.insert(output.end(), {0xC4, 0x80, eof[0], eof[1]});
+        stats.frames++;
+        stats.bytes += frame_size;
+    }
+
+    if (config.rate <= 0) return EMULATOR_POLL_SLICE;
+    auto next = stream_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>((due + config.burst) / config.rate));
+    return std::max(std::chrono::nanoseconds(0), std::chrono::duration_cast<std::chrono::nanoseconds>(next - now));
+}
+
+bool FirmwareEmulator::write_output()
+{
+    while (output_offset < output.size())
+    {
+        ssize_t n = write(master, output.data() + output_offset, output.size() - output_offset);
+        if (n > 0)
+        {
+            output_offset += n;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) break;
+        if (n < 0 && errno == EIO) break;
+        std::cout << "[ERROR] Failed to write to the pseudo-terminal." << std::endl;
+        return false;
+    }
+    // Reuse the buffer once everything was written, or drop the written part when it gets large
+    if (output_offset == output.size())
+    {
+        output.clear();
+        output_offset = 0;
+    }
+    else if (output_offset >= config.output_limit)
+    {
+        output.erase(output.begin(), output.begin() + output_offset);
+        output_offset = 0;
+    }
+    return true;
+}
@@ -0,0 +1,146 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * @struct emulator_config_s
+ * @brief Settings of the firmware emulator.
+ */
+struct emulator_config_s {
+    double rate = 1000;             ///< Data frames sent per second while streaming (0 sends as fast as the host reads).
+    int payload_size = 56;          ///< Bytes of the payload of each data frame.
+    int burst = 4;                  ///< Data frames written per call, similar to what a USB CDC endpoint delivers.
+    uint8_t fw_id = 0x21;           ///< Firmware ID reported by the ping (see fw_table).
+    std::string link;               ///< Symbolic link created to the pseudo-terminal (empty for none).
+    int duration = -1;              ///< Seconds to run (-1 runs until interrupted).
+    size_t output_limit = 65536;    ///< Bytes the host may leave unread before data frames are dropped.
+};
+
+/**
+ * @struct emulator_stats_s
+ * @brief Counters of an emulator run.
+ */
+struct emulator_stats_s {
+    uint64_t commands = 0;          ///< Commands received from the host.
+    uint64_t frames = 0;            ///< Data frames written to the pseudo-terminal.
+    uint64_t dropped = 0;           ///< Data frames dropped because the host was not reading.
+    uint64_t bytes = 0;             ///< Bytes of data frames written.
+    std::chrono::nanoseconds streaming{0}; ///< Time spent streaming.
+};
+
+/**
+ * @class FirmwareEmulator
+ * @brief Emulates the TI packet sniffer firmware on a pseudo-terminal (Linux only).
+ * - Answers the ping, stop, start, set PHY and set frequency commands built by CommandAssembler.
+ * - While started, streams synthetic data frames at the configured rate and payload size.
+ * - The device timestamp of the frames counts microseconds since the emulator was opened.
+ * - Like the real firmware, frames are dropped when the host does not read them in time.
+ */
+class FirmwareEmulator
+{
+public:
+    /**
+     * @brief Constructs a new FirmwareEmulator object.
+     * 
+     * @param config Emulator settings.
+     */
+    explicit FirmwareEmulator(const emulator_config_s& config);
+
+    /**
+     * @brief Closes the pseudo-terminal and removes the link.
+     */
+    ~FirmwareEmulator();
+
+    /**
+     * @brief Opens the pseudo-terminal and creates the link to it.
+     * 
+     * @return true if the pseudo-terminal was opened, false otherwise.
+     */
+    bool open();
+
+    /**
+     * @brief Serves the host until the duration is over or stop_requested is set.
+     * 
+     * @param stop_requested Flag checked between events (set by a signal handler).
+     */
+    void run(const volatile int& stop_requested);
+
+    /**
+     * @brief Closes the pseudo-terminal and removes the link.
+     */
+    void close();
+
+    /**
+     * @brief Gets the path of the pseudo-terminal the host must open.
+     */
+    const std::string& get_port() const { return port; }
+
+    /**
+     * @brief Gets the counters of the run.
+     */
+    const emulator_stats_s& get_stats() const { return stats; }
+
+    /**
+     * @brief Gets the system time (microseconds since epoch) of device timestamp 0.
+     */
+    int64_t get_time_base() const { return time_base; }
+
+private:
+    emulator_config_s config;                       ///< Emulator settings.
+    emulator_stats_s stats;                         ///< Counters of the run.
+    int master = -1;                                ///< Master side of the pseudo-terminal.
+    std::string port;                               ///< Path of the slave side of the pseudo-terminal.
+    bool streaming = false;                         ///< Indicates that the host sent the start command.
+    uint8_t phy = 0;                                ///< PHY set by the host.
+    float frequency = 0;                            ///< Frequency (MHz) set by the host.
+    std::vector<uint8_t> input;                     ///< Bytes received from the host and not parsed yet.
+    std::vector<uint8_t> output;                    ///< Bytes not written to the pseudo-terminal yet.
+    size_t output_offset = 0;                       ///< Bytes of output already written.
+    std::vector<uint8_t> payload;                   ///< Payload of the data frames.
+    std::chrono::steady_clock::time_point opened;   ///< When the pseudo-terminal was opened (device time 0).
+    int64_t time_base = 0;                          ///< System time of device time 0, in microseconds since epoch.
+    std::chrono::steady_clock::time_point stream_start; ///< When the host started the stream.
+    uint64_t stream_frames = 0;                     ///< Data frames due since the stream started (sent or dropped).
+
+    /**
+     * @brief Parses the commands received from the host and queues their responses.
+     */
+    void handle_input();
+
+    /**
+     * @brief Answers a command.
+     * 
+     * @param info Command info byte.
+     * @param data Command data.
+     */
+    void handle_command(uint8_t info, const std::vector<uint8_t>& data);
+
+    /**
+     * @brief Queues the data frames that are due, or drops them if the host is not reading.
+     * 
+     * @return Time until the next burst is due.
+     */
+    std::chrono::nanoseconds queue_frames();
+
+    /**
+     * @brief Writes as much queued output as the pseudo-terminal accepts.
+     * 
+     * @return false if the pseudo-terminal failed, true otherwise.
+     */
+    bool write_output();
+};
@@ -0,0 +1,117 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "pcap_builder.hpp"
+
+// Identifies an index file and the version of its layout
+#define CAPTURE_INDEX_MAGIC "TUXINDEX"
+#define CAPTURE_INDEX_VERSION 2
+// Appended to the path of a log file to get the path of its index
+#define CAPTURE_INDEX_EXTENSION ".idx"
+// Packets may be written slightly out of capture order (e.g. devices outside the merge window), so the range read is widened by this margin
+#define CAPTURE_INDEX_SLACK_US 1000000
+// Longest pcapng block copied by extract (tuxniffer writes blocks of a few hundred bytes)
+#define CAPTURE_BLOCK_MAX_SIZE 65536
+
+/**
+ * @struct capture_index_header_s
+ * @brief Header at the start of an index file.
+ */
+struct capture_index_header_s {
+    char magic[8];              ///< CAPTURE_INDEX_MAGIC.
+    uint32_t version;           ///< CAPTURE_INDEX_VERSION.
+    uint32_t format;            ///< Format of the log file (0 for pcap, 1 for pcapng).
+    uint64_t data_offset;       ///< Offset of the first record in the log file (after the pcap global header or the pcapng header blocks).
+};
+
+/**
+ * @struct capture_index_entry_s
+ * @brief Position of a packet in a log file.
+ * - The entries are written every few packets or milliseconds, in file order.
+ */
+struct capture_index_entry_s {
+    int64_t timestamp;          ///< Capture time of the record (UTC microseconds, the time zone of the pcap files is removed).
+    uint64_t device_time;       ///< Timestamp from the device (microseconds).
+    uint64_t offset;            ///< Offset of the record in the log file.
+    uint16_t device_id;         ///< Device that captured the packet.
+    uint8_t channel;            ///< Channel of the packet.
+    uint8_t reserved[5];        ///< Always 0.
+};
+
+static_assert(sizeof(capture_index_header_s) == 24, "capture_index_header_s must have no padding");
+static_assert(sizeof(capture_index_entry_s) == 32, "capture_index_entry_s must have no padding");
+
+/**
+ * @class CaptureIndex
+ * @brief Sidecar index of a log file ([log file].idx), used to copy a time range out of a long capture without reading all of it.
+ */
+class CaptureIndex
+{
+public:
+    /**
+     * @brief Creates an index file and writes its header.
+     * 
+     * @param path Path of the index file.
+     * @param format Format of the log file.
+     * @param data_offset Offset of the first record in the log file.
+     * @return FILE* The index file, or nullptr if it could not be created.
+     */
+    static FILE* create(const std::string& path, CaptureFormat format, uint64_t data_offset);
+
+    /**
+     * @brief Adds an entry to an index file (buffered by stdio).
+     * 
+     * @param file Index file.
+     * @param entry Entry to add.
+     */
+    static void add(FILE* file, const capture_index_entry_s& entry) { fwrite(&entry, sizeof(entry), 1, file); }
+
+    /**
+     * @brief Reads an index file.
+     * - An entry cut short (the capture was interrupted) is ignored.
+     * 
+     * @param path Path of the index file.
+     * @param header Set to the header of the file.
+     * @param entries Set to the entries of the file.
+     * @return true if the file is a valid index, false otherwise.
+     */
+    static bool load(const std::string& path, capture_index_header_s& header, std::vector<capture_index_entry_s>& entries);
+
+    /**
+     * @brief Parses a time as written in the records of a log file: seconds since epoch (with an optional fraction) or YYYY-MM-DD HH:MM:SS[.ffffff].
+     * 
+     * @param text Time to parse.
+     * @param timestamp Set to the time in microseconds.
+     * @return true if the time is valid, false otherwise.
+     */
+    static bool parse_time(const std::string& text, int64_t& timestamp);
+
+    /**
+     * @brief Copies the packets of a time range of a log file to a new file, with the same header.
+     * - Reads only from the last index entry before the range to the first entry after it. Without an index the whole file is read.
+     * - The range is in UTC for both formats: the time zone that tuxniffer applies to the pcap records (TIMEZONE) is removed before comparing.
+     * - A record longer than the snaplen of a pcap file, or than CAPTURE_BLOCK_MAX_SIZE in a pcapng file, stops the copy as an error.
+     * 
+     * @param capture_path Path of the log file (pcap or pcapng written by tuxniffer).
+     * @param from Start of the range, inclusive (UTC microseconds).
+     * @param to End of the range, inclusive.
+     * @param output_path Path of the file to be created.
+     * @return int64_t Number of packets copied, or -1 on error.
+     */
+    static int64_t extract(const std::string& capture_path, int64_t from, int64_t to, const std::string& output_path);
+};
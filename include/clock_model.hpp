@@ -0,0 +1,99 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Device time (microseconds) covered by each point of the fit. The least delayed sample of the interval is used
+#define CLOCK_MODEL_INTERVAL_US 1000000
+// Weight kept by the previous points each time a point is added (about 15 minutes of memory with 1 s intervals)
+#define CLOCK_MODEL_FORGETTING 0.999
+
+/**
+ * @class ClockModel
+ * @brief Maps the free-running microsecond counter of a device to the system clock.
+ * - Fitted online from (device time, system time) pairs, the system time being taken when the device thread received the packet.
+ * - The reception delay is always positive, so each interval of CLOCK_MODEL_INTERVAL_US only keeps its smallest offset (system - device).
+ * - The offset of those points is fitted as a line of the device time (exponentially weighted least squares): the slope is the drift of the device clock.
+ * - A device time lower than the previous one means the counter restarted (the firmware was reset), so the model starts over.
+ * - It is not thread safe.
+ */
+class ClockModel
+{
+public:
+    /**
+     * @brief Adds a (device time, system time) pair to the model.
+     * - The model is reset first when the device time went backward.
+     * 
+     * @param device_time Device timestamp (microseconds).
+     * @param system_time System time when the packet was received (microseconds since epoch).
+     */
+    void add_sample(int64_t device_time, int64_t system_time);
+
+    /**
+     * @brief Removes every sample and point, so the next sample starts a new model.
+     */
+    void reset() { *this = ClockModel(); }
+
+    /**
+     * @brief Gets the offset (system - device, microseconds) to be added to a device timestamp. The model must not be empty.
+     * 
+     * @param device_time Device timestamp (microseconds).
+     * @return int64_t Offset in microseconds.
+     */
+    int64_t offset_at(int64_t device_time) const;
+
+    /**
+     * @brief Gets the offset (microseconds) at the device time of the last sample. The model must not be empty.
+     */
+    int64_t current_offset() const { return offset_at(last_device); }
+
+    /**
+     * @brief Gets the estimated drift of the device clock against the system clock, in parts per million (positive when the device clock is slow).
+     */
+    double drift_ppm() const { return fitted ? slope : 0.0; }
+
+    /**
+     * @brief Checks if no sample was added yet.
+     */
+    bool empty() const { return samples == 0; }
+
+    /**
+     * @brief Gets the number of samples added.
+     */
+    uint64_t sample_count() const { return samples; }
+
+private:
+    uint64_t samples = 0;               ///< Number of samples added.
+    int64_t last_device = 0;            ///< Device time of the last sample.
+    int64_t origin_device = 0;          ///< Device time of the first sample (the fit is centered on it to keep the precision).
+    int64_t origin_offset = 0;          ///< Offset of the first sample.
+    int64_t interval_start = 0;         ///< Device time where the current interval started.
+    int64_t interval_offset = 0;        ///< Smallest offset of the current interval.
+    int64_t interval_device = 0;        ///< Device time of the smallest offset of the current interval.
+    bool fitted = false;                ///< Indicates that the line was fitted (at least two points).
+    double slope = 0.0;                 ///< Fitted offset change in microseconds per second of device time (ppm).
+    double intercept = 0.0;             ///< Fitted offset at the origin (relative to origin_offset).
+    double sum_w = 0.0;                 ///< Sum of the weights.
+    double sum_x = 0.0;                 ///< Weighted sum of the device times (seconds since the origin).
+    double sum_y = 0.0;                 ///< Weighted sum of the offsets (microseconds relative to origin_offset).
+    double sum_xx = 0.0;                ///< Weighted sum of the squared device times.
+    double sum_xy = 0.0;                ///< Weighted sum of the device times times the offsets.
+    uint64_t points = 0;                ///< Number of points in the fit.
+
+    /**
+     * @brief Adds the point of a finished interval to the fit.
+     */
+    void add_point(int64_t device_time, int64_t offset);
+};
@@ -346,7 +346,7 @@ public:
      * @param response Response to be verified.
      * @return true if the response is valid, false otherwise.
      */
-    bool verify_response(std::vector<uint8_t> response);
+    bool verify_response(const std::vector<uint8_t>& response);
 
     /**
      * @brief Disassembles a ping response.
@@ -360,26 +360,29 @@ public:
      * @brief Converts data to a network packet.
      * 
      * @param data Data to be converted.
+     * @param size Size of the data in bytes.
      * @param system_timestamp System timestamp.
      * @return Converted network packet.
      */
-    packet_data convert_to_network_packet(std::vector<uint8_t> data, std::chrono::microseconds system_timestamp);
+    packet_data convert_to_network_packet(const uint8_t* data, size_t size, std::chrono::microseconds system_timestamp);
 
     /**
      * @brief Get the payload of the network packet from a packet queue entry.
+     * - The payload vector is overwritten, so a vector reused between calls does not allocate memory again.
      * 
      * @param packet Queue entry from the packet.
-     * @return Payload from network packet.
+     * @param payload Payload from network packet.
      */
-    std::vector<uint8_t> get_payload(packet_queue_s packet);
+    void get_payload(const packet_queue_s& packet, std::vector<uint8_t>& payload);
 
     /**
      * @brief Gets the device timestamp from data.
      * 
      * @param data Data containing the timestamp.
+     * @param size Size of the data in bytes.
      * @return Device timestamp.
      */
-    std::chrono::microseconds get_device_timestamp(std::vector<uint8_t> data);
+    std::chrono::microseconds get_device_timestamp(const uint8_t* data, size_t size);
 
     /**
      * @brief Calculates the final frequency.
@@ -391,6 +394,18 @@ public:
      */
     float calculateFinalFreq(uint8_t mode, float freq, int channel);
 
+    /**
+     * @brief Calculates the final frequency, without exiting on an invalid channel.
+     * 
+     * @param mode Radio Mode value.
+     * @param freq Frequency value.
+     * @param channel Channel number.
+     * @param finalFreqOut Calculated final frequency.
+     * @return true if the channel is valid for the Radio Mode.
+     * @return false otherwise.
+     */
+    bool tryCalculateFinalFreq(uint8_t mode, float freq, int channel, float* finalFreqOut);
+
     /**
      * @brief Converts frequency to byte format in little endian format.
      * 
@@ -399,6 +414,14 @@ public:
      */
     std::vector<uint8_t> convertFreqToByte(float freq);
 
+    /**
+     * @brief Converts frequency to byte format in little endian format, writing it to a buffer.
+     * 
+     * @param freq Frequency value.
+     * @param freq_bytes Buffer where the 4 frequency bytes are written.
+     */
+    void convertFreqToByte(float freq, uint8_t* freq_bytes);
+
     /**
      * @brief Gets the PHY TI value for a radio mode.
      * 
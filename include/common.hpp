@@ -17,6 +17,8 @@
 #include <iostream>
 #include <vector>
 #include <chrono>
+#include <cstdint>
+#include <cstring>
 
 #ifdef DEBUG 
 #define D(x) x
@@ -32,6 +34,11 @@
 
 #define NO_IMPL {D(std::cout << "[ERROR] Function not implemented" << std::endl;)}
 
+// Largest DATA field accepted by the framer (TIMESTAMP, separator, payload and RSSI for packet frames)
+#define FRAME_DATA_MAX_SIZE 256
+// Largest frame: SOF(2) + INFO(1) + LENGTH(2) + DATA + FCS/STATUS(1) + EOF(2)
+#define FRAME_MAX_SIZE (FRAME_DATA_MAX_SIZE + 8)
+
 /**
  * @struct packet_data
  * @brief Represents the data of a packet.
@@ -52,14 +59,32 @@ struct packet_data
  * @struct packet_queue_s
  * @brief Represents a packet in the queue.
  * It's used to pass data around the application between the device, the output_manager and the pipe_packet_handler
+ * - Has a fixed size (the frame is stored inline and the interface name is interned), so queuing a packet never allocates memory.
  */
 struct packet_queue_s {
     int id;                                             ///< Packet ID.
-    std::string serial_interface;                              ///< Interface name.
+    uint16_t interface_id;                              ///< Interface ID (see InterfaceRegistry).
     int channel;                                        ///< Channel number.
     uint8_t mode;                                       ///< Mode of the packet.
-    std::vector<uint8_t> packet;                        ///< Packet data.
+    uint16_t length;                                    ///< Number of bytes used in packet.
+    uint8_t packet[FRAME_MAX_SIZE];                     ///< Packet data (complete frame received from the device).
     std::chrono::time_point<std::chrono::system_clock> timestamp; ///< Timestamp when the packet was queued.
+    int64_t clock_offset;                               ///< Microseconds added to the device timestamp to get the capture time in UTC (set by the output manager).
+
+    /**
+     * @brief Copies a frame into the packet.
+     * 
+     * @param frame Frame data.
+     * @param size Frame size in bytes.
+     * @return true if the frame was copied, false if it is larger than FRAME_MAX_SIZE.
+     */
+    bool set_packet(const uint8_t* frame, size_t size)
+    {
+        if (size > FRAME_MAX_SIZE) return false;
+        std::memcpy(packet, frame, size);
+        length = static_cast<uint16_t>(size);
+        return true;
+    }
 };
 
 /**
@@ -71,8 +96,53 @@ struct device_s {
     std::string port;                                   ///< Device port.
     int radio_mode;                                     ///< Radio mode.
     int channel;                                        ///< Channel number.
+    std::string replay;                                 ///< Capture file replayed instead of a serial port (empty for a real device).
+    double replay_speed = 1.0;                          ///< Replay speed relative to the capture (0 to replay as fast as possible).
+};
+
+/**
+ * @enum QueuePolicy
+ * @brief What to do with a packet when an output queue reached its byte budget.
+ */
+enum class QueuePolicy
+{
+    DROP_OLDEST,   ///< Discard the oldest queued packet to make room for the new one.
+    DROP_NEWEST,   ///< Discard the new packet.
+    BLOCK,         ///< Make the producer wait until there is room.
+    SPILL,         ///< Write the new packet to a file on disk, to be sent after the queued ones.
+};
+
+/**
+ * @brief Parses the name of a queue policy (drop-oldest | drop-newest | block | spill).
+ * 
+ * @param name Name of the policy.
+ * @param policy Set to the parsed policy.
+ * @return true if the name is valid, false otherwise.
+ */
+bool parse_queue_policy(const std::string& name, QueuePolicy& policy);
+
+/**
+ * @enum ResetPeriod
+ * @brief How often the log files are recreated.
+ */
+enum class ResetPeriod
+{
+    NONE,       ///< The log files are never recreated.
+    HOURLY,     ///< Every hour.
+    DAILY,      ///< Every 24 hours.
+    WEEKLY,     ///< Every 7 days.
+    MONTHLY,    ///< Every 30 days.
 };
 
+/**
+ * @brief Parses the name of a reset period (none | hourly | daily | weekly | monthly).
+ * 
+ * @param name Name of the period.
+ * @param period Set to the parsed period.
+ * @return true if the name is valid, false otherwise.
+ */
+bool parse_reset_period(const std::string& name, ResetPeriod& period);
+
 /**
  * @struct log_entry_s
  * @brief Represents a log entry configuration.
@@ -84,6 +154,42 @@ struct log_entry_s {
     std::string base_name;                              ///< Base name for the log files.
     bool split_devices_log;                             ///< Indicates if log files should be split by device.
     std::string reset_period;                           ///< Log reset period.
+    std::string format;                                 ///< Capture file format (pcap | pcapng).
+    int queue_size_kb;                                  ///< Memory budget (KiB) of the packets queued for the output.
+    std::string queue_policy;                           ///< Policy when the queue budget is reached (drop-oldest | drop-newest | block | spill).
+    int spill_size_mb;                                  ///< Maximum size (MiB) of the spill file of the output.
+    bool spill_recover;                                 ///< Keep the spilled packets not sent for the next run (otherwise the spill file is removed).
+    int rotate_size_mb;                                 ///< Size (MiB) of a log file that starts a new one (0 to disable).
+    int rotate_packets;                                 ///< Number of packets in a log file that starts a new one (0 to disable).
+    int max_files;                                      ///< Number of log files (or sets of files, when split) kept when they rotate (0 to keep all).
+    bool index;                                         ///< Indicates if each log file gets a sidecar index ([log file].idx).
+    int index_packets;                                  ///< Maximum number of packets between two index entries.
+    int index_interval_ms;                              ///< Maximum time (ms) between two index entries.
+};
+
+/**
+ * @struct stream_entry_s
+ * @brief Represents the configuration of a streaming server (its clients get the pcap stream).
+ */
+struct stream_entry_s {
+    bool enabled;                                       ///< Indicates if the server is enabled.
+    std::string address;                                ///< Address the server listens on (socket path, or host:port for TCP with IPv6 hosts in brackets).
+    int buffer_size_kb;                                 ///< Size (KiB) of the buffer shared by the clients.
+    std::string slow_client;                            ///< What to do with a client that lags behind the buffer (skip | drop).
+    int client_queue_kb;                                ///< Maximum data (KiB) waiting to be sent to a client before it is slow (0 is the buffer size).
+    bool no_delay;                                      ///< Disable Nagle's algorithm on the client connections (TCP).
+    int batch_size_kb;                                  ///< Data (KiB) waiting for a client before it is sent (0 sends immediately).
+    int batch_delay_ms;                                 ///< Maximum time data waits for a batch.
+};
+
+/**
+ * @struct shm_entry_s
+ * @brief Represents the configuration of the shared memory ring (its readers map it and read the packets in place).
+ */
+struct shm_entry_s {
+    bool enabled;                                       ///< Indicates if the ring is enabled.
+    std::string name;                                   ///< Name of the shared memory (starts with '/').
+    int buffer_size_kb;                                 ///< Size (KiB) of the ring.
 };
 
 struct crypto_entry_s {
@@ -101,12 +207,17 @@ struct crypto_entry_s {
 /**
  * @struct log_s
  * @brief Represents the logging configuration.
- * It's only job is to hold the log entry configurations for the file and pipe logs.
+ * It's only job is to hold the log entry configurations for the file and pipe logs, and the settings shared by them.
  */
 struct log_s {
     log_entry_s file;                                   ///< File log entry configuration.
     log_entry_s pipe;                                   ///< Pipe log entry configuration.
     crypto_entry_s crypto;                              ///< Crypto log entry configuration.
+    int merge_window;                                   ///< Milliseconds a packet waits for the other devices to be written in capture order (0 disables).
+    int dedup_window;                                   ///< Microseconds between copies of a frame captured by different devices to be discarded as duplicates (0 disables).
+    stream_entry_s socket;                              ///< Unix domain socket streaming server configuration.
+    shm_entry_s shm;                                    ///< Shared memory ring configuration.
+    stream_entry_s tcp;                                 ///< TCP streaming server configuration.
 };
 
 char* custom_strerror(int n_error);
\ No newline at end of file
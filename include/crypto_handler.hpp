@@ -158,7 +158,7 @@ public:
      * @param payload Byte vector with Mac Layer payload data.
      * @return Boolean value with the validation result.
      */
-    bool extract_key(std::vector<uint8_t> payload); 
+    bool extract_key(const std::vector<uint8_t>& payload); 
 
     /**
      * @brief Tranforms a byte vector in a hex string.
@@ -13,11 +13,26 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 
 #include "command_assembler.hpp"
+#include "framer.hpp"
 #include "serial.hpp"
 #include "common.hpp"
 #include "output_manager.hpp"
+#include "replay_source.hpp"
+
+/**
+ * @brief Set to 1 when SIGINT/SIGTERM is received. Streaming loops stop when it is set.
+ */
+extern int interruption;
+
+/**
+ * @brief Handles SIGINT/SIGTERM while streaming. A second signal kills the program.
+ * 
+ * @param sig Signal number.
+ */
+void signal_handler(int sig);
 
 /**
  * @enum State
@@ -43,15 +58,19 @@ public:
     Serial serial;                 ///< Serial communication handler.
     CommandAssembler cmd;          ///< Command assembler for creating and parsing commands.
     State state;                   ///< Current state of the device.
-    OutputManager* output_manager; ///< Pointer to the output manager.
+    OutputManager* output_manager = nullptr; ///< Pointer to the output manager.
 
     bool is_ready = false;         ///< Indicates if the device is ready.
     bool is_streaming = false;     ///< Indicates if the device is currently streaming data.
     int id;                        ///< Unique identifier for the device.
     std::string port;              ///< Port name for the device.
+    uint16_t interface_id;         ///< Interned port, radio mode and channel (see InterfaceRegistry), added to every packet.
     uint8_t radio_mode;            ///< Radio mode setting for the device.
     uint8_t channel;               ///< Channel setting for the device.
     std::mutex &coutMutex;         ///< Mutex for devices logs on debug mode.
+    int total_packets = 0;         ///< Number of packets received while streaming.
+    bool reconnect_on_loss = true; ///< Reconnect (blocking) when the connection is lost while receiving. Disabled by the Reactor, which reconnects devices itself.
+    std::shared_ptr<ReplaySource> replay; ///< Capture file replayed instead of the serial port (null for a real device).
 
     /**
      * @brief Constructor for the Device class.
@@ -153,5 +172,58 @@ public:
     bool receive_response(std::vector<uint8_t> &ret);
 
 
+    /**
+     * @brief Reconnects to the device after the connection was lost.
+     * - Blocks, retrying every 10 seconds, until the device is back or an interruption is received.
+     * 
+     * @return true if the device was reconnected and started, false otherwise.
+     */
     bool reconnect();
+
+    /**
+     * @brief Makes a single reconnection attempt: reopens the serial port, initializes and starts the device.
+     * 
+     * @return true if the device was reconnected and started, false otherwise.
+     */
+    bool try_reconnect();
+
+    /**
+     * @brief Tells the output manager if the device is streaming, so the merge does not wait for a lost device.
+     * 
+     * @param active true if the device is streaming.
+     */
+    void set_active(bool active);
+
+    /**
+     * @brief Processes the data available on the serial port without blocking (used by the Reactor).
+     * - Reads whatever the port has in a single call (only if bytes left in the serial buffer were consumed).
+     * - Runs the bytes through the device persistent framer, so frames can be split across calls.
+     * - Every complete frame is verified and sent to the output manager.
+     * 
+     * @return Number of bytes read from the port (0 if there was nothing to read) or -1 if the connection was lost.
+     */
+    int stream_step();
+
+private:
+    Framer stream_framer;              ///< Framer kept between stream_step calls.
+    std::vector<uint8_t> stream_frame; ///< Bytes of the frame being assembled by stream_step.
+    std::chrono::system_clock::time_point replay_time; ///< Capture time of the last replayed frame.
+
+    /**
+     * @brief Receives the next frame of the replayed capture file (see receive_response).
+     * - Waits until the frame is due when the replay is paced.
+     * - Stops the stream at the end of the file.
+     * 
+     * @param ret Vector to store the frame.
+     * @return true if a frame was replayed, false at the end of the file or if interrupted.
+     */
+    bool receive_replay(std::vector<uint8_t> &ret);
+
+    /**
+     * @brief Verifies a frame received while streaming and sends it to the output manager.
+     * 
+     * @param frame Complete frame.
+     * @return true if the frame is a valid data frame, false otherwise.
+     */
+    bool dispatch_frame(std::vector<uint8_t>& frame);
 };
@@ -0,0 +1,138 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "common.hpp"
+#include "frame_pool.hpp"
+#include "ring_queue.hpp"
+
+// Number of slots of the hash table (power of two). At most half of them are used, so probe sequences stay short
+#define DEDUP_TABLE_SIZE 4096
+// Maximum number of packets held while waiting for their duplicates
+#define DEDUP_MAX_PENDING (DEDUP_TABLE_SIZE / 2)
+// Maximum time a packet is held when no later packet arrives to close its window
+#define DEDUP_MAX_HOLD_MS 100
+
+/**
+ * @struct dedup_entry_s
+ * @brief Represents a packet held by the duplicate filter.
+ */
+struct dedup_entry_s {
+    FrameRef frame;                 ///< Frame with the best copy of the packet so far.
+    int64_t time = 0;               ///< Capture time (microseconds) of the first copy.
+    uint64_t hash = 0;              ///< Hash of the payload (0 for frames without payload, which are never matched).
+    std::chrono::steady_clock::time_point arrival;  ///< When the first copy was held (DEDUP_MAX_HOLD_MS starts then, since replayed packets keep their capture time).
+};
+
+/**
+ * @struct dedup_slot_s
+ * @brief Slot of the hash table of the duplicate filter (16 bytes, four per cache line).
+ */
+struct dedup_slot_s {
+    uint64_t hash;                  ///< Hash of the payload, 0 if the slot is empty.
+    uint64_t sequence;              ///< Sequence number of the held packet.
+};
+
+/**
+ * @struct dedup_stats_s
+ * @brief Statistics of the duplicate filter for a device.
+ */
+struct dedup_stats_s {
+    int device_id;                  ///< Device that captured the copies.
+    uint64_t suppressed;            ///< Copies captured by the device that were discarded for a copy with a better RSSI.
+};
+
+/**
+ * @class DuplicateFilter
+ * @brief Discards copies of the same over-the-air frame captured by different devices, keeping the copy with the best RSSI.
+ * - Two packets are copies when they come from different devices, have the same payload and their capture times differ by at most the window.
+ * - Packets are held until their window is closed by a later packet (or for DEDUP_MAX_HOLD_MS), so a better copy can still replace them.
+ * - The held packets are indexed by an open addressing hash table of fixed size (linear probing, backward shift deletion), so no memory is allocated per packet.
+ * - Expects packets in capture order (the output of PacketMerger). It is not thread safe.
+ */
+class DuplicateFilter
+{
+public:
+    /**
+     * @brief Constructs a new DuplicateFilter object.
+     * 
+     * @param num_devices Number of devices (frames are indexed by their device id).
+     * @param window Maximum difference between the capture times of two copies (microseconds).
+     */
+    DuplicateFilter(int num_devices, int64_t window);
+
+    /**
+     * @brief Adds a packet. It is discarded right away if a held copy has a better or equal RSSI.
+     * 
+     * @param frame Frame with the packet.
+     * @param time Capture time of the packet on the common timebase (microseconds).
+     */
+    void push(FrameRef frame, int64_t time);
+
+    /**
+     * @brief Releases the oldest held packet, if its window is closed.
+     * 
+     * @param frame Set to the released frame.
+     * @param flush Set true to release packets without waiting (e.g. when the capture stops).
+     * @return true if a packet was released, false otherwise.
+     */
+    bool pop(FrameRef& frame, bool flush = false);
+
+    /**
+     * @brief Gets when the oldest held packet will be released even if no other packet arrives.
+     * 
+     * @return std::chrono::steady_clock::time_point Release time, or time_point::max() if no packet is held.
+     */
+    std::chrono::steady_clock::time_point next_release();
+
+    /**
+     * @brief Gets the number of packets held.
+     */
+    size_t pending() const { return held.size(); }
+
+    /**
+     * @brief Gets the statistics of each device.
+     */
+    std::vector<dedup_stats_s> get_stats() const;
+
+private:
+    int64_t window;                         ///< Maximum difference between the capture times of two copies.
+    int64_t latest_time;                    ///< Latest capture time added.
+    RingQueue<dedup_entry_s> held;          ///< Held packets, in the order they were added.
+    uint64_t first_sequence = 0;            ///< Sequence number of the first held packet.
+    std::vector<dedup_slot_s> table;        ///< Hash table from payload hash to held packet.
+    size_t mask;                            ///< Mask of the table indexes.
+    std::vector<uint64_t> suppressed;       ///< Discarded copies of each device.
+
+    /**
+     * @brief Hashes the payload of a packet (the bytes returned by CommandAssembler::get_payload).
+     * 
+     * @return uint64_t Hash, never 0. 0 if the packet has no payload.
+     */
+    static uint64_t hash_payload(const packet_queue_s& packet);
+
+    /**
+     * @brief Checks if two packets have the same payload.
+     */
+    static bool same_payload(const packet_queue_s& a, const packet_queue_s& b);
+
+    /**
+     * @brief Removes a held packet from the hash table.
+     */
+    void erase(uint64_t hash, uint64_t sequence);
+};
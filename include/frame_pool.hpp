@@ -0,0 +1,186 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+#include "common.hpp"
+
+// Number of frames allocated at once when the pool grows
+#define FRAME_POOL_SLAB_SIZE 4096
+// Default maximum number of slabs (the pool holds up to FRAME_POOL_SLAB_SIZE * FRAME_POOL_MAX_SLABS frames until it is sized)
+#define FRAME_POOL_MAX_SLABS 16
+// Largest number of frames a pool can be sized to, whatever the queue budgets
+#define FRAME_POOL_MAX_FRAMES (1 << 21)
+// Fraction of the maximum number of frames that must stay free, below which the pool is low (1/8)
+#define FRAME_POOL_LOW_SHIFT 3
+
+class FramePool;
+
+/**
+ * @struct pooled_frame_s
+ * @brief Represents a captured packet stored in the frame pool.
+ */
+struct pooled_frame_s {
+    packet_queue_s packet;                              ///< Packet data.
+    std::atomic<uint32_t> references{0};                ///< Number of FrameRef pointing to the frame.
+    uint32_t index = 0;                                 ///< Position of the frame in the pool.
+    std::atomic<uint32_t> next_free{0};                 ///< Next free frame (index + 1, 0 ends the free list).
+};
+
+/**
+ * @struct frame_pool_stats_s
+ * @brief Statistics of the frame pool.
+ */
+struct frame_pool_stats_s {
+    size_t capacity;                                    ///< Number of frames allocated by the pool (grows by slabs).
+    size_t max_capacity;                                ///< Maximum number of frames the pool can allocate.
+    size_t in_use;                                      ///< Number of frames currently referenced.
+    size_t high_water_mark;                             ///< Largest number of frames referenced at once.
+    uint64_t exhausted;                                 ///< Packets dropped because every frame of the pool was in use.
+};
+
+/**
+ * @class FrameRef
+ * @brief Reference counted handle to a frame of a FramePool.
+ * - Copying the handle shares the frame (no packet data is copied).
+ * - The frame goes back to the pool when the last handle is destroyed or reset.
+ * - Handles can be copied and released from different threads.
+ */
+class FrameRef
+{
+public:
+    FrameRef() = default;
+    FrameRef(const FrameRef& other);
+    FrameRef(FrameRef&& other) noexcept;
+    FrameRef& operator=(const FrameRef& other);
+    FrameRef& operator=(FrameRef&& other) noexcept;
+    ~FrameRef();
+
+    /**
+     * @brief Releases the frame (the handle becomes empty).
+     */
+    void reset();
+
+    packet_queue_s* operator->() const { return &frame->packet; }
+    packet_queue_s& operator*() const { return frame->packet; }
+    explicit operator bool() const { return frame != nullptr; }
+
+private:
+    friend class FramePool;
+
+    FramePool* pool = nullptr;                          ///< Pool that owns the frame.
+    pooled_frame_s* frame = nullptr;                    ///< Referenced frame.
+
+    FrameRef(FramePool* pool, pooled_frame_s* frame);
+};
+
+/**
+ * @class FramePool
+ * @brief Pool of packet frames allocated in slabs and shared between the output consumers.
+ * - One frame is taken per captured packet and shared by the file writer, the pipe handlers and the crypto handler.
+ * - The pool grows one slab at a time up to its maximum, which the output manager sets from the queue budgets. Slabs are only freed with the pool.
+ * - Free frames are kept in a lock-free list, so taking and returning a frame never locks (only growing does).
+ * - When the pool is exhausted, acquire returns an empty handle and the packet is counted as dropped.
+ * - The pool must outlive every FrameRef taken from it.
+ */
+class FramePool
+{
+public:
+    /**
+     * @brief Constructs a new FramePool object. No frame is allocated until the first acquire.
+     * 
+     * @param slab_size Number of frames allocated at once.
+     * @param max_slabs Maximum number of slabs, until set_max_frames is called.
+     */
+    FramePool(size_t slab_size = FRAME_POOL_SLAB_SIZE, size_t max_slabs = FRAME_POOL_MAX_SLABS);
+
+    /**
+     * @brief Sets the maximum number of frames, rounded up to whole slabs and limited to FRAME_POOL_MAX_FRAMES.
+     * - The slabs already allocated are kept, even if the new maximum is smaller.
+     * 
+     * @param frames Maximum number of frames.
+     * @return size_t Maximum number of frames that was set.
+     */
+    size_t set_max_frames(size_t frames);
+
+    /**
+     * @brief Checks if the pool is low: less than 1/8 of its maximum frames are free.
+     * - Outputs that can fall behind (the pipes) give their oldest frames back while the pool is low, so they do not starve the others.
+     * 
+     * @return true if the pool is low.
+     */
+    bool is_low() const;
+
+    /**
+     * @brief Takes a free frame from the pool.
+     * 
+     * @return FrameRef Handle to the frame (its packet data is not cleared), empty if the pool is exhausted.
+     */
+    FrameRef acquire();
+
+    /**
+     * @brief Gets the pool statistics.
+     * 
+     * @return frame_pool_stats_s Pool statistics.
+     */
+    frame_pool_stats_s get_stats();
+
+private:
+    friend class FrameRef;
+
+    std::mutex grow_mutex;                                      ///< Mutex for growing the pool.
+    std::unique_ptr<std::unique_ptr<pooled_frame_s[]>[]> slabs; ///< Slabs (max_slabs entries, allocated on demand).
+    std::atomic<size_t> num_slabs{0};                           ///< Number of allocated slabs.
+    std::atomic<uint64_t> free_head{0};                         ///< Free list head (tag << 32 | index + 1, the tag prevents ABA).
+    size_t slab_size;                                           ///< Number of frames per slab.
+    size_t slab_limit;                                          ///< Number of entries of slabs (the largest maximum that can be set).
+    std::atomic<size_t> max_slabs;                              ///< Maximum number of slabs.
+    std::atomic<size_t> in_use{0};                              ///< Number of frames in use.
+    std::atomic<size_t> high_water_mark{0};                     ///< Largest number of frames in use at once.
+    std::atomic<uint64_t> exhausted{0};                         ///< Packets dropped because the pool was exhausted.
+
+    /**
+     * @brief Gets the frame at a position of the pool.
+     * 
+     * @param index Position of the frame (its slab must be allocated).
+     * @return pooled_frame_s* Frame.
+     */
+    pooled_frame_s* frame_at(uint32_t index) const { return &slabs[index / slab_size][index % slab_size]; }
+
+    /**
+     * @brief Takes the first frame of the free list.
+     * 
+     * @return pooled_frame_s* Frame, nullptr if the list is empty.
+     */
+    pooled_frame_s* pop_free();
+
+    /**
+     * @brief Puts a chain of linked frames at the front of the free list.
+     * 
+     * @param first First frame of the chain.
+     * @param last Last frame of the chain (its next_free is overwritten).
+     */
+    void push_free(pooled_frame_s* first, pooled_frame_s* last);
+
+    /**
+     * @brief Returns a frame to the pool (called when its last reference is released).
+     * 
+     * @param frame Frame to be returned.
+     */
+    void release(pooled_frame_s* frame);
+};
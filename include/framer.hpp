@@ -14,6 +14,8 @@
 #include <cstdint>
 #include <string>
 
+#include "common.hpp"
+
 /**
  * @enum FrameState
  * @brief Represents the state of the frame processing.
@@ -81,7 +83,7 @@ private:
     uint8_t frame_rssi;         ///< RSSI value of the frame.
     uint64_t frame_timestamp;   ///< Timestamp of the frame.
     uint8_t frame_status;       ///< Status of the frame.
-    uint8_t frame_payload[256]; ///< Payload data of the frame.
+    uint8_t frame_payload[FRAME_DATA_MAX_SIZE]; ///< Payload data of the frame.
     uint16_t payload_size;      ///< Size of the payload.
     int current_data_index = 0; ///< Index of the current data byte being processed.
 };
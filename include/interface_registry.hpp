@@ -0,0 +1,72 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+// Maximum number of different interfaces that can be registered
+#define MAX_INTERFACES 256
+
+// TI Radio Packet Info fields that only depend on the interface: interface(2) + protocol(1) + phy(1) + frequency(4) + channel(2)
+#define TI_RPI_PREFIX_SIZE 10
+
+/**
+ * @struct interface_entry_s
+ * @brief Represents a registered interface (a serial port capturing with a radio mode and channel).
+ */
+struct interface_entry_s {
+    std::string name;                                   ///< Interface name (serial port).
+    uint8_t mode;                                       ///< Radio mode.
+    int channel;                                        ///< Channel number.
+    uint16_t number;                                    ///< Interface number written on the TI header (digits of the name).
+    uint8_t ti_rpi_prefix[TI_RPI_PREFIX_SIZE];          ///< Encoded TI Radio Packet Info fields written before the RSSI of every packet.
+};
+
+/**
+ * @class InterfaceRegistry
+ * @brief Interns interfaces, so packets carry a small ID instead of a copy of the name.
+ * - The TI Radio Packet Info fields of each interface are encoded once when it is registered, so the pcap records can copy them.
+ * - Registering takes a lock, but reading an entry does not: entries are never changed after being published.
+ */
+class InterfaceRegistry
+{
+public:
+    /**
+     * @brief Gets the ID of an interface, registering it if needed.
+     * - The radio mode and channel are validated before the interface is registered.
+     * 
+     * @param name Interface name (serial port).
+     * @param mode Radio mode.
+     * @param channel Channel number.
+     * @param id Interface ID.
+     * @return true if the interface is registered.
+     * @return false if the radio mode or channel are invalid, or the registry is full.
+     */
+    static bool intern(const std::string& name, uint8_t mode, int channel, uint16_t& id);
+
+    /**
+     * @brief Gets a registered interface.
+     * 
+     * @param id Interface ID returned by intern.
+     * @return const interface_entry_s& Interface entry. An empty entry is returned for unknown IDs.
+     */
+    static const interface_entry_s& get(uint16_t id);
+
+private:
+    static std::mutex m_mutex;                          ///< Mutex for registering interfaces.
+    static interface_entry_s entries[MAX_INTERFACES];   ///< Registered interfaces.
+    static std::atomic<uint16_t> entries_count;         ///< Number of published entries.
+};
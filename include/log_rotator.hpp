@@ -0,0 +1,193 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+
+// Seconds before a rotation the next log files are opened
+#define LOG_ROTATION_PREPARE_LEAD 10
+
+/**
+ * @struct log_file_set_s
+ * @brief The log files written during one reset period.
+ */
+struct log_file_set_s {
+    std::vector<FILE*> files;           ///< Log files, indexed like the files of the output manager (null for devices that are not logged).
+    std::vector<std::string> paths;     ///< Path of each file (same index).
+    std::vector<FILE*> index_files;     ///< Sidecar index of each file (same index, empty or null when the files are not indexed).
+    std::vector<std::string> index_paths; ///< Path of each index (same index).
+    std::vector<uint64_t> data_offsets; ///< Offset of the first record of each file, after its header (same index).
+};
+
+/**
+ * @class LogRotator
+ * @brief Opens and closes the log files of a rotation in a background thread, so the output manager never waits on the disk.
+ * - The rotations are numbered. The next file set is opened LOG_ROTATION_PREPARE_LEAD seconds before the time of its rotation
+ *   (right away for rotations by size or packets, which have no time), and taken without waiting when it is due.
+ * - The previous file set is flushed, truncated to its data (releasing the preallocated space), synced to disk and closed after it is retired.
+ * - When a number of file sets to keep is set, the oldest closed sets are removed (ring buffer of files).
+ * - A prepared file set that was never taken (the capture stopped first) is closed and removed.
+ */
+class LogRotator
+{
+public:
+    /**
+     * @brief Opens the file set of a rotation, given its number and time. Returns false if a file could not be opened.
+     * - Called from the background thread.
+     */
+    using Opener = std::function<bool(uint64_t, std::chrono::system_clock::time_point, log_file_set_s&)>;
+
+    /**
+     * @brief Constructs a new LogRotator object and starts its thread.
+     * 
+     * @param opener Function that opens the file set of a rotation.
+     * @param max_sets Number of file sets kept, counting the one being written (0 to keep all).
+     */
+    LogRotator(Opener opener, int max_sets = 0);
+
+    /**
+     * @brief Closes the retired file sets and stops the thread.
+     */
+    ~LogRotator();
+
+    /**
+     * @brief Asks the background thread to open the file set of a rotation ahead of time.
+     * 
+     * @param index Number of the rotation.
+     * @param when Time of the rotation (the file set is opened LOG_ROTATION_PREPARE_LEAD seconds before it).
+     */
+    void prepare(uint64_t index, std::chrono::system_clock::time_point when);
+
+    /**
+     * @brief Takes the file set prepared for a rotation, without waiting.
+     * 
+     * @param index Number of the rotation.
+     * @param set Set to the prepared file set.
+     * @return true if the file set was ready, false otherwise (the caller must open it).
+     */
+    bool take(uint64_t index, log_file_set_s& set);
+
+    /**
+     * @brief Hands a file set over to the background thread to be flushed, synced and closed.
+     * - The file set counts towards the sets kept, and the oldest closed sets are removed.
+     * 
+     * @param set File set that will no longer be written (left empty).
+     */
+    void retire(log_file_set_s& set);
+
+    /**
+     * @brief Reserves disk space for a log file, so writing it does not allocate blocks (Linux only).
+     * - The size of the file does not change. The space not written is released when the file is closed by close_set.
+     * 
+     * @param file Log file.
+     * @param bytes Bytes to reserve.
+     */
+    static void preallocate(FILE* file, uint64_t bytes);
+
+    /**
+     * @brief Flushes, truncates to the written data, syncs to disk and closes the files of a set (and their indexes).
+     * 
+     * @param set File set to close.
+     * @param remove Set true to also remove the files.
+     */
+    static void close_set(log_file_set_s& set, bool remove = false);
+
+private:
+    /**
+     * @brief Function that opens the file set of a rotation.
+     */
+    Opener opener;
+
+    /**
+     * @brief Thread that opens and closes the file sets.
+     */
+    std::thread thread;
+
+    /**
+     * @brief Protects every member below.
+     */
+    std::mutex mutex;
+
+    /**
+     * @brief Wakes up the thread when there is a new request or it must stop.
+     */
+    std::condition_variable cv;
+
+    /**
+     * @brief Cleared when the thread must stop.
+     */
+    bool running = true;
+
+    /**
+     * @brief Number of file sets kept (0 to keep all).
+     */
+    int max_sets;
+
+    /**
+     * @brief Indicates that the file set of rotation pending_index must be opened at pending_when.
+     */
+    bool pending = false;
+
+    /**
+     * @brief Number of the rotation of the file set to be opened.
+     */
+    uint64_t pending_index = 0;
+
+    /**
+     * @brief Rotation time of the file set to be opened.
+     */
+    std::chrono::system_clock::time_point pending_when;
+
+    /**
+     * @brief Indicates that ready_set was opened and not taken yet.
+     */
+    bool ready = false;
+
+    /**
+     * @brief Number of the rotation of ready_set.
+     */
+    uint64_t ready_index = 0;
+
+    /**
+     * @brief File set opened ahead of time.
+     */
+    log_file_set_s ready_set;
+
+    /**
+     * @brief Number of the last rotation that was taken, so a file set opened too late for it is discarded.
+     */
+    uint64_t taken_index = 0;
+
+    /**
+     * @brief File sets to be closed, with a flag indicating if they must also be removed (never written).
+     */
+    std::deque<std::pair<log_file_set_s, bool>> closing;
+
+    /**
+     * @brief Paths of the closed file sets that are kept, oldest first (only used by the thread).
+     */
+    std::deque<std::vector<std::string>> kept;
+
+    /**
+     * @brief Opens and closes the file sets until the rotator is destroyed.
+     */
+    void run();
+};
@@ -16,11 +16,47 @@
 #include <mutex> 
 #include <queue>
 #include <memory>
+#include <atomic>
+#include <condition_variable>
 
 #include "common.hpp"
+#include "spsc_ring.hpp"
+#include "frame_pool.hpp"
+#include "packet_merger.hpp"
+#include "clock_model.hpp"
+#include "duplicate_filter.hpp"
+#include "record_batch.hpp"
 #include "pipe_packet_handler.hpp"
+#include "stream_server.hpp"
+#include "shm_ring_writer.hpp"
+#include "log_rotator.hpp"
 #include "crypto_handler.hpp"
 
+// Longest time a device waits for room in its queue with the block policy, before the packet is dropped
+#define QUEUE_BLOCK_TIMEOUT_MS 50
+
+/**
+ * @struct queue_stats_s
+ * @brief Statistics of the queue between a device and the output manager.
+ */
+struct queue_stats_s {
+    int device_id;              ///< Device that produces into the queue.
+    size_t capacity;            ///< Maximum number of packets in the queue.
+    size_t high_water_mark;     ///< Largest number of packets queued at once.
+    uint64_t dropped;           ///< Packets discarded because the queue was full.
+};
+
+/**
+ * @struct clock_stats_s
+ * @brief Estimated clock of a device (see ClockModel).
+ */
+struct clock_stats_s {
+    int device_id;              ///< Device whose clock is modeled.
+    int64_t offset;             ///< Microseconds added to the device timestamps to get the system time (at the last packet).
+    double drift_ppm;           ///< Drift of the device clock against the system clock, in parts per million.
+    uint64_t samples;           ///< Number of (device time, system time) pairs used.
+};
+
 /**
  * @class OutputManager
  * @brief Manages the output of captured packets.
@@ -29,14 +65,23 @@
  * - Pipes are managed each in a separate thread to avoid blocking.
  *
  * This class is responsible for managing the queue of captured packets and writing these packets to log files.
+ * Each device has its own lock-free single producer/single consumer ring, drained in batches by the run method.
  */
 class OutputManager
 {
 public:
+    /**
+     * @brief Pool of the frames of captured packets.
+     * - Devices take a frame for each packet and the same frame is shared by the file, pipes and crypto handling.
+     * - Sized by configure from the queue budgets, so every queue can hold its whole budget at once.
+     * - Declared first so it is destroyed after every member that may still reference its frames.
+     */
+    FramePool frame_pool;
+
     /**
      * @brief Indicates if the manager is running (executing the run method).
      */
-    bool is_running = false;
+    std::atomic<bool> is_running{false};
 
     /**
      * @brief Indicates if the manager can run (has a file attached to it).
@@ -52,13 +97,55 @@ public:
     OutputManager(log_s log_settings);
 
     /**
-     * @brief Adds a packet to the packet queue.
-     * - This queue is processed by the run method.
+     * @brief Adds a packet to the queue of the device that captured it (frame->id).
+     * - Must only be called from the thread streaming that device (each queue has a single producer).
+     * - The queues are processed by the run method.
      * - Any packet that is added to the queue will be processed by the output manager and written to the log files or pipes if necessary.
+     * - If the queue is full the packet is discarded and counted as dropped.
+     * 
+     * @param frame Frame taken from frame_pool with the packet to be added.
+     */
+    void add_packet(FrameRef frame);
+
+    /**
+     * @brief Sets if a device is streaming, so the merge only waits for the packets of active devices.
+     * - Called by the devices when their connection is lost or comes back (from any thread).
+     * 
+     * @param device_id Device id.
+     * @param active true if the device is streaming.
+     */
+    void set_device_active(int device_id, bool active);
+
+    /**
+     * @brief Gets the estimated clock offset and drift of each device that sent packets.
+     * - Must be called from the output manager thread (or after it stopped).
      * 
-     * @param packet Packet to be added.
+     * @return Vector with the clock statistics of each device.
      */
-    void add_packet(packet_queue_s packet);
+    std::vector<clock_stats_s> get_clock_stats();
+
+    /**
+     * @brief Gets the statistics (high-water mark and late packets) of the merge of each device.
+     * - Empty when the packets are not merged.
+     * 
+     * @return Vector with the merge statistics of each device.
+     */
+    std::vector<merge_stats_s> get_merge_stats();
+
+    /**
+     * @brief Gets the number of duplicated packets discarded for each device.
+     * - Empty when duplicated packets are not filtered.
+     * 
+     * @return Vector with the duplicate filter statistics of each device.
+     */
+    std::vector<dedup_stats_s> get_dedup_stats();
+
+    /**
+     * @brief Gets the statistics (capacity, high-water mark and drops) of each device queue.
+     * 
+     * @return Vector with the statistics of each device queue.
+     */
+    std::vector<queue_stats_s> get_queue_stats();
 
     /**
      * @brief Configures the log files.
@@ -84,63 +171,163 @@ public:
      * 
      * @param num_devices Number of devices to be configured.
      * @param readyDevices Bool vector indicating which devices were successful initialized.
+     * @param interfaces Registered interface of each device (InterfaceRegistry ID), described in pcapng log files.
      * @return true if the configuration was successful, false otherwise.
      */
-    bool configure(int num_devices, std::vector<bool> readyDevices);
+    bool configure(int num_devices, std::vector<bool> readyDevices, std::vector<uint16_t> interfaces);
 
     /**
      * @brief Starts the execution of the output manager.
      * - Is the main method of the output manager. It will process the packet queue and write the packets to the log files or pipes.
+     * - Drains the device queues in batches without sleeping while packets are pending and waits on a condition variable when they are all empty.
      */
     void run();
 
+    /**
+     * @brief Asks the run method to finish once the queues are empty and wakes it up if it is waiting.
+     * - Must be called after the devices stopped producing packets.
+     */
+    void stop();
+
     /**
      * @brief Handles a packet from the queue.
      * - Decides if a packet should be written to the log files or pipes, or both.
-     * - Handles the first packet differently to set the start time.
-     * - Check if the log files need to be recreated according to the reset period.
+     * - The capture time of the packet (frame->clock_offset) must have been set by align_clock.
+     * - Recreates the log files when the capture time of the packet reached the next rotation.
      * 
-     * @param packet Packet to be handled.
+     * @param frame Frame with the packet to be handled (shared with the pipes it is sent to).
      * @param isTransportKey Bool flag indicating if the packet is a transport key packet
      */
-    void handle_packet(packet_queue_s packet, bool isTransportKey = false);
+    void handle_packet(const FrameRef& frame, bool isTransportKey = false);
 
     /**
-     * @brief Check if the log files needs to be recreated.
+     * @brief Switches to the log files of the next rotation (by time, size or number of packets).
+     * - Takes the file set opened ahead of time by log_rotator (or opens it if it is not ready) and retires the current one,
+     *   so the old files are synced and closed in the background.
+     * - Asks log_rotator to prepare the file set of the following rotation.
+     * 
+     * @param receive_time Time the packet that reached the rotation was received.
      */
-    void recreate_log_files();
+    void recreate_log_files(std::chrono::system_clock::time_point receive_time);
 
 private:
     /**
-     * @brief Indicates if it is the first packet being processed.
-     * - Is used to set the start time of the processing.
+     * @brief Number of configured devices.
      */
-    bool is_first_packet = true;
+    int num_devices;
 
     /**
-     * @brief Number of configured devices.
+     * @brief Registered interface (InterfaceRegistry ID) of each device, indexed by the device id.
      */
-    int num_devices;
+    std::vector<uint16_t> device_interfaces;
+
+    /**
+     * @brief Format of the log files (parsed from log.file.format).
+     */
+    CaptureFormat file_format = CaptureFormat::PCAP;
+
+    /**
+     * @brief One queue per device, indexed by the device id.
+     * - Lock-free: the device thread is the only producer and the run method the only consumer.
+     */
+    std::vector<std::unique_ptr<SpscRing<FrameRef>>> device_rings;
+
+    /**
+     * @brief Mutex used only to wait on wakeup_cv (the queues themselves are lock-free).
+     */
+    std::mutex wakeup_mutex;
 
     /**
-     * @brief Mutex for protecting the packet queue.
+     * @brief Condition variable the run method waits on when all queues are empty.
      */
-    std::mutex m_mutex;
+    std::condition_variable wakeup_cv;
 
     /**
-     * @brief Queue of packets to be processed.
+     * @brief Indicates that the run method is (about to be) waiting on wakeup_cv, so producers must notify it.
      */
-    std::queue<packet_queue_s> packet_queue;
+    std::atomic<bool> consumer_waiting{false};
 
     /**
-     * @brief Start time of the processing.
+     * @brief Indicates if each device is streaming, indexed by the device id (see set_device_active).
      */
-    std::chrono::time_point<std::chrono::system_clock> start_time;
+    std::unique_ptr<std::atomic<bool>[]> device_active;
 
     /**
-     * @brief Last update time if the log files need to be recreated more than once.
+     * @brief Condition variable the devices wait on for room in their queue (block policy).
      */
-    std::chrono::time_point<std::chrono::system_clock> last_update;
+    std::condition_variable space_cv;
+
+    /**
+     * @brief Number of devices waiting on space_cv, so the run method only notifies when needed.
+     */
+    std::atomic<int> producers_waiting{0};
+
+    /**
+     * @brief Number of packets dropped by each device queue because it was full.
+     * - Only written by the producer of each queue.
+     */
+    std::unique_ptr<std::atomic<uint64_t>[]> dropped_packets;
+
+    /**
+     * @brief How often the log files are recreated (parsed from log.file.reset_period).
+     */
+    ResetPeriod reset_period = ResetPeriod::NONE;
+
+    /**
+     * @brief Time of the next rotation of the log files, compared with the time each packet was received.
+     */
+    std::chrono::system_clock::time_point next_rotation = std::chrono::system_clock::time_point::max();
+
+    /**
+     * @brief Opens and closes the log files of the rotations in the background (null when the log files are not recreated).
+     */
+    std::unique_ptr<LogRotator> log_rotator;
+
+    /**
+     * @brief Number of the current rotation of the log files (the first files are 1).
+     */
+    uint64_t rotation_index = 0;
+
+    /**
+     * @brief Set when a log file reached log.file.rotate_size_mb or log.file.rotate_packets, so the next packet starts new files.
+     */
+    bool rotation_due = false;
+
+    /**
+     * @brief Rotations by size or packets that failed in a row. The next attempt waits for as many more bytes or packets.
+     */
+    uint64_t rotation_failures = 0;
+
+    /**
+     * @brief Time the log files were configured, in the name of the files that rotate by size or packets.
+     */
+    std::chrono::system_clock::time_point capture_start;
+
+    /**
+     * @brief Packets written to each log file since its last index entry (same index as log_set.files).
+     */
+    std::vector<uint64_t> index_packets;
+
+    /**
+     * @brief Timestamp of the last index entry of each log file (same index as log_set.files, INT64_MIN before the first entry).
+     */
+    std::vector<int64_t> index_times;
+
+    /**
+     * @brief Bytes of records written to each log file since it was opened (same index as log_set.files).
+     * - Only grows after a successful write, and follows the file position after a failed one, so index offsets match the file.
+     */
+    std::vector<uint64_t> log_file_bytes;
+
+    /**
+     * @brief Packets written to each log file since it was opened (same index as log_set.files).
+     */
+    std::vector<uint64_t> log_file_packets;
+
+    /**
+     * @brief Devices that have a log file, indexed by the device id.
+     */
+    std::vector<bool> file_devices;
 
     /**
      * @brief Log settings.
@@ -155,12 +342,24 @@ private:
     /**
      * @brief Vector with the packets queue entrys with extracted keys.
      */
-    std::vector<packet_queue_s> key_packets;
+    std::vector<FrameRef> key_packets;
+
+    /**
+     * @brief Payload of the packet being handled (reused between packets to avoid allocations).
+     */
+    std::vector<uint8_t> payload_buffer;
 
     /**
-     * @brief Vector of pointers to log files.
+     * @brief Records waiting to be written to each log file (same index as log_set.files).
+     * - Written with a single vectored write when full and after each drain of the queues.
      */
-    std::vector<FILE*> log_files;
+    std::vector<std::unique_ptr<RecordBatch>> file_batches;
+
+    /**
+     * @brief Log files of the current rotation, with their paths and indexes.
+     * - Indexed by the device id when the devices are split (null for devices that are not ready), otherwise a single file.
+     */
+    log_file_set_s log_set;
 
     /**
      * @brief Vector of pipes for logging.
@@ -176,10 +375,135 @@ private:
     std::vector<std::thread> log_pipes_threads;
 
     /**
-     * @brief Maximum size of the packet queue.
-     * - May be useful to avoid memory issues in high packet flow situations (such as BLE).
+     * @brief Servers of the pcap stream (Unix domain socket and TCP, when enabled).
+     */
+    std::vector<std::unique_ptr<StreamServer>> stream_servers;
+
+    /**
+     * @brief Threads of the stream servers (same index as stream_servers).
+     */
+    std::vector<std::thread> stream_threads;
+
+    /**
+     * @brief Shared memory ring the packets are published to (null when disabled).
+     */
+    std::unique_ptr<ShmRingWriter> shm_writer;
+
+    /**
+     * @brief Maximum number of packets in each device queue.
+     * - Set from the byte budget of the log files (queueSizeKB), divided by the size of a pooled frame.
+     * - The queue only holds references, but each queued packet keeps its frame of frame_pool in use.
+     * - Shrunk by configure when the budgets do not fit in FRAME_POOL_MAX_FRAMES.
+     */
+    size_t queue_max_size = 65536;
+
+    /**
+     * @brief Maximum number of packets in each pipe queue.
+     * - Set by configure from the byte budget of the pipes (queueSizeKB), like queue_max_size.
+     */
+    size_t pipe_queue_max_size = 65536;
+
+    /**
+     * @brief What to do with a packet when its device queue is full (drop the new packet or wait for room).
+     * - With the block policy the device waits at most QUEUE_BLOCK_TIMEOUT_MS, then the packet is dropped.
+     */
+    QueuePolicy queue_policy = QueuePolicy::DROP_NEWEST;
+
+    /**
+     * @brief Clock model of each device, indexed by the device id.
+     * - Maps the device timestamps to a common timebase (the system clock), so devices with different counters and drifts can be compared.
+     */
+    std::vector<ClockModel> clocks;
+
+    /**
+     * @brief Merges the packets of the devices in capture order before they are handled.
+     * - Only used when more than one device writes to the same log file or pipe and log.merge_window is positive.
+     */
+    std::unique_ptr<PacketMerger> merger;
+
+    /**
+     * @brief Discards copies of the same frame captured by different devices, after the merge.
+     * - Only used when more than one device writes to the same log file or pipe and log.dedup_window is positive.
+     */
+    std::unique_ptr<DuplicateFilter> dedup;
+
+    /**
+     * @brief Maximum number of packets taken from a device queue before moving to the next one.
+     * - Keeps a busy device from delaying the others.
+     */
+    int drain_batch_size = 256;
+
+    /**
+     * @brief Drains all device queues once, handling up to drain_batch_size packets from each one.
+     * 
+     * @return Number of packets handled.
+     */
+    int drain_queues();
+
+    /**
+     * @brief Sets the capture time of a packet (frame->clock_offset) from the clock model of its device.
+     * - The (device time, system time) pair of the packet, taken by the device thread when it was received, is added to the model.
+     * 
+     * @param frame Frame with the packet.
+     * @param sample Set false to not add the packet to the model (e.g. simulated packets).
+     * @return int64_t Capture time of the packet in UTC (microseconds since epoch).
+     */
+    int64_t align_clock(const FrameRef& frame, bool sample = true);
+
+    /**
+     * @brief Passes the packets released by the merger to the duplicate filter and handles the packets it releases.
+     * 
+     * @param flush Set true to release every held packet (when the capture stops).
+     * @return Number of packets handled.
+     */
+    int release_packets(bool flush);
+
+    /**
+     * @brief Adds the record of a packet to the batch of a log file, writing the batch first if it is full.
+     * - Adds an entry to the index of the file every log.file.index_packets packets or log.file.index_interval_ms milliseconds.
+     * 
+     * @param index Index of the log file.
+     * @param frame Frame with the packet.
+     * @param start_time The start time of the capture.
+     * @param interface_index Index of the Interface Description Block of the packet in the file (pcapng only).
+     */
+    void write_to_log_file(size_t index, const FrameRef& frame, std::chrono::microseconds start_time, uint32_t interface_index);
+
+    /**
+     * @brief Opens a log file and writes its header.
+     * - pcap: the global header.
+     * - pcapng: the Section Header Block and the Interface Description Block of the device, or of every device (in device id order) when device_id is -1.
+     * 
+     * @param path Path of the log file.
+     * @param device_id Device logged in the file, or -1 if the file is shared by every device.
+     * @return FILE* The opened file, or nullptr if it could not be opened.
+     */
+    FILE* open_log_file(const std::string& path, int device_id);
+
+    /**
+     * @brief Opens the log files of a rotation.
+     * - Files recreated by time are named after the rotation time. Files that rotate by size or packets are named after the
+     *   start of the capture and numbered, and are preallocated to the rotation size.
+     * - May be called from the thread of log_rotator: only reads settings that do not change after configure.
+     * 
+     * @param index Number of the rotation.
+     * @param when Time of the rotation.
+     * @param set Set to the opened files (closed and cleared if one of them could not be opened).
+     * @return true if every file was opened, false otherwise.
+     */
+    bool open_log_file_set(uint64_t index, std::chrono::system_clock::time_point when, log_file_set_s& set);
+
+    /**
+     * @brief Writes the pending records of every log file.
+     */
+    void flush_log_files();
+
+    /**
+     * @brief Writes the batch of a log file and counts the records that reached it.
+     * 
+     * @param index Index of the log file.
      */
-    int queue_max_size = 500000;
+    void write_log_batch(size_t index);
 
     /**
      * @brief Save packet_queue_s entrys with packets of extracted keys on a bin file 
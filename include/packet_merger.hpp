@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "common.hpp"
+#include "frame_pool.hpp"
+#include "ring_queue.hpp"
+
+// Maximum number of packets held for a device before the merge releases packets regardless of the window
+#define MERGE_MAX_PENDING 4096
+
+/**
+ * @struct merge_entry_s
+ * @brief Represents a packet held by the merge, with its capture time on the common timebase.
+ */
+struct merge_entry_s {
+    FrameRef frame;                 ///< Frame with the packet.
+    int64_t time = 0;               ///< Capture time (microseconds) used to order the packets.
+    std::chrono::steady_clock::time_point arrival;  ///< When the packet was held (the window starts then, since replayed packets keep their capture time).
+};
+
+/**
+ * @struct merge_stats_s
+ * @brief Statistics of the merge of the packets of a device.
+ */
+struct merge_stats_s {
+    int device_id;                  ///< Device whose packets are merged.
+    size_t high_water_mark;         ///< Largest number of packets held at once.
+    uint64_t late;                  ///< Packets released after a later packet of another device (written out of order).
+};
+
+/**
+ * @class PacketMerger
+ * @brief Merges the packets of several devices into a single stream ordered by capture time (k-way merge).
+ * - The packets of each device are already in capture order, so each device only needs a FIFO and the next packet is the oldest of the FIFO heads.
+ * - The oldest head is released as soon as every active device has a packet held (nothing older can arrive), or once it was held for the reorder window.
+ * - The output manager marks the devices inactive while their connection is lost, so they are not waited for.
+ * - The window bounds the latency added to the outputs. A packet that arrives after a later one was released is written anyway and counted as late.
+ * - It is not thread safe (it is only used by the output manager thread).
+ */
+class PacketMerger
+{
+public:
+    /**
+     * @brief Constructs a new PacketMerger object.
+     * 
+     * @param num_devices Number of devices (frames are indexed by their device id).
+     * @param window Maximum time a packet is held waiting for the packets of the other devices.
+     * @param max_pending Maximum number of packets held for a device.
+     */
+    PacketMerger(int num_devices, std::chrono::milliseconds window, size_t max_pending = MERGE_MAX_PENDING);
+
+    /**
+     * @brief Sets if a device is streaming. Only active devices are waited for.
+     * 
+     * @param device_id Device id.
+     * @param active true if the device is streaming.
+     */
+    void set_active(int device_id, bool active);
+
+    /**
+     * @brief Holds a packet until it can be released in order.
+     * 
+     * @param frame Frame with the packet (frame->id must be a valid device id).
+     * @param time Capture time of the packet on the common timebase (microseconds).
+     */
+    void push(FrameRef frame, int64_t time);
+
+    /**
+     * @brief Releases the next packet in capture order, if it is ready.
+     * 
+     * @param frame Set to the released frame.
+     * @param time Set to the capture time of the released frame. May be null.
+     * @param flush Set true to release packets without waiting (e.g. when the capture stops).
+     * @return true if a packet was released, false otherwise.
+     */
+    bool pop(FrameRef& frame, int64_t* time = nullptr, bool flush = false);
+
+    /**
+     * @brief Gets when the next packet will be released by the window, even if no other packet arrives.
+     * 
+     * @return std::chrono::steady_clock::time_point Release time, or time_point::max() if no packet is held.
+     */
+    std::chrono::steady_clock::time_point next_release();
+
+    /**
+     * @brief Gets the number of packets held.
+     */
+    size_t pending() const { return held; }
+
+    /**
+     * @brief Gets the statistics of each device.
+     */
+    std::vector<merge_stats_s> get_stats() const;
+
+private:
+    std::chrono::milliseconds window;               ///< Maximum time a packet is held.
+    size_t max_pending;                             ///< Maximum number of packets held for a device.
+    size_t held = 0;                                ///< Number of packets held.
+    int64_t last_time;                              ///< Capture time of the last released packet.
+    std::vector<RingQueue<merge_entry_s>> queues;   ///< Held packets of each device, in capture order.
+    std::vector<bool> active;                       ///< Devices that are streaming.
+    std::vector<size_t> high_water_marks;           ///< Largest number of packets held for each device.
+    std::vector<uint64_t> late;                     ///< Late packets of each device.
+
+    /**
+     * @brief Gets the device whose next packet is the oldest.
+     * 
+     * @return int Device id, or -1 if no packet is held.
+     */
+    int oldest_device();
+};
@@ -65,7 +65,7 @@ public:
      * @param nwkLayer Poiter to byte vector where the Zigbee Network Layer will be saved.
      * @return Bool value indicating if the Zigbee Network Layer was successful extracted.
      */
-static bool getNwkLayer(std::vector<uint8_t> payload, std::vector<uint8_t>& nwkLayer);
+static bool getNwkLayer(const std::vector<uint8_t>& payload, std::vector<uint8_t>& nwkLayer);
 
 /**
      * @brief Process the Zigbee Network Layer and extract the next layer if possible.
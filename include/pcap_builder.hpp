@@ -21,6 +21,7 @@
 #include <iomanip>
 
 #include "common.hpp"
+#include "interface_registry.hpp"
 
 /*
  * The following code is based on the following sources:
@@ -67,6 +68,30 @@ struct pcaprec_hdr_s {
     uint32_t orig_len; ///< Actual length of the packet.
 };
 
+/**
+ * @enum CaptureFormat
+ * @brief File format of the captures written to the log files.
+ */
+enum class CaptureFormat
+{
+    PCAP,      ///< Legacy pcap: global header and one record header per packet.
+    PCAPNG,    ///< pcapng: Section Header, one Interface Description per device and one Enhanced Packet Block per packet.
+};
+
+/**
+ * @struct pcapng_epb_hdr_s
+ * @brief Represents the fixed part of a pcapng Enhanced Packet Block (before the packet data).
+ */
+struct pcapng_epb_hdr_s {
+    uint32_t block_type;         ///< Block type (0x00000006).
+    uint32_t block_total_length; ///< Size of the whole block, repeated at its end.
+    uint32_t interface_id;       ///< Index of the Interface Description Block of the packet.
+    uint32_t ts_high;            ///< Upper 32 bits of the timestamp (nanoseconds, see if_tsresol).
+    uint32_t ts_low;             ///< Lower 32 bits of the timestamp.
+    uint32_t captured_len;       ///< Number of bytes of packet saved in file.
+    uint32_t orig_len;           ///< Actual length of the packet.
+};
+
 /// IPv4 header template.
 const std::vector<uint8_t> ipv4_header = {0x45, 0x00, 0x00, 0x5B, 0x00, 0x00, 0x00, 0x00, 0x80, 0x11, 0xB7, 0x3B, 0xC0, 0xA8, 0x01, 0x03, 0xC0, 0xA8, 0x01, 0x03};
 
@@ -79,6 +104,36 @@ const std::vector<uint8_t> ti_header = {0x00, 0x3c, 0x00, 0x00};
 /// TI protocol template.
 const std::vector<uint8_t> ti_protocol = {0x00};
 
+// IPv4(20) + UDP(8) + TI header(4) + interface(2) + protocol(1) + phy(1) + frequency(4) + channel(2) + rssi(1) + fcs(1)
+#define PCAP_ENCAPSULATION_SIZE 44
+// Bytes of a record written before the payload (record header and encapsulation)
+#define PCAP_RECORD_HEADER_SIZE (sizeof(pcaprec_hdr_s) + PCAP_ENCAPSULATION_SIZE)
+// Largest record written by PcapBuilder::write_record (record header, encapsulation and payload)
+#define PCAP_RECORD_MAX_SIZE (PCAP_RECORD_HEADER_SIZE + FRAME_DATA_MAX_SIZE)
+// Bytes of an Enhanced Packet Block written before the payload (fixed part and encapsulation)
+#define PCAPNG_EPB_HEADER_SIZE (sizeof(pcapng_epb_hdr_s) + PCAP_ENCAPSULATION_SIZE)
+// Largest part of an Enhanced Packet Block written after the payload (padding, options and block length)
+#define PCAPNG_EPB_TRAILER_MAX_SIZE 64
+
+// TI data frame: SOF 2B | INFO 1B | LENGTH 2B | TIMESTAMP 6B | 0x00 1B | PAYLOAD N B | RSSI 1B | STATUS (FCS) 1B | EOF 2B
+#define TI_FRAME_OVERHEAD 16
+#define TI_TIMESTAMP_OFFSET 5
+#define TI_PAYLOAD_OFFSET 12
+// TI status byte bit set when the FCS of the packet is correct
+#define TI_STATUS_FCS_OK 0x80
+
+/**
+ * @struct ti_frame_s
+ * @brief Fields of the TI data frame held by a packet (see PcapBuilder::parse_frame).
+ */
+struct ti_frame_s {
+    const uint8_t* payload;         ///< Payload inside the packet.
+    size_t payload_size;            ///< Payload size.
+    uint64_t device_timestamp;      ///< Timestamp from the device (microseconds).
+    uint8_t rssi;                   ///< RSSI byte (signed dBm).
+    uint8_t status;                 ///< Status byte (TI_STATUS_FCS_OK when the FCS is correct).
+};
+
 /**
  * @class PcapBuilder
  * @brief Provides methods to build and write pcap files.
@@ -86,6 +141,30 @@ const std::vector<uint8_t> ti_protocol = {0x00};
 class PcapBuilder
 {
 public:
+    /**
+     * @brief Reads the fields of the TI data frame held by a packet.
+     * - Every output that looks into the frame (pcap, pcapng, shared memory ring, duplicate filter) goes through it.
+     * 
+     * @param packet The packet information.
+     * @param frame Set to the fields of the frame.
+     * @return true if the packet is long enough to be a data frame, false otherwise.
+     */
+    static bool parse_frame(const packet_queue_s& packet, ti_frame_s& frame)
+    {
+        if (packet.length < TI_FRAME_OVERHEAD) return false;
+        frame.payload = packet.packet + TI_PAYLOAD_OFFSET;
+        frame.payload_size = packet.length - TI_FRAME_OVERHEAD;
+        // Timestamp is in little endian
+        frame.device_timestamp = 0;
+        for (size_t i = 0; i < 6; i++)
+        {
+            frame.device_timestamp |= static_cast<uint64_t>(packet.packet[TI_TIMESTAMP_OFFSET + i]) << (i * 8);
+        }
+        frame.rssi = packet.packet[packet.length - 4];
+        frame.status = packet.packet[packet.length - 3];
+        return true;
+    }
+
     /**
      * @brief Gets the global header to a pcap file.
      * 
@@ -101,7 +180,32 @@ public:
      * @param start_time The start time of the capture.
      * @return std::vector<uint8_t> The packet header data.
      */
-    static std::vector<uint8_t> get_packet_header(packet_queue_s packet, std::chrono::microseconds start_time);
+    static std::vector<uint8_t> get_packet_header(const packet_queue_s& packet, std::chrono::microseconds start_time);
+
+    /**
+     * @brief Writes a complete pcap record (packet header and packet data) into a buffer.
+     * - Produces the same bytes as get_packet_header followed by get_packet_data, but parses the frame once and allocates nothing.
+     * 
+     * @param packet The packet information.
+     * @param start_time The start time of the capture.
+     * @param buffer Buffer where the record is written.
+     * @param buffer_size Size of the buffer (PCAP_RECORD_MAX_SIZE is always enough).
+     * @return size_t Number of bytes written, or 0 if the packet is not a valid data frame or the buffer is too small.
+     */
+    static size_t write_record(const packet_queue_s& packet, std::chrono::microseconds start_time, uint8_t* buffer, size_t buffer_size);
+
+    /**
+     * @brief Writes everything of a pcap record except the payload into a buffer (PCAP_RECORD_HEADER_SIZE bytes).
+     * - Lets vectored writers send the payload straight from the packet, without copying it.
+     * 
+     * @param packet The packet information.
+     * @param start_time The start time of the capture.
+     * @param buffer Buffer where the record header and encapsulation are written (at least PCAP_RECORD_HEADER_SIZE bytes).
+     * @param payload Set to the payload inside packet.
+     * @param payload_size Set to the payload size.
+     * @return true if the packet is a valid data frame, false otherwise.
+     */
+    static bool write_record_header(const packet_queue_s& packet, std::chrono::microseconds start_time, uint8_t* buffer, const uint8_t** payload, size_t* payload_size);
 
     /**
      * @brief Gets the packet data to a pcap file.
@@ -109,6 +213,41 @@ public:
      * @param packet The packet information.
      * @return std::vector<uint8_t> The packet data.
      */
-    static std::vector<uint8_t> get_packet_data(packet_queue_s packet);
+    static std::vector<uint8_t> get_packet_data(const packet_queue_s& packet);
+
+    /**
+     * @brief Gets the Section Header Block that starts a pcapng file.
+     * 
+     * @return std::vector<uint8_t> The Section Header Block.
+     */
+    static std::vector<uint8_t> get_section_header();
+
+    /**
+     * @brief Gets the Interface Description Block of a device for a pcapng file.
+     * - The interface is named after the serial port and described by its radio mode, channel and frequency.
+     * - Timestamps of the interface are in nanoseconds (if_tsresol = 9).
+     * 
+     * @param interface The registered interface of the device.
+     * @return std::vector<uint8_t> The Interface Description Block.
+     */
+    static std::vector<uint8_t> get_interface_description(const interface_entry_s& interface);
+
+    /**
+     * @brief Writes an Enhanced Packet Block, except the payload, into two buffers.
+     * - The header buffer gets the fixed part of the block and the encapsulation (PCAPNG_EPB_HEADER_SIZE bytes).
+     * - The trailer buffer gets the padding, the options (epb_flags with the FCS result and a comment with the RSSI) and the block length.
+     * - Lets vectored writers send the payload straight from the packet, between the two buffers.
+     * 
+     * @param packet The packet information.
+     * @param interface_index Index of the Interface Description Block of the packet in the file.
+     * @param start_time The start time of the capture.
+     * @param header Buffer where the header is written (at least PCAPNG_EPB_HEADER_SIZE bytes).
+     * @param trailer Buffer where the trailer is written (at least PCAPNG_EPB_TRAILER_MAX_SIZE bytes).
+     * @param trailer_size Set to the trailer size.
+     * @param payload Set to the payload inside packet.
+     * @param payload_size Set to the payload size.
+     * @return true if the packet is a valid data frame, false otherwise.
+     */
+    static bool write_enhanced_packet(const packet_queue_s& packet, uint32_t interface_index, std::chrono::microseconds start_time, uint8_t* header, uint8_t* trailer, size_t* trailer_size, const uint8_t** payload, size_t* payload_size);
 };
 
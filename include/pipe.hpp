@@ -16,6 +16,8 @@
 #include <cstdint> // for uint8_t
 #include <string>  // for std::string
 
+#include "record_batch.hpp"
+
 #ifdef __linux__
     #include <unistd.h>
     #include <fcntl.h>
@@ -72,12 +74,32 @@ public:
 
     /**
      * @brief Writes data to the pipe.
+     * On Linux, partial writes are resumed and a full pipe is waited on for up to BATCH_WRITE_TIMEOUT_MS.
      * 
      * @param data A vector of bytes to be written to the pipe.
      * @return true if the data was successfully written on the pipe, false otherwise.
      */
     bool write(const std::vector<uint8_t>& data);
 
+    /**
+     * @brief Writes data to the pipe.
+     * 
+     * @param data Bytes to be written to the pipe.
+     * @param size Number of bytes.
+     * @return true if the data was successfully written on the pipe, false otherwise.
+     */
+    bool write(const uint8_t* data, size_t size);
+
+    /**
+     * @brief Writes several buffers to the pipe (a single writev on Linux, as long as the pipe accepts everything).
+     * 
+     * @param iov Buffers to be written. The array is modified while resuming short writes.
+     * @param count Number of buffers.
+     * @param written Set to the number of bytes written (also on failure).
+     * @return true if all buffers were successfully written on the pipe, false otherwise.
+     */
+    bool write(struct iovec* iov, int count, size_t* written);
+
     /**
      * @brief Closes the pipe.
      * 
@@ -14,12 +14,31 @@
 #include <iostream> 
 #include <thread> 
 #include <mutex> 
-#include <queue>
 #include <chrono>
+#include <atomic>
+#include <memory>
+#include <condition_variable>
 
 #include "pipe.hpp"
 #include "common.hpp"
 #include "pcap_builder.hpp"
+#include "ring_queue.hpp"
+#include "frame_pool.hpp"
+#include "record_batch.hpp"
+#include "spill_file.hpp"
+
+// Maximum size of each write of spilled records to the pipe (they are written directly from the spill file mapping)
+#define PIPE_SPILL_WRITE_SIZE (1024 * 1024)
+
+/**
+ * @struct pipe_queue_stats_s
+ * @brief Statistics of the packets of a device that did not fit in the queue of a pipe.
+ */
+struct pipe_queue_stats_s {
+    int device_id;              ///< Device that captured the packets.
+    uint64_t dropped;           ///< Packets discarded by the queue policy.
+    uint64_t spilled;           ///< Packets written to the spill file.
+};
 
 /**
  * @brief Handles packets received that needs to be sent through a named pipe.
@@ -27,39 +46,102 @@
 class PipePacketHandler
 {
 public:
-    bool is_running = false; ///< Flag indicating if the packet handler is running.
-    std::queue<packet_queue_s> packet_queue; ///< Queue for storing incoming packets.
-    std::vector<packet_queue_s> key_packets; ///< Vector for storing transport key packets.
-    std::chrono::time_point<std::chrono::system_clock> start_time; ///< Start time of packet handling.
+    std::atomic<bool> is_running{false}; ///< Flag indicating if the packet handler is running.
+    RingQueue<FrameRef> packet_queue; ///< Queue for storing incoming packets (shared with the other outputs).
+    std::vector<FrameRef> key_packets; ///< Vector for storing transport key packets.
     
     /**
      * @brief Constructs a PipePacketHandler object.
      * 
      * @param pipe_path The path to the named pipe.
      * @param base      The base string for the name. The id could be appended to this string.
-     * @param start_time The start time of packet handling.
+     * @param num_devices Number of devices (packets are counted by their device id).
+     * @param max_packets Maximum number of packets queued in memory (the byte budget divided by the size of a frame).
+     * @param policy    What to do with a packet when the queue is full.
+     * @param spill_path Path of the spill file (only created with the spill policy).
+     * @param spill_size Maximum number of bytes of packets kept in the spill file.
+     * @param spill_recover Keep the spilled packets not sent for the next run, and send the ones of a previous run.
+     * @param frame_pool Pool the queued frames are taken from, checked so the pipe gives frames back when it is low (optional).
      */
-    PipePacketHandler(std::string pipe_path, std::string base, std::chrono::time_point<std::chrono::system_clock> start_time);
+    PipePacketHandler(std::string pipe_path, std::string base, int num_devices, size_t max_packets, QueuePolicy policy, std::string spill_path, uint64_t spill_size, bool spill_recover, FramePool* frame_pool = nullptr);
 
 
     /**
      * @brief Adds a packet to the packet queue.
      * 
-     * @param packet The packet to add.
+     * - When the queue is full the packet is handled by the queue policy: the oldest or the new packet is dropped,
+     *   or the packet is written to the spill file (and so are the next ones until the file is sent).
+     * - Never waits for room: it is called by the output thread, which also feeds the other outputs. The block policy is not supported.
+     * - With the spill policy, the packets are also written to the spill file while there is no consumer, so the backlog does not use memory.
+     * - While the frame pool is low, the oldest queued packet is dropped for each new one (or the new one is spilled), whatever the policy.
+     * 
+     * @param frame The frame with the packet to add. Only the reference is queued.
      * @param isTransportKey Bool flag indicating if the packet is a transport key packet
      */
-    void add_packet(packet_queue_s packet, bool isTransportKey = false);
+    void add_packet(const FrameRef& frame, bool isTransportKey = false);
+
+    /**
+     * @brief Gets the number of dropped and spilled packets of each device.
+     * 
+     * @return Vector with the statistics of each device.
+     */
+    std::vector<pipe_queue_stats_s> get_queue_stats();
 
     /**
      * @brief Starts the packet handling process.
+     * - Takes the whole pending queue at once (swapping it under the lock) and writes it outside the lock.
+     * - Waits on a condition variable while the queue is empty.
      */
     void run();
 
+    /**
+     * @brief Asks the run method to finish and wakes it up if it is waiting for packets.
+     */
+    void stop();
+
 private:
-    int queue_max_size = 500000; ///< Maximum size of the packet queue. - May be useful to avoid memory issues in high packet flow situations (such as BLE).
+    size_t queue_max_size; ///< Maximum number of packets queued in memory (including the ones being written), from the byte budget of the pipe.
+    QueuePolicy queue_policy; ///< What to do with a packet when the queue is full.
+    FramePool* frame_pool; ///< Pool the queued frames are taken from (null to never check it).
     std::mutex m_mutex; ///< Mutex for thread synchronization.
+    std::condition_variable queue_cv; ///< Signaled when packets are added or the handler is stopped.
+    size_t writing = 0; ///< Number of packets taken from the queue that are being written.
+    std::vector<uint64_t> dropped; ///< Packets of each device discarded by the queue policy.
+    std::vector<uint64_t> spilled; ///< Packets of each device written to the spill file.
+    bool connected = false; ///< A consumer is connected to the pipe (guarded by m_mutex).
+    SpillFile spill; ///< Packets that did not fit in the queue or arrived without consumer (spill policy).
+    std::vector<uint8_t> spill_record; ///< Record of the packet being spilled.
     Pipe pipe; ///< Named pipe interface.
     std::string pipe_path; ///< Path to the named pipe.
     std::string base; ///< Base string.
     bool is_open = false; ///< Flag indicating if the named pipe is open.
+    RecordBatch record_batch; ///< Records written to the pipe with a single vectored write.
+    std::vector<size_t> record_positions; ///< Position in write_queue of each record in record_batch.
+    RingQueue<FrameRef> write_queue; ///< Packets being written (swapped with packet_queue, so both buffers are reused).
+
+    /**
+     * @brief Puts packets that could not be written back at the front of the queue, keeping their order.
+     * 
+     * @param pending Packets not written yet.
+     */
+    void requeue_front(RingQueue<FrameRef>& pending);
+
+    /**
+     * @brief Writes a packet to the spill file. Must be called with m_mutex locked.
+     * 
+     * @param frame The frame with the packet.
+     */
+    void spill_packet(const FrameRef& frame);
+
+    /**
+     * @brief Writes the spilled packets to the pipe, in chunks written directly from the spill file mapping.
+     * 
+     * @return true if the spill file was completely written, false if a write failed.
+     */
+    bool write_spilled();
+
+    /**
+     * @brief Counts a packet for its device.
+     */
+    static void count(std::vector<uint64_t>& counters, int id) { if (id >= 0 && id < (int)counters.size()) counters[id]++; }
 };
@@ -0,0 +1,107 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <memory>
+
+#include "common.hpp"
+#include "device.hpp"
+
+/**
+ * @class Reactor
+ * @brief Single threaded event loop that streams from many devices at once.
+ * - Every device serial descriptor is registered in one epoll instance.
+ * - When a descriptor is readable the device stream_step is called, which reads everything available and runs the device framer incrementally.
+ * - Devices that lose the connection are removed from the loop. Each one is reconnected by its own worker thread, which
+ *   retries every 10 seconds (the handshake blocks), and is given back to the loop through an eventfd, so the other devices are never stalled.
+ * 
+ * Only available on Linux. On other platforms the Sniffer falls back to one thread per device.
+ */
+class Reactor
+{
+public:
+    /**
+     * @brief Constructs a new Reactor object.
+     * 
+     * @param coutMutex Mutex for devices logs on debug mode.
+     */
+    Reactor(std::mutex &coutMutex);
+
+    /**
+     * @brief Destroys the Reactor object and closes the epoll instance.
+     */
+    ~Reactor();
+
+    /**
+     * @brief Adds a started device to the loop.
+     * - Bytes already buffered by the device (e.g. frames received together with the start response) are processed right away.
+     * 
+     * @param device Device to be added. Must outlive the reactor.
+     * @return true if the device was added, false otherwise.
+     */
+    bool add(Device* device);
+
+    /**
+     * @brief Runs the loop until an interruption is received, the duration expires or no devices are left.
+     * 
+     * @param duration Duration to run. A negative value runs indefinitely.
+     */
+    void run(std::chrono::seconds duration);
+
+private:
+    /**
+     * @struct lost_device_s
+     * @brief A device that lost the connection and is being reconnected by a worker thread.
+     */
+    struct lost_device_s {
+        Device* device;                         ///< Device that lost the connection.
+        std::thread worker;                     ///< Thread retrying the reconnection.
+    };
+
+    int epoll_fd;                               ///< Epoll instance descriptor.
+    int wake_fd = -1;                           ///< Eventfd written by the workers when a device is reconnected.
+    int active_devices = 0;                     ///< Number of devices registered in the epoll instance.
+    std::vector<lost_device_s> lost_devices;    ///< Devices being reconnected (only used by the loop thread).
+    std::vector<Device*> reconnected;           ///< Devices reconnected by their worker and not added back yet.
+    std::mutex reconnected_mutex;               ///< Protects reconnected.
+    std::atomic<bool> stopping{false};          ///< Tells the workers to give up.
+    std::mutex &coutMutex;                      ///< Mutex for devices logs on debug mode.
+
+    /**
+     * @brief Removes a device that lost the connection from the loop and schedules its reconnection.
+     * 
+     * @param device Device that lost the connection.
+     */
+    void lose(Device* device);
+
+    /**
+     * @brief Retries the reconnection of a device every 10 seconds until it succeeds or the reactor stops (worker thread).
+     * 
+     * @param device Device to be reconnected.
+     */
+    void reconnect(Device* device);
+
+    /**
+     * @brief Adds the devices reconnected by the workers back to the loop and joins their workers.
+     */
+    void add_reconnected_devices();
+
+    /**
+     * @brief Stops and joins every reconnection worker.
+     */
+    void stop_workers();
+};
@@ -0,0 +1,136 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+
+#include "common.hpp"
+#include "frame_pool.hpp"
+#include "pcap_builder.hpp"
+
+#ifdef __linux__
+    #include <sys/uio.h>
+#endif
+
+#ifdef _WIN32
+    /// Same layout as the POSIX iovec, so the batch can be built the same way on every platform.
+    struct iovec {
+        void* iov_base;    ///< Start of the data.
+        size_t iov_len;    ///< Size of the data.
+    };
+#endif
+
+// Maximum number of records in a batch (up to three iovecs per record, below the usual IOV_MAX of 1024)
+#define RECORD_BATCH_MAX_RECORDS 256
+// Maximum wait for a non-blocking descriptor (e.g. a FIFO) to accept more data
+#define BATCH_WRITE_TIMEOUT_MS 1000
+
+/**
+ * @brief Writes every byte described by the iovecs to a descriptor, using as few writev calls as possible.
+ * - Short writes are resumed from where they stopped.
+ * - On EAGAIN (non-blocking descriptors) waits up to timeout_ms for the descriptor to accept more data.
+ * - Linux only.
+ * 
+ * @param fd Descriptor to write to.
+ * @param iov Data to be written. The array is modified while resuming short writes.
+ * @param count Number of iovecs.
+ * @param timeout_ms Maximum wait while the descriptor is full.
+ * @param written Set to the number of bytes written (also on failure). May be null.
+ * @return true if everything was written, false otherwise.
+ */
+bool writev_all(int fd, struct iovec* iov, int count, int timeout_ms, size_t* written);
+
+/**
+ * @class RecordBatch
+ * @brief Collects pcap records (or pcapng Enhanced Packet Blocks) so many of them are written with a single vectored write.
+ * - Each pcap record takes two iovecs: its header (record header and encapsulation, built in the batch) and the payload, sent straight from the pooled frame.
+ * - Each pcapng block takes a third iovec for its trailer (padding, options and block length, also built in the batch).
+ * - The frames are referenced until the batch is cleared.
+ */
+class RecordBatch
+{
+public:
+    /**
+     * @brief Constructs a new RecordBatch object, allocating room for max_records records.
+     * 
+     * @param max_records Maximum number of records in the batch.
+     * @param format Format of the records.
+     */
+    explicit RecordBatch(size_t max_records = RECORD_BATCH_MAX_RECORDS, CaptureFormat format = CaptureFormat::PCAP);
+
+    /**
+     * @brief Adds the record of a packet to the batch.
+     * 
+     * @param frame Frame with the packet.
+     * @param start_time The start time of the capture.
+     * @param interface_index Index of the Interface Description Block of the packet (pcapng only).
+     * @return true if the record was added, false if the batch is full or the packet is not a valid data frame.
+     */
+    bool add(const FrameRef& frame, std::chrono::microseconds start_time, uint32_t interface_index = 0);
+
+    /**
+     * @brief Writes every record to a log file (after flushing what was written to it through stdio).
+     * 
+     * @param file Log file.
+     * @return true if all records were written, false otherwise.
+     */
+    bool write_to(FILE* file);
+
+    /**
+     * @brief Gets the iovecs of the records (two or three per record, depending on the format), e.g. to be written to a pipe.
+     */
+    struct iovec* iovecs() { return iov.data(); }
+
+    /**
+     * @brief Gets the number of iovecs in use.
+     */
+    int iovec_count() const { return (int)(records * iovecs_per_record); }
+
+    /**
+     * @brief Gets how many complete records fit in the first bytes of the batch (e.g. after a failed write).
+     * 
+     * @param bytes Number of bytes written.
+     * @return size_t Number of complete records.
+     */
+    size_t records_within(size_t bytes) const;
+
+    /**
+     * @brief Removes every record, releasing the frames.
+     */
+    void clear();
+
+    bool empty() const { return records == 0; }
+    bool full() const { return records == max_records; }
+    size_t size() const { return records; }
+
+    /**
+     * @brief Gets the number of bytes of the records in the batch.
+     */
+    size_t bytes() const { return byte_count; }
+
+private:
+    size_t max_records;                     ///< Maximum number of records.
+    CaptureFormat format;                   ///< Format of the records.
+    size_t header_size;                     ///< Bytes reserved for the header of each record.
+    size_t iovecs_per_record;               ///< Two for pcap (header and payload), three for pcapng (header, payload and trailer).
+    size_t records = 0;                     ///< Number of records in the batch.
+    size_t byte_count = 0;                  ///< Bytes of the records in the batch.
+    std::vector<uint8_t> headers;           ///< Record headers (header_size bytes per record).
+    std::vector<uint8_t> trailers;          ///< Block trailers (PCAPNG_EPB_TRAILER_MAX_SIZE bytes per record, pcapng only).
+    std::vector<struct iovec> iov;          ///< Iovecs of the records.
+    std::vector<FrameRef> frames;           ///< Frames referenced by the payload iovecs.
+};
@@ -0,0 +1,120 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+#include "pcap_builder.hpp"
+
+// Link types that can be replayed: the TI encapsulation written by tuxniffer, and IEEE 802.15.4 with and without FCS
+#define REPLAY_LINKTYPE_TI 228
+#define REPLAY_LINKTYPE_IEEE802_15_4 195
+#define REPLAY_LINKTYPE_IEEE802_15_4_NOFCS 230
+
+/**
+ * @class ReplaySource
+ * @brief Reads the packets of a pcap or pcapng file and rebuilds the sniffer frames (TI framing) the device would have sent.
+ * - Supports the files written by tuxniffer (TI encapsulation, link type 228), keeping the RSSI and status of each packet,
+ *   and IEEE 802.15.4 captures (link types 195 and 230), which get an RSSI of 0 and a FCS OK status.
+ * - The device timestamp of the frames counts from the first packet. The capture time of each packet is returned with it
+ *   (in UTC: the time zone that tuxniffer adds to its pcap files is removed).
+ * - Packets can be paced to the capture times (speed 1 is real time) or read as fast as possible (speed 0).
+ */
+class ReplaySource
+{
+public:
+    /**
+     * @brief Constructs a new ReplaySource object.
+     * 
+     * @param path Path of the capture file.
+     * @param speed Replay speed relative to the capture (1 for real time, 2 for twice as fast), or 0 to read as fast as possible.
+     */
+    ReplaySource(const std::string& path, double speed);
+
+    /**
+     * @brief Closes the capture file.
+     */
+    ~ReplaySource();
+
+    /**
+     * @brief Opens the capture file and reads its header.
+     * 
+     * @return true if the file is a pcap or pcapng file, false otherwise.
+     */
+    bool open();
+
+    /**
+     * @brief Closes the capture file.
+     */
+    void close();
+
+    /**
+     * @brief Rebuilds the frame of the next packet of the file.
+     * - Packets of link types that cannot be replayed, or too large for a frame, are skipped.
+     * 
+     * @param frame Set to the frame (SOF, INFO, LENGTH, TIMESTAMP, PAYLOAD, RSSI, STATUS and EOF).
+     * @param capture_time Set to the capture time of the packet.
+     * @return true if a frame was read, false at the end of the file.
+     */
+    bool next_frame(std::vector<uint8_t>& frame, std::chrono::system_clock::time_point& capture_time);
+
+    /**
+     * @brief Waits until a packet is due, when the replay is paced.
+     * 
+     * @param capture_time Capture time of the packet.
+     * @return true when the packet is due, false if the capture was interrupted while waiting.
+     */
+    bool wait(std::chrono::system_clock::time_point capture_time);
+
+    /**
+     * @brief Gets the number of packets that could not be replayed.
+     */
+    uint64_t get_skipped() const { return skipped; }
+
+private:
+    std::string path;                               ///< Path of the capture file.
+    double speed;                                   ///< Replay speed (0 to read as fast as possible).
+    FILE* file = nullptr;                           ///< Capture file.
+    CaptureFormat format = CaptureFormat::PCAP;     ///< Format of the capture file.
+    uint32_t link_type = 0;                         ///< Link type of a pcap file.
+    uint32_t snaplen = 0;                           ///< Longest record of a pcap file.
+    bool nanoseconds = false;                       ///< Indicates that the timestamps of a pcap file are in nanoseconds.
+    std::vector<uint32_t> interface_link_types;     ///< Link type of each interface of the current pcapng section.
+    std::vector<uint64_t> interface_ticks;          ///< Timestamp units per second of each interface of the current pcapng section.
+    std::vector<uint8_t> record;                    ///< Data of the record being read (reused between records).
+    uint64_t skipped = 0;                           ///< Packets that could not be replayed.
+    bool started = false;                           ///< Indicates that the first packet was read.
+    int64_t first_time = 0;                         ///< Capture time (UTC microseconds) of the first packet.
+    std::chrono::steady_clock::time_point start;    ///< When the first packet was read (start of the pacing).
+
+    /**
+     * @brief Reads the next packet of the file, whatever its link type.
+     * 
+     * @param type Set to the link type of the packet.
+     * @param length Set to the number of bytes of the packet (in record).
+     * @param timestamp Set to the capture time as written in the file (microseconds).
+     * @return true if a packet was read, false at the end of the file.
+     */
+    bool next_record(uint32_t& type, size_t& length, int64_t& timestamp);
+
+    /**
+     * @brief Reads a pcapng Interface Description Block (link type and timestamp resolution).
+     * 
+     * @param body Body of the block (after the block type and length).
+     * @param size Size of the body.
+     */
+    void add_interface(const uint8_t* body, size_t size);
+};
@@ -0,0 +1,102 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+/**
+ * @class RingQueue
+ * @brief FIFO queue stored in a circular buffer that is reused between pushes and pops.
+ * - Unlike std::queue (std::deque), it only allocates memory when it grows, so a queue that reached its working size never allocates again.
+ * - It is not thread safe.
+ * 
+ * @tparam T Item type. Must be default constructible and movable.
+ */
+template <typename T>
+class RingQueue
+{
+public:
+    /**
+     * @brief Adds an item to the end of the queue, growing the buffer if it is full.
+     * 
+     * @param item Item to be added.
+     */
+    void push(T item)
+    {
+        if (count == slots.size()) grow();
+        slots[(first + count) % slots.size()] = std::move(item);
+        count++;
+    }
+
+    /**
+     * @brief Removes the first item of the queue. The queue must not be empty.
+     * - The slot is reset, so resources held by the item are released right away.
+     */
+    void pop()
+    {
+        slots[first] = T();
+        first = (first + 1) % slots.size();
+        count--;
+    }
+
+    /**
+     * @brief Gets the first item of the queue. The queue must not be empty.
+     */
+    T& front() { return slots[first]; }
+
+    /**
+     * @brief Gets a queued item by its position (0 is the first item). The position must be below size().
+     */
+    T& operator[](size_t index) { return slots[(first + index) % slots.size()]; }
+
+    /**
+     * @brief Checks if the queue is empty.
+     */
+    bool empty() const { return count == 0; }
+
+    /**
+     * @brief Gets the number of queued items.
+     */
+    size_t size() const { return count; }
+
+    /**
+     * @brief Removes every item, keeping the buffer.
+     */
+    void clear()
+    {
+        while (count > 0) pop();
+        first = 0;
+        count = 0;
+    }
+
+private:
+    std::vector<T> slots;   ///< Circular buffer.
+    size_t first = 0;       ///< Index of the first item.
+    size_t count = 0;       ///< Number of queued items.
+
+    /**
+     * @brief Doubles the buffer, moving the items to its beginning.
+     */
+    void grow()
+    {
+        std::vector<T> bigger(slots.empty() ? 64 : slots.size() * 2);
+        for (size_t i = 0; i < count; i++)
+        {
+            bigger[i] = std::move(slots[(first + i) % slots.size()]);
+        }
+        slots.swap(bigger);
+        first = 0;
+    }
+};
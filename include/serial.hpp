@@ -32,7 +32,7 @@
 #define INVALID_FILE_DESCRIPTOR  (-1)
 #endif
 
-#define BUFFER_SIZE 1024
+#define BUFFER_SIZE 4096
 
 #include "common.hpp"
 
@@ -47,6 +47,9 @@ public:
     TYPE_FILE_DESCRIPTOR descriptor;  ///< File descriptor for the serial port.
     TYPE_FILE_CONFIG config;          ///< Configuration for the serial port.
     uint8_t buffer[BUFFER_SIZE];      ///< Buffer for serial data.
+    size_t buffer_start = 0;          ///< Index of the next unread byte in buffer.
+    size_t buffer_end = 0;            ///< Index one past the last valid byte in buffer.
+    uint64_t read_calls = 0;          ///< Number of read calls issued to the OS (used for benchmarking).
     std::string port;                 ///< Serial port identifier.
 
     /**
@@ -97,6 +100,7 @@ public:
 
     /**
      * @brief Reads data from the serial port.
+     * - Bytes already held in the internal buffer are returned first.
      * 
      * @return std::vector<uint8_t> The data read from the port.
      */
@@ -104,13 +108,53 @@ public:
 
     /**
      * @brief Reads a single byte from the serial port.
+     * - The byte is taken from the internal buffer, which is refilled with a single bulk read when empty.
      * 
      * @param byte Pointer to the byte where the read data will be stored.
-     * @return true if read is successful.
-     * @return false if read fails.
+     * @return 1 if a byte was read.
+     * @return 0 if there is no data available.
+     * @return -1 if the connection was lost.
      */
     int readByte(uint8_t* byte);
 
+    /**
+     * @brief Refills the internal buffer with everything the OS has available for the port (up to BUFFER_SIZE).
+     * - Must only be called when the buffer is empty (see hasBufferedData), otherwise unread bytes are discarded.
+     * 
+     * @return Number of bytes read, 0 if there is no data available or -1 if the connection was lost.
+     */
+    int fillBuffer();
+
+    /**
+     * @brief Blocks until the port has data to read, the connection drops or the timeout expires.
+     * - On Linux it waits on the descriptor readiness with poll(), so no CPU is used while the port is idle.
+     * - On Windows it sleeps for a short period (at most 10 ms) and lets the caller try to read.
+     * 
+     * @param timeout Maximum time to wait.
+     * @return true if the port is ready to be read (data or hang up), false if the timeout expired.
+     */
+    bool waitForData(std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Checks if there are unread bytes in the internal buffer.
+     * 
+     * @return true if there is at least one unread byte.
+     */
+    bool hasBufferedData() const { return buffer_start < buffer_end; }
+
+    /**
+     * @brief Takes the next unread byte from the internal buffer without touching the port.
+     * 
+     * @param byte Pointer to the byte where the data will be stored.
+     * @return true if a byte was taken, false if the buffer is empty.
+     */
+    bool nextBufferedByte(uint8_t* byte)
+    {
+        if (buffer_start >= buffer_end) return false;
+        *byte = buffer[buffer_start++];
+        return true;
+    }
+
     /**
      * @brief Flushes the serial port buffer.
      */
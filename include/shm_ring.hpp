@@ -0,0 +1,233 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+/**
+ * Layout of the shared memory ring published by Tuxniffer (shm output), and a header-only reader.
+ * Consumers only need this file: it does not depend on the rest of Tuxniffer.
+ * 
+ * Usage:
+ *     ShmRingReader reader;
+ *     if (!reader.open("/aceno")) return;
+ *     while (reader.writer_active())
+ *     {
+ *         const shm_ring_slot_s* slot = reader.peek();
+ *         if (!slot) continue;                    // Nothing new yet (spin, yield or sleep)
+ *         process(slot->data, slot->length);      // Read in place, without copies
+ *         if (!reader.release()) discard();       // The slot was overwritten while it was read
+ *     }
+ */
+
+#include <atomic>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __linux__
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+// Identifies the shared memory ring ("TXSR") and the version of its layout
+#define SHM_RING_MAGIC 0x52535854
+#define SHM_RING_VERSION 1
+// Maximum size of the frame in a slot
+#define SHM_RING_DATA_MAX_SIZE 256
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "The shared memory ring needs lock free 64 bits atomics");
+
+/**
+ * @struct shm_ring_header_s
+ * @brief Header at the start of the shared memory, followed by slot_count slots.
+ */
+struct shm_ring_header_s {
+    uint32_t magic;                             ///< SHM_RING_MAGIC.
+    uint32_t version;                           ///< SHM_RING_VERSION.
+    uint32_t slot_count;                        ///< Number of slots.
+    uint32_t slot_size;                         ///< Size of each slot (sizeof(shm_ring_slot_s)).
+    std::atomic<uint32_t> writer_active;        ///< 1 while the writer is publishing packets.
+    alignas(64) std::atomic<uint64_t> write_sequence; ///< Number of packets published (the sequence of the next packet).
+};
+
+/**
+ * @struct shm_ring_slot_s
+ * @brief A packet in the ring. Packet n is in slot n % slot_count.
+ */
+struct alignas(64) shm_ring_slot_s {
+    std::atomic<uint64_t> sequence;             ///< 2n+1 while packet n is written, 2n+2 once it is published.
+    uint64_t timestamp;                         ///< Capture time (microseconds since the epoch, UTC).
+    uint16_t device_id;                         ///< Device that captured the packet.
+    uint16_t length;                            ///< Bytes used in data.
+    uint8_t channel;                            ///< Channel number.
+    uint8_t mode;                               ///< Radio mode.
+    int8_t rssi;                                ///< RSSI (dBm).
+    uint8_t fcs_ok;                             ///< 1 if the FCS of the frame was correct (checked by the sniffer).
+    uint8_t data[SHM_RING_DATA_MAX_SIZE];       ///< Captured frame (MAC header and payload). The sniffer does not send the FCS: see fcs_ok and rssi instead.
+};
+
+/**
+ * @brief Gets the size of the shared memory of a ring.
+ */
+inline size_t shm_ring_size(uint32_t slot_count)
+{
+    return sizeof(shm_ring_header_s) + (size_t)slot_count * sizeof(shm_ring_slot_s);
+}
+
+/**
+ * @brief Gets a slot of the ring.
+ */
+inline shm_ring_slot_s* shm_ring_slot(shm_ring_header_s* header, uint64_t sequence)
+{
+    return (shm_ring_slot_s*)((uint8_t*)header + sizeof(shm_ring_header_s)) + sequence % header->slot_count;
+}
+
+/**
+ * @class ShmRingReader
+ * @brief Reads the packets of a shared memory ring in place, in order.
+ * - Any number of readers can read a ring. The writer never waits for them: a reader that lags more than the ring
+ *   loses the oldest packets, and a slot may be overwritten while it is read (release tells it).
+ * - Only available on Linux.
+ */
+class ShmRingReader
+{
+public:
+    ShmRingReader() = default;
+    ShmRingReader(const ShmRingReader&) = delete;
+    ShmRingReader& operator=(const ShmRingReader&) = delete;
+
+    /**
+     * @brief Unmaps the ring.
+     */
+    ~ShmRingReader() { close(); }
+
+    /**
+     * @brief Maps a ring.
+     * 
+     * @param name Name of the shared memory (e.g. /aceno).
+     * @param from_oldest Start with the oldest packet in the ring instead of the next one published.
+     * @return true if the ring was mapped, false if it does not exist or is not valid.
+     */
+    bool open(const std::string& name, bool from_oldest = false)
+    {
+        close();
+        #ifdef __linux__
+            int fd = shm_open(name.c_str(), O_RDONLY, 0);
+            if (fd < 0) return false;
+            struct stat info;
+            if (fstat(fd, &info) < 0 || (size_t)info.st_size < sizeof(shm_ring_header_s))
+            {
+                ::close(fd);
+                return false;
+            }
+            void* address = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (address == MAP_FAILED) return false;
+            header = (shm_ring_header_s*)address;
+            map_size = (size_t)info.st_size;
+            if (header->magic != SHM_RING_MAGIC || header->version != SHM_RING_VERSION || header->slot_size != sizeof(shm_ring_slot_s) ||
+                header->slot_count == 0 || shm_ring_size(header->slot_count) > map_size)
+            {
+                close();
+                return false;
+            }
+            next = header->write_sequence.load(std::memory_order_acquire);
+            if (from_oldest) next = next > header->slot_count ? next - header->slot_count : 0;
+            return true;
+        #else
+            (void)name;
+            (void)from_oldest;
+            return false;
+        #endif
+    }
+
+    /**
+     * @brief Unmaps the ring.
+     */
+    void close()
+    {
+        #ifdef __linux__
+            if (header) munmap(header, map_size);
+        #endif
+        header = nullptr;
+        current = nullptr;
+    }
+
+    /**
+     * @brief Gets the next packet, without copying it.
+     * 
+     * @param lost Incremented by the number of packets overwritten before they could be read (optional).
+     * @return const shm_ring_slot_s* The slot of the packet, or nullptr if there is no new packet.
+     */
+    const shm_ring_slot_s* peek(uint64_t* lost = nullptr)
+    {
+        if (!header) return nullptr;
+        while (true)
+        {
+            uint64_t written = header->write_sequence.load(std::memory_order_acquire);
+            if (next >= written) return nullptr;
+
+            // The writer went around the ring: skip to the oldest packet
+            if (written - next > header->slot_count)
+            {
+                if (lost) *lost += written - header->slot_count - next;
+                next = written - header->slot_count;
+            }
+
+            shm_ring_slot_s* slot = shm_ring_slot(header, next);
+            uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+            if (sequence == 2 * next + 2)
+            {
+                current = slot;
+                current_sequence = sequence;
+                return slot;
+            }
+            // Overwritten since write_sequence was read
+            if (lost) (*lost)++;
+            next++;
+        }
+    }
+
+    /**
+     * @brief Finishes reading the packet returned by peek and moves to the next one.
+     * 
+     * @return true if the packet was not overwritten while it was read, false if what was read must be discarded.
+     */
+    bool release()
+    {
+        if (!current) return false;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        bool valid = current->sequence.load(std::memory_order_relaxed) == current_sequence;
+        current = nullptr;
+        next++;
+        return valid;
+    }
+
+    /**
+     * @brief Checks if the writer is still publishing packets.
+     */
+    bool writer_active() const { return header && header->writer_active.load(std::memory_order_acquire) != 0; }
+
+    /**
+     * @brief Gets the sequence of the next packet to be read.
+     */
+    uint64_t sequence() const { return next; }
+
+private:
+    shm_ring_header_s* header = nullptr;        ///< Mapped ring.
+    size_t map_size = 0;                        ///< Size of the mapping.
+    uint64_t next = 0;                          ///< Sequence of the next packet to read.
+    const shm_ring_slot_s* current = nullptr;   ///< Slot returned by peek.
+    uint64_t current_sequence = 0;              ///< Sequence of the slot returned by peek when it was read.
+};
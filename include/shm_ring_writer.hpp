@@ -0,0 +1,70 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+#include "common.hpp"
+#include "shm_ring.hpp"
+
+/**
+ * @class ShmRingWriter
+ * @brief Publishes the captured packets to a shared memory ring (see shm_ring.hpp for the layout and the reader).
+ * - Single writer: it is only used by the output manager thread, and never waits for the readers.
+ * - Each slot is protected by its sequence number, so readers can use the packets in place.
+ * - Only available on Linux.
+ */
+class ShmRingWriter
+{
+public:
+    /**
+     * @brief Constructs a new ShmRingWriter object.
+     * 
+     * @param name Name of the shared memory (e.g. /aceno).
+     * @param slot_count Number of packets kept in the ring.
+     */
+    ShmRingWriter(std::string name, uint32_t slot_count);
+
+    /**
+     * @brief Marks the ring as inactive and removes the shared memory (readers keep their mapping).
+     */
+    ~ShmRingWriter();
+
+    /**
+     * @brief Creates and maps the shared memory.
+     * 
+     * @return true if the ring is ready, false otherwise.
+     */
+    bool open();
+
+    /**
+     * @brief Publishes a packet.
+     * 
+     * @param packet Packet to publish.
+     * @param start_time Time added to the device timestamp to get the capture time (UTC).
+     */
+    void publish(const packet_queue_s& packet, std::chrono::microseconds start_time);
+
+    /**
+     * @brief Gets the number of packets published.
+     */
+    uint64_t published() const { return sequence; }
+
+private:
+    std::string name;                       ///< Name of the shared memory.
+    uint32_t slot_count;                    ///< Number of slots.
+    shm_ring_header_s* header = nullptr;    ///< Mapped ring.
+    uint64_t sequence = 0;                  ///< Sequence of the next packet.
+};
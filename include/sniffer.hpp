@@ -62,6 +62,14 @@ public:
      */
     void streamAll(std::chrono::seconds duration);
 
+    /**
+     * @brief Starts streaming on all devices using a single event loop (Reactor) instead of one thread per device.
+     * - Only available on Linux. On other platforms it falls back to streamAll.
+     * 
+     * @param duration The duration to stream for. A negative value runs indefinitely.
+     */
+    void streamAllReactor(std::chrono::seconds duration);
+
 private:
     int device_id_counter = 0;  ///< Counter for assigning unique IDs to devices.
 };
@@ -0,0 +1,150 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _WIN32
+    #include <windows.h>
+#endif
+
+// Identifies a spill file and the version of its layout
+#define SPILL_FILE_MAGIC "TUXSPILL"
+#define SPILL_FILE_VERSION 2
+// Offset of the records in the spill file (the first page holds the header)
+#define SPILL_FILE_DATA_OFFSET 4096
+// Record length that marks the end of the file as unused, when the next record did not fit before it
+#define SPILL_FILE_PADDING 0xFFFFFFFF
+
+/**
+ * @struct spill_header_s
+ * @brief Header at the start of a spill file, with the offsets of the records that were not sent yet.
+ * - The offsets count every byte ever appended, so they only grow. The position of an offset in the file is the offset modulo the capacity,
+ *   relative to SPILL_FILE_DATA_OFFSET.
+ * - A record is copied to the file before write_offset includes it, and read_offset only moves after the records were sent,
+ *   so the header always describes complete records, even if the process crashes.
+ */
+struct spill_header_s {
+    char magic[8];              ///< SPILL_FILE_MAGIC.
+    uint32_t version;           ///< SPILL_FILE_VERSION.
+    uint32_t reserved;          ///< Always 0.
+    uint64_t capacity;          ///< Bytes available for records (the positions depend on it).
+    uint64_t read_offset;       ///< Offset of the oldest record not sent.
+    uint64_t write_offset;      ///< Offset where the next record is appended.
+};
+
+/**
+ * @class SpillFile
+ * @brief FIFO of pcap records kept in a memory-mapped file, used when a pipe has no consumer or its queue is over the memory budget.
+ * - The file is a ring: records are appended after the newest one and read back from the oldest, in the same order, directly from the mapping.
+ * - A record never wraps around the end of the file. When it does not fit before the end, the end is marked as padding and the record goes to the start.
+ * - Only with recovery enabled, the records not sent are kept when the object is destroyed and sent by the next run (also after a crash).
+ *   Otherwise a previous file is discarded when opened, and the file is removed when the object is destroyed. It is not thread safe.
+ */
+class SpillFile
+{
+public:
+    /**
+     * @brief Constructs a new SpillFile object. The file is only mapped by open or by the first append.
+     * 
+     * @param path Path of the spill file.
+     * @param capacity Maximum number of bytes of records kept in the file.
+     * @param recover Keep the records not sent for the next run, and send the ones of a previous run.
+     */
+    SpillFile(const std::string& path, uint64_t capacity, bool recover);
+
+    /**
+     * @brief Unmaps the spill file, and removes it unless recovery is enabled and there are records not sent.
+     */
+    ~SpillFile();
+
+    /**
+     * @brief Creates and maps the spill file. With recovery enabled, the records of a previous run that were not sent are kept.
+     * 
+     * @return true if the file is mapped, false otherwise.
+     */
+    bool open();
+
+    /**
+     * @brief Appends a record after the newest one, wrapping to the start of the file when it does not fit before the end.
+     * 
+     * @param record Complete pcap record (record header and data).
+     * @param size Size of the record.
+     * @return true if the record was written, false if the file could not be mapped or has no room for it.
+     */
+    bool append(const uint8_t* record, size_t size);
+
+    /**
+     * @brief Gets the oldest records, without removing them.
+     * - Only the records before the end of the file are returned, since they must be contiguous.
+     * - The records stay valid (the mapping never moves and appends only write where there are no records) until they are consumed.
+     * 
+     * @param max_size Maximum number of bytes.
+     * @param size Set to the number of bytes of the complete records returned.
+     * @return const uint8_t* Pointer to the oldest record, or nullptr if the file is empty.
+     */
+    const uint8_t* front(size_t max_size, size_t* size) const;
+
+    /**
+     * @brief Removes the oldest records, after they were sent.
+     * 
+     * @param size Number of bytes returned by front to remove (must end at a record boundary).
+     */
+    void consume(size_t size);
+
+    /**
+     * @brief Checks if there is no record in the file.
+     */
+    bool empty() const { return !header || header->read_offset == header->write_offset; }
+
+    /**
+     * @brief Gets the number of bytes of records in the file (including the padding between them).
+     */
+    uint64_t size() const { return header ? header->write_offset - header->read_offset : 0; }
+
+private:
+    std::string path;                   ///< Path of the spill file.
+    uint64_t capacity;                  ///< Bytes available for records.
+    bool recover_records;               ///< Keep the records not sent for the next run.
+    bool open_failed = false;           ///< The file could not be mapped (it is not tried again).
+    spill_header_s* header = nullptr;   ///< Header at the start of the mapping.
+    uint8_t* data = nullptr;            ///< Records in the mapping.
+    #ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;     ///< Spill file.
+        HANDLE mapping = NULL;                  ///< Mapping of the spill file.
+    #else
+        int file = -1;                          ///< Spill file descriptor.
+    #endif
+
+    /**
+     * @brief Checks the records of a previous run, keeping the ones before the first invalid record.
+     * 
+     * @return true if the header and records are valid, false if the file must be reset.
+     */
+    bool recover();
+
+    /**
+     * @brief Gets the offset of the record at an offset, skipping the padding at the end of the file.
+     * 
+     * @param offset Offset of a record or of the padding before the end of the file.
+     * @return uint64_t Offset of the record (the same offset if there is no padding or no record).
+     */
+    uint64_t skip_padding(uint64_t offset) const;
+
+    /**
+     * @brief Unmaps and closes the file.
+     */
+    void close();
+};
@@ -0,0 +1,151 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// Size used to keep producer and consumer indexes in different cache lines
+#define CACHE_LINE_SIZE 64
+
+/**
+ * @class SpscRing
+ * @brief Lock-free bounded queue for exactly one producer thread and one consumer thread.
+ * - The storage is rounded up to a power of two so indexes can be masked instead of divided, but the ring never holds more items than the capacity asked for.
+ * - The producer and the consumer each own one index and keep a cached copy of the other one, so the shared cache lines are only touched when the cached value says the ring looks full/empty.
+ * - Keeps the high-water mark (largest number of queued items observed by the producer, with the consumer index read again before it is raised).
+ * 
+ * @tparam T Item type. Must be default constructible and movable.
+ */
+template <typename T>
+class SpscRing
+{
+public:
+    /**
+     * @brief Constructs a new SpscRing object.
+     * 
+     * @param capacity Maximum number of items the ring can hold.
+     */
+    explicit SpscRing(size_t capacity)
+    {
+        limit = capacity > 0 ? capacity : 1;
+        size_t size = 1;
+        while (size < limit) size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    /**
+     * @brief Adds an item to the ring. Must only be called by the producer thread.
+     * 
+     * @param item Item to be added. It is moved into the ring only on success.
+     * @return true if the item was added, false if the ring holds capacity items.
+     */
+    bool push(T&& item)
+    {
+        // The count is checked against the capacity asked for, not the rounded storage
+        size_t current_tail = tail.load(std::memory_order_relaxed);
+        if (current_tail - cached_head >= limit)
+        {
+            cached_head = head.load(std::memory_order_acquire);
+            if (current_tail - cached_head >= limit) return false;
+        }
+        slots[current_tail & mask] = std::move(item);
+        tail.store(current_tail + 1, std::memory_order_release);
+
+        // The cached index only counts the pushes since it was read, so it is read again before a new high-water mark is recorded
+        size_t queued = current_tail + 1 - cached_head;
+        size_t high = high_water.load(std::memory_order_relaxed);
+        if (queued > high)
+        {
+            cached_head = head.load(std::memory_order_acquire);
+            queued = current_tail + 1 - cached_head;
+            if (queued > high) high_water.store(queued, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest item from the ring. Must only be called by the consumer thread.
+     * 
+     * @param item Where the item will be moved to.
+     * @return true if an item was removed, false if the ring is empty.
+     */
+    bool pop(T& item)
+    {
+        size_t current_head = head.load(std::memory_order_relaxed);
+        if (current_head == cached_tail)
+        {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (current_head == cached_tail) return false;
+        }
+        item = std::move(slots[current_head & mask]);
+        head.store(current_head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Gets the number of queued items. Exact only when called by the producer or the consumer.
+     * 
+     * @return Number of queued items.
+     */
+    size_t size() const
+    {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Checks if the ring has no items.
+     * 
+     * @return true if the ring is empty.
+     */
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    /**
+     * @brief Gets the maximum number of items the ring can hold.
+     * 
+     * @return Ring capacity.
+     */
+    size_t capacity() const
+    {
+        return limit;
+    }
+
+    /**
+     * @brief Gets the largest number of queued items seen by the producer.
+     * 
+     * @return High-water mark.
+     */
+    size_t high_water_mark() const
+    {
+        return high_water.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::vector<T> slots;                           ///< Ring storage.
+    size_t mask;                                    ///< Storage size - 1, used to wrap the indexes.
+    size_t limit;                                   ///< Maximum number of queued items.
+    char pad_0[CACHE_LINE_SIZE];                    ///< Keeps the consumer index away from the read-only fields.
+    std::atomic<size_t> head{0};                    ///< Consumer index (next item to be removed).
+    size_t cached_tail = 0;                         ///< Consumer copy of the producer index.
+    char pad_1[CACHE_LINE_SIZE];                    ///< Keeps the producer index in its own cache line.
+    std::atomic<size_t> tail{0};                    ///< Producer index (next free slot).
+    size_t cached_head = 0;                         ///< Producer copy of the consumer index.
+    std::atomic<size_t> high_water{0};              ///< Largest number of queued items seen by the producer.
+    char pad_2[CACHE_LINE_SIZE];                    ///< Keeps the producer fields away from the next allocation.
+};
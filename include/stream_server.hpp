@@ -0,0 +1,200 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "common.hpp"
+#include "frame_pool.hpp"
+
+// Minimum size of the ring shared by the clients (it must hold at least a few records)
+#define STREAM_RING_MIN_SIZE (64 * 1024)
+// Maximum size of the records copied out of the ring for a client at once, so one client does not hold the ring for long
+#define STREAM_MAX_SEND_SIZE (256 * 1024)
+
+/**
+ * @enum StreamTransport
+ * @brief Kind of socket a stream server listens on.
+ */
+enum class StreamTransport
+{
+    UNIX,       ///< Unix domain socket (local clients).
+    TCP,        ///< TCP socket (pcap over IP).
+};
+
+/**
+ * @struct stream_client_s
+ * @brief A client connected to the streaming server.
+ * - The positions are absolute (they only grow), the ring offset is the position modulo the ring size.
+ */
+struct stream_client_s {
+    int fd;                         ///< Client socket.
+    uint64_t cursor;                ///< Position of the next record to send.
+    std::vector<uint8_t> pending;   ///< Bytes to send before the next record: the global header and key packets, or records copied out of the ring.
+    size_t pending_sent;            ///< Bytes of pending already sent.
+    std::chrono::steady_clock::time_point last_send; ///< Last time the client was sent a batch.
+};
+
+/**
+ * @struct stream_stats_s
+ * @brief Statistics of the streaming server.
+ */
+struct stream_stats_s {
+    uint64_t clients;               ///< Clients that connected.
+    uint64_t dropped_clients;       ///< Clients disconnected because they were too slow.
+    uint64_t skipped_bytes;         ///< Bytes of records not sent to slow clients.
+};
+
+/**
+ * @class StreamServer
+ * @brief Serves the pcap stream to any number of clients connected to a Unix domain socket or a TCP port.
+ * - The records are written once to a ring shared by every client, and each client has its own cursor into it.
+ * - A client gets the pcap global header and the transport key packets, then the live stream from the moment it connected.
+ * - Sends are non-blocking and done without the lock: whole records are copied out of the ring and sent from the copy,
+ *   so the cursors are always at a record and a slow send never delays add_packet.
+ * - A client that lags more than its queue limit (at most the ring size) behind the capture is skipped to the oldest record
+ *   within the limit, or disconnected, so it never stalls the capture or the other clients.
+ * - The records of a client can be batched: they are sent when there is a batch size of them, or the batch delay passed since
+ *   the last send to the client.
+ * - Only available on Linux.
+ */
+class StreamServer
+{
+public:
+    /**
+     * @brief Constructs a new StreamServer object.
+     * 
+     * @param transport Kind of socket to listen on.
+     * @param settings Server settings (the address is the socket path, or host:port for TCP with IPv6 hosts in brackets).
+     */
+    StreamServer(StreamTransport transport, const stream_entry_s& settings);
+
+    /**
+     * @brief Closes the clients and the socket.
+     */
+    ~StreamServer();
+
+    /**
+     * @brief Creates the socket and waits for clients.
+     * 
+     * @return true if the socket is listening, false otherwise.
+     */
+    bool start();
+
+    /**
+     * @brief Accepts clients and sends them the stream, until stop is called.
+     */
+    void run();
+
+    /**
+     * @brief Stops the run method.
+     */
+    void stop();
+
+    /**
+     * @brief Adds a packet to the stream.
+     * - The record is only written to the ring when there are clients.
+     * 
+     * @param frame The frame with the packet to add.
+     * @param isTransportKey Bool flag indicating if the packet is a transport key packet (sent to every new client).
+     */
+    void add_packet(const FrameRef& frame, bool isTransportKey = false);
+
+    /**
+     * @brief Gets the statistics of the server.
+     */
+    stream_stats_s get_stats();
+
+private:
+    StreamTransport transport;              ///< Kind of socket.
+    std::string address;                    ///< Socket path, or host:port for TCP.
+    bool drop_slow_clients;                 ///< Disconnect the slow clients instead of skipping records.
+    uint64_t client_limit;                  ///< Maximum bytes waiting to be sent to a client before it is slow.
+    bool no_delay;                          ///< Disable Nagle's algorithm on the client connections (TCP).
+    uint64_t batch_size;                    ///< Bytes waiting for a client before they are sent (0 sends immediately).
+    std::chrono::milliseconds batch_delay;  ///< Maximum time records wait for a batch.
+    std::atomic<bool> is_running{false};    ///< Flag indicating if the server is running.
+    int listen_fd = -1;                     ///< Listening socket.
+    int wake_fds[2] = {-1, -1};             ///< Pipe used to wake up the run method when records are added.
+    std::atomic<bool> wake_pending{false};  ///< A wake up byte was written and not read yet.
+
+    std::mutex m_mutex;                     ///< Protects the ring, the key records and the client count.
+    std::vector<uint8_t> ring;              ///< Records shared by the clients.
+    uint64_t head = 0;                      ///< Position where the next record is written.
+    uint64_t tail = 0;                      ///< Position of the oldest record in the ring.
+    std::vector<uint8_t> record;            ///< Record being added (reused between packets).
+    std::vector<uint8_t> key_records;       ///< Records of the transport key packets.
+    size_t client_count = 0;                ///< Number of connected clients.
+    stream_stats_s stats = {0, 0, 0};       ///< Server statistics.
+
+    std::vector<stream_client_s> clients;   ///< Connected clients (only used by the run method).
+
+    /**
+     * @brief Copies bytes out of the ring, wrapping around its end.
+     */
+    void ring_read(uint64_t position, uint8_t* data, size_t size) const;
+
+    /**
+     * @brief Copies bytes into the ring, wrapping around its end.
+     */
+    void ring_write(uint64_t position, const uint8_t* data, size_t size);
+
+    /**
+     * @brief Gets the size of the record at a position of the ring.
+     */
+    size_t record_size(uint64_t position) const;
+
+    /**
+     * @brief Creates the listening Unix domain socket.
+     */
+    bool listen_unix();
+
+    /**
+     * @brief Creates the listening TCP socket.
+     */
+    bool listen_tcp();
+
+    /**
+     * @brief Accepts the pending clients.
+     */
+    void accept_clients();
+
+    /**
+     * @brief Checks if the records waiting for a client make a batch. Must be called with m_mutex locked.
+     * 
+     * @param client Client to check.
+     * @param now Current time.
+     * @param wait Set to the time until the batch delay expires, if it is shorter (optional).
+     * @return true if the records can be sent.
+     */
+    bool batch_ready(const stream_client_s& client, std::chrono::steady_clock::time_point now, std::chrono::milliseconds* wait = nullptr) const;
+
+    /**
+     * @brief Sends as much as possible to a client, without blocking.
+     * - The records are copied out of the ring with m_mutex locked, and sent with it unlocked.
+     * 
+     * @param client Client to send to.
+     * @return true if the client is still connected, false if it must be closed.
+     */
+    bool flush_client(stream_client_s& client);
+
+    /**
+     * @brief Checks if a client has data waiting to be sent. Must be called with m_mutex locked.
+     */
+    bool has_pending(const stream_client_s& client) const { return client.pending_sent < client.pending.size() || client.cursor < head; }
+};
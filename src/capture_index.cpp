@@ -0,0 +1,269 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <errno.h>
+
+#include "capture_index.hpp"
+#include "common.hpp"
+
+#ifdef _WIN32
+    #define capture_seek _fseeki64
+#else
+    #define capture_seek fseeko
+#endif
+
+// pcap magic number (microsecond timestamps) and pcapng block types read by the extraction
+#define CAPTURE_PCAP_MAGIC 0xA1B2C3D4
+#define CAPTURE_PCAPNG_SECTION_HEADER_BLOCK 0x0A0D0D0A
+#define CAPTURE_PCAPNG_ENHANCED_PACKET_BLOCK 0x00000006
+// The pcapng interfaces written by tuxniffer have nanosecond timestamps (if_tsresol 9)
+#define CAPTURE_PCAPNG_TICKS_PER_US 1000
+
+FILE* CaptureIndex::create(const std::string& path, CaptureFormat format, uint64_t data_offset)
+{
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        D(char* errmsg = custom_strerror(errno);
+            std::cout << "[WARNING] Could not create index file: " << path << errmsg << ". The log file will not be indexed." << std::endl;
+            free(errmsg);)
+        return nullptr;
+    }
+    capture_index_header_s header = {};
+    std::memcpy(header.magic, CAPTURE_INDEX_MAGIC, sizeof(header.magic));
+    header.version = CAPTURE_INDEX_VERSION;
+    header.format = format == CaptureFormat::PCAPNG ? 1 : 0;
+    header.data_offset = data_offset;
+    fwrite(&header, sizeof(header), 1, file);
+    return file;
+}
+
+bool CaptureIndex::load(const std::string& path, capture_index_header_s& header, std::vector<capture_index_entry_s>& entries)
+{
+    entries.clear();
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 && std::memcmp(header.magic, CAPTURE_INDEX_MAGIC, sizeof(header.magic)) == 0 && header.version == CAPTURE_INDEX_VERSION;
+    capture_index_entry_s entry;
+    while (valid && fread(&entry, sizeof(entry), 1, file) == 1) entries.push_back(entry);
+    fclose(file);
+    return valid;
+}
+
+/**
+ * @brief Counts the days from 1970-01-01 to a date of the proleptic Gregorian calendar.
+ */
+static int64_t days_from_civil(int64_t year, unsigned month, unsigned day)
+{
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    unsigned year_of_era = (unsigned)(year - era * 400);
+    unsigned day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + (int64_t)day_of_era - 719468;
+}
+
+bool CaptureIndex::parse_time(const std::string& text, int64_t& timestamp)
+{
+    // The fraction of a second has up to 6 digits
+    int64_t seconds = 0;
+    int64_t micros = 0;
+    size_t dot = text.find('.');
+    std::string whole = text.substr(0, dot);
+    if (dot != std::string::npos)
+    {
+        std::string fraction = text.substr(dot + 1);
+        if (fraction.empty() || fraction.size() > 6 || fraction.find_first_not_of("0123456789") != std::string::npos) return false;
+        fraction.append(6 - fraction.size(), '0');
+        micros = std::strtoll(fraction.c_str(), nullptr, 10);
+    }
+
+    int year, month, day, hour, minute, second;
+    char separator;
+    int consumed = 0;
+    if (sscanf(whole.c_str(), "%d-%d-%d%c%d:%d:%d%n", &year, &month, &day, &separator, &hour, &minute, &second, &consumed) == 7 && consumed == (int)whole.size())
+    {
+        if ((separator != ' ' && separator != 'T') || month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) return false;
+        seconds = days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    }
+    else
+    {
+        if (whole.empty() || whole.find_first_not_of("0123456789") != std::string::npos) return false;
+        seconds = std::strtoll(whole.c_str(), nullptr, 10);
+    }
+    timestamp = seconds * 1000000 + micros;
+    return true;
+}
+
+/**
+ * @brief Finds the offset of the first record of a log file, after its header.
+ */
+static bool find_data_offset(FILE* capture, CaptureFormat format, uint64_t& data_offset)
+{
+    if (format == CaptureFormat::PCAP)
+    {
+        data_offset = sizeof(pcap_hdr_s);
+        return true;
+    }
+    // Skip the blocks before the first Enhanced Packet Block (section header and interface descriptions)
+    uint64_t offset = 0;
+    uint32_t block[2];
+    while (capture_seek(capture, (int64_t)offset, SEEK_SET) == 0 && fread(block, sizeof(block), 1, capture) == 1)
+    {
+        if (block[0] == CAPTURE_PCAPNG_ENHANCED_PACKET_BLOCK) break;
+        if (block[1] < 12) return false;
+        offset += block[1];
+    }
+    data_offset = offset;
+    return true;
+}
+
+int64_t CaptureIndex::extract(const std::string& capture_path, int64_t from, int64_t to, const std::string& output_path)
+{
+    FILE* capture = fopen(capture_path.c_str(), "rb");
+    if (!capture)
+    {
+        char* errmsg = custom_strerror(errno);
+        std::cout << "[ERROR] Could not open capture file: " << capture_path << errmsg << "." << std::endl;
+        free(errmsg);
+        return -1;
+    }
+
+    uint32_t magic = 0;
+    CaptureFormat format;
+    if (fread(&magic, sizeof(magic), 1, capture) == 1 && magic == CAPTURE_PCAP_MAGIC) format = CaptureFormat::PCAP;
+    else if (magic == CAPTURE_PCAPNG_SECTION_HEADER_BLOCK) format = CaptureFormat::PCAPNG;
+    else
+    {
+        std::cout << "[ERROR] " << capture_path << " is not a pcap or pcapng file written by tuxniffer." << std::endl;
+        fclose(capture);
+        return -1;
+    }
+
+    // Read only between the last entry before the range and the first entry after it
+    uint64_t data_offset = 0;
+    uint64_t start;
+    uint64_t end = UINT64_MAX;
+    capture_index_header_s header;
+    std::vector<capture_index_entry_s> entries;
+    if (load(capture_path + CAPTURE_INDEX_EXTENSION, header, entries) && header.format == (format == CaptureFormat::PCAPNG ? 1u : 0u))
+    {
+        data_offset = header.data_offset;
+        start = data_offset;
+        for (const auto& entry : entries)
+        {
+            if (entry.timestamp <= from - CAPTURE_INDEX_SLACK_US) start = entry.offset;
+            else if (entry.timestamp > to + CAPTURE_INDEX_SLACK_US)
+            {
+                end = entry.offset;
+                break;
+            }
+        }
+        D(std::cout << "[INFO] Reading " << capture_path << " from offset " << std::dec << start << " (" << entries.size() << " index entries)." << std::endl;)
+    }
+    else
+    {
+        std::cout << "[WARNING] No index for " << capture_path << ". The whole file will be read." << std::endl;
+        if (!find_data_offset(capture, format, data_offset))
+        {
+            std::cout << "[ERROR] Could not read the header of " << capture_path << "." << std::endl;
+            fclose(capture);
+            return -1;
+        }
+        start = data_offset;
+    }
+
+    FILE* output = fopen(output_path.c_str(), "wb");
+    if (!output)
+    {
+        char* errmsg = custom_strerror(errno);
+        std::cout << "[ERROR] Could not create output file: " << output_path << errmsg << "." << std::endl;
+        free(errmsg);
+        fclose(capture);
+        return -1;
+    }
+
+    // Same header as the log file, so the pcapng interfaces keep their indexes
+    std::vector<uint8_t> buffer((size_t)data_offset);
+    capture_seek(capture, 0, SEEK_SET);
+    bool valid = fread(buffer.data(), 1, buffer.size(), capture) == buffer.size() && fwrite(buffer.data(), 1, buffer.size(), output) == buffer.size();
+    uint32_t snaplen = CAPTURE_BLOCK_MAX_SIZE;
+    if (valid && format == CaptureFormat::PCAP && buffer.size() >= sizeof(pcap_hdr_s))
+    {
+        pcap_hdr_s pcap_hdr;
+        std::memcpy(&pcap_hdr, buffer.data(), sizeof(pcap_hdr));
+        if (pcap_hdr.snaplen > 0 && pcap_hdr.snaplen < snaplen) snaplen = pcap_hdr.snaplen;
+    }
+
+    int64_t copied = 0;
+    uint64_t offset = start;
+    valid = valid && capture_seek(capture, (int64_t)offset, SEEK_SET) == 0;
+    while (valid && offset < end)
+    {
+        size_t record_size;
+        int64_t timestamp;
+        bool packet = true;
+        if (format == CaptureFormat::PCAP)
+        {
+            pcaprec_hdr_s record;
+            if (fread(&record, sizeof(record), 1, capture) != 1) break;
+            if (record.incl_len > snaplen)
+            {
+                std::cout << "[ERROR] " << capture_path << " has a record of " << std::dec << record.incl_len << " bytes at offset " << offset << " (snaplen " << snaplen << ")." << std::endl;
+                valid = false;
+                break;
+            }
+            record_size = sizeof(record) + record.incl_len;
+            // The pcap records are written in the local time of TIMEZONE
+            timestamp = (int64_t)record.ts_sec * 1000000 + record.ts_usec - (int64_t)TIMEZONE * 1000000;
+            buffer.resize(record_size);
+            std::memcpy(buffer.data(), &record, sizeof(record));
+            if (fread(buffer.data() + sizeof(record), 1, record.incl_len, capture) != record.incl_len) break;
+        }
+        else
+        {
+            uint32_t block[2];
+            if (fread(block, sizeof(block), 1, capture) != 1 || block[1] < 12) break;
+            if (block[1] > CAPTURE_BLOCK_MAX_SIZE)
+            {
+                std::cout << "[ERROR] " << capture_path << " has a block of " << std::dec << block[1] << " bytes at offset " << offset << "." << std::endl;
+                valid = false;
+                break;
+            }
+            record_size = block[1];
+            buffer.resize(record_size);
+            std::memcpy(buffer.data(), block, sizeof(block));
+            if (fread(buffer.data() + sizeof(block), 1, record_size - sizeof(block), capture) != record_size - sizeof(block)) break;
+            // Other blocks are not copied
+            packet = block[0] == CAPTURE_PCAPNG_ENHANCED_PACKET_BLOCK && record_size >= sizeof(pcapng_epb_hdr_s) + 4;
+            pcapng_epb_hdr_s epb = {};
+            if (packet) std::memcpy(&epb, buffer.data(), sizeof(epb));
+            timestamp = (int64_t)((((uint64_t)epb.ts_high << 32) | epb.ts_low) / CAPTURE_PCAPNG_TICKS_PER_US);
+        }
+        offset += record_size;
+
+        if (!packet || timestamp < from || timestamp > to) continue;
+        if (fwrite(buffer.data(), 1, record_size, output) != record_size) valid = false;
+        copied++;
+    }
+
+    fclose(capture);
+    if (fclose(output) != 0) valid = false;
+    if (!valid)
+    {
+        std::cout << "[ERROR] Could not copy the packets to " << output_path << "." << std::endl;
+        return -1;
+    }
+    return copied;
+}
@@ -0,0 +1,78 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+
+#include "clock_model.hpp"
+
+void ClockModel::add_sample(int64_t device_time, int64_t system_time)
+{
+    // The counter restarted: the points of the previous counter do not describe the new one
+    if (samples > 0 && device_time < last_device) reset();
+
+    int64_t offset = system_time - device_time;
+    if (samples == 0)
+    {
+        origin_device = device_time;
+        origin_offset = offset;
+        interval_start = device_time;
+        interval_offset = offset;
+        interval_device = device_time;
+    }
+    else if (device_time - interval_start >= CLOCK_MODEL_INTERVAL_US)
+    {
+        // The interval is over: its least delayed sample becomes a point of the fit
+        add_point(interval_device, interval_offset);
+        interval_start = device_time;
+        interval_offset = offset;
+        interval_device = device_time;
+    }
+    else if (offset < interval_offset)
+    {
+        interval_offset = offset;
+        interval_device = device_time;
+    }
+    last_device = device_time;
+    samples++;
+}
+
+void ClockModel::add_point(int64_t device_time, int64_t offset)
+{
+    double x = (device_time - origin_device) / 1e6;
+    double y = static_cast<double>(offset - origin_offset);
+    sum_w = sum_w * CLOCK_MODEL_FORGETTING + 1.0;
+    sum_x = sum_x * CLOCK_MODEL_FORGETTING + x;
+    sum_y = sum_y * CLOCK_MODEL_FORGETTING + y;
+    sum_xx = sum_xx * CLOCK_MODEL_FORGETTING + x * x;
+    sum_xy = sum_xy * CLOCK_MODEL_FORGETTING + x * y;
+    points++;
+
+    if (points < 2)
+    {
+        intercept = y;
+        return;
+    }
+    double denominator = sum_w * sum_xx - sum_x * sum_x;
+    if (denominator <= 1e-9) return;
+    slope = (sum_w * sum_xy - sum_x * sum_y) / denominator;
+    intercept = (sum_y - slope * sum_x) / sum_w;
+    fitted = true;
+}
+
+int64_t ClockModel::offset_at(int64_t device_time) const
+{
+    // Until the first interval is over, the smallest offset seen so far is the best estimate
+    if (points == 0) return interval_offset;
+    double x = (device_time - origin_device) / 1e6;
+    double offset = intercept + (fitted ? slope * x : 0.0);
+    return origin_offset + static_cast<int64_t>(offset < 0 ? offset - 0.5 : offset + 0.5);
+}
@@ -160,8 +160,8 @@ std::vector<uint8_t> CommandAssembler::assemble_command(uint8_t info)
     return command;
 }
 
-// Calculate final frequency
-float CommandAssembler::calculateFinalFreq(uint8_t mode, float freq, int channel)
+// Calculate final frequency, without exiting on an invalid channel
+bool CommandAssembler::tryCalculateFinalFreq(uint8_t mode, float freq, int channel, float* finalFreqOut)
 {
     float finalFreq = freq;
     // Could aggregate similar options, but it would make the code less readable
@@ -173,148 +173,88 @@ float CommandAssembler::calculateFinalFreq(uint8_t mode, float freq, int channel
     // IEEE 802.15.4ge
     case 0:
         if(channel >= 0 && channel <= 128) finalFreq = (float)(902.2 + (channel * 0.2));
-        else {
-            D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
-            exit(-1);
-        }
+        else return false;
         break;
     case 1:
         if(channel >= 0 && channel <= 33) finalFreq = (float)(863.125 + (channel * 0.2));
-        else {
-            D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
-            exit(-1);
-        }
+        else return false;
         break;
     case 2:
         if(channel >= 0 && channel <= 6) finalFreq = (float)(433.3 + (channel * 0.2));
-        else {
-            D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
-            exit(-1);
-        }
+        else return false;
         break;
     case 3:
         if(channel >= 0 && channel <= 128) finalFreq = (float)(902.2 + (channel * 0.2));
-        else {
-            D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
-            exit(-1);
-        }
+        else return false;
         break;
     case 4:
         if(channel >= 0 && channel <= 33) finalFreq = (float)(863.125 + (channel * 0.2));
-        else {
-            D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
-            exit(-1);
-        }
+        else return false;
         break;
     case 5:
         if(channel >= 0 && channel <= 6) finalFreq = (float)(433.3 + (channel * 0.2));
-        else {
-            D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
-            exit(-1);
-        }
+        else return false;
         break;
     // Wi-SUN 
     case 6:
         if(channel >= 0 && channel <= 128) finalFreq = (float)(863.1 + (channel * 0.1));
-        else {
-            D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
-            exit(-1);
-        }
+        else return false;
         break;
     case 7:
         if(channel >= 0 && channel <= 128) finalFreq = (float)(902.2 + (channel * 0.2));
-        else {
-            D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
-            exit(-1);
-        }
+        else return false;
         break;
     case 8:
         if(channel >= 0 && channel <= 128) finalFreq = (float)(863.1 + (channel * 0.2));
-        else {
-            D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
-            exit(-1);
-        }
+        else return false;
         break;
     case 9:
         if(channel >= 0 && channel <= 128) finalFreq = (float)(902.2 + (channel * 0.2));
-        else {
-            D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
-            exit(-1);
-        }
+        else return false;
         break;
     case 10:
         if(channel >= 0 && channel <= 128) finalFreq = (float)(863.1 + (channel * 0.2));
-        else {
-            D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
-            exit(-1);
-        }
+        else return false;
         break;
     case 11:
         if(channel >= 0 && channel <= 128) finalFreq = (float)(902.4 + (channel * 0.4));
-        else {
-            D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
-            exit(-1);
-        }
+        else return false;
         break;
     case 12:
         if(channel >= 0 && channel <= 128) finalFreq = (float)(920.8 + (channel * 0.6));
-        else {
-            D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
-            exit(-1);
-        }
+        else return false;
         break;
     // Zigbee
     case 13:
     case 14:
         if(channel >= 0 && channel <= 128) finalFreq = (float)(863.1 + (channel * 0.2));
-        else {
-            D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
-            exit(-1);
-        }
+        else return false;
         break;
     // IEEE 915
     case 15:
         if(channel >= 0 && channel <= 63) finalFreq = (float)(902.4 + (channel * 0.4));
-        else {
-            D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
-            exit(-1);
-        }
+        else return false;
         break;
     // EasyLink/ Generic
     case 16:
         if(channel == 0) finalFreq = (float)863.125;
-        else {
-            D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
-            exit(-1);
-        }
+        else return false;
         break;
     case 17:
         if(channel == 0) finalFreq = (float)433.3;
-        else {
-            D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
-            exit(-1);
-        }
+        else return false;
         break;
     case 18:
         if(channel == 0) finalFreq = (float)863.125;
-        else {
-            D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
-            exit(-1);
-        }
+        else return false;
         break;
     case 19:
         if(channel == 0) finalFreq = (float)433.3;
-        else {
-            D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
-            exit(-1);
-        }
+        else return false;
         break;
     case 20:
         if(channel >= 11 && channel <= 26) finalFreq = (float)(2405 + ((channel - 11) * 5));
-        else {
-            D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
-            exit(-1);
-        }
+        else return false;
         break;
     case 21:
         // Channels 37, 38 and 39 are used for advertising
@@ -322,13 +262,23 @@ float CommandAssembler::calculateFinalFreq(uint8_t mode, float freq, int channel
         if(channel == 37) finalFreq = (float)2402;
         else if(channel == 38) finalFreq = (float)2426;
         else if(channel == 39) finalFreq = (float)2480;
-        else {
-            D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
-            exit(-1);
-        }
+        else return false;
         break;
     }
 
+    *finalFreqOut = finalFreq;
+    return true;
+}
+
+// Calculate final frequency
+float CommandAssembler::calculateFinalFreq(uint8_t mode, float freq, int channel)
+{
+    float finalFreq;
+    if (!tryCalculateFinalFreq(mode, freq, channel, &finalFreq))
+    {
+        D(std::cout << "[ERROR] Invalid channel for Radio Mode. Check table to see available values with ./tuxniffer -l." << std::endl;)
+        exit(-1);
+    }
     return finalFreq;
 }
 
@@ -337,14 +287,19 @@ std::vector<uint8_t> CommandAssembler::convertFreqToByte(float freq)
 {
     // Calculate frequency to byte using the formula: (frequency + fractFrequency/65536) MHz.
     // Where the first 2 bytes are the integer part and the last 2 bytes are the fractional part.
+    std::vector<uint8_t> freq_bytes(4);
+    convertFreqToByte(freq, freq_bytes.data());
+    return freq_bytes;
+}
+
+void CommandAssembler::convertFreqToByte(float freq, uint8_t* freq_bytes)
+{
     uint32_t freqInt = (uint32_t)freq;
     uint32_t freqFrac = (uint32_t)((freq - freqInt) * 65536);
-    std::vector<uint8_t> freq_bytes;
-    freq_bytes.push_back(freqInt & 0xFF);
-    freq_bytes.push_back((freqInt >> 8) & 0xFF);
-    freq_bytes.push_back(freqFrac & 0xFF);
-    freq_bytes.push_back((freqFrac >> 8) & 0xFF);
-    return freq_bytes;
+    freq_bytes[0] = freqInt & 0xFF;
+    freq_bytes[1] = (freqInt >> 8) & 0xFF;
+    freq_bytes[2] = freqFrac & 0xFF;
+    freq_bytes[3] = (freqFrac >> 8) & 0xFF;
 }
 
 // Assemble start command
@@ -416,7 +371,7 @@ std::vector<uint8_t> CommandAssembler::assemble_set_phy(uint8_t radio_mode, uint
 }
 
 // Verify response
-bool CommandAssembler::verify_response(std::vector<uint8_t> response)
+bool CommandAssembler::verify_response(const std::vector<uint8_t>& response)
 {
     if (response.size() == 0) return false;
 
@@ -447,42 +402,35 @@ std::vector<uint8_t> CommandAssembler::disassemble_ping(std::vector<uint8_t> res
 }
 
 // Convert to packet
-packet_data CommandAssembler::convert_to_network_packet(std::vector<uint8_t> data, std::chrono::microseconds system_timestamp)
+packet_data CommandAssembler::convert_to_network_packet(const uint8_t* data, size_t size, std::chrono::microseconds system_timestamp)
 {
-    std::vector<uint8_t> length;
-    std::vector<uint8_t> timestamp;
-    uint8_t rssi;
-    std::vector<uint8_t> payload;
-    uint8_t fcs;
     // Exclude SOF, INFO and EOF
-    data = std::vector<uint8_t>(data.begin() + 3, data.end() - 2);
+    data += 3;
+    size -= 5;
 
     // LENGHT 2B | TIMESTAMP 6B | RSSI 1B | DATA N B | ??? 1B | FCS 1B
-    // LENGHT 2B
-    length.insert(length.end(), data.begin(), data.begin() + 2);
-    // TIMESTAMP 6B
-    timestamp.insert(timestamp.end(), data.begin() + 2, data.begin() + 8);
+    // Length and timestamp are in little endian
+    uint16_t length = data[0] | (data[1] << 8);
+    uint64_t timestamp = 0;
+    for (size_t i = 0; i < 6; ++i) {
+        timestamp |= static_cast<uint64_t>(data[2 + i]) << (i * 8);
+    }
 
     // NOTE: data[8] does not represent anything in specific. It is not clear what it is.
 
-    // DATA N B
-    payload.insert(payload.end(), data.begin() + 9, data.end() - 2);
     // RSSI 1B
-    rssi = data[data.size() - 2];
+    uint8_t rssi = data[size - 2];
     // FCS
-    fcs = data.back();
-
-    // Length and timestamp are in little endian
-    std::reverse(length.begin(), length.end());
-    std::reverse(timestamp.begin(), timestamp.end());
+    uint8_t fcs = data[size - 1];
 
     // Convert to packet
     packet_data packet = {
-        ((length[0] << 8) | length[1]) - 9,
-        std::chrono::microseconds((static_cast<uint64_t>(timestamp[0]) << 40) | (static_cast<uint64_t>(timestamp[1]) << 32) | (static_cast<uint64_t>(timestamp[2]) << 24) | (static_cast<uint64_t>(timestamp[3]) << 16) | (static_cast<uint64_t>(timestamp[4]) << 8) | static_cast<uint64_t>(timestamp[5])),
+        length - 9,
+        std::chrono::microseconds(timestamp),
         system_timestamp,
         rssi,
-        payload,
+        // DATA N B
+        std::vector<uint8_t>(data + 9, data + size - 2),
         fcs,
         fcs
     };
@@ -491,12 +439,12 @@ packet_data CommandAssembler::convert_to_network_packet(std::vector<uint8_t> dat
 }
 
 // Get device timestamp
-std::chrono::microseconds CommandAssembler::get_device_timestamp(std::vector<uint8_t> data)
+std::chrono::microseconds CommandAssembler::get_device_timestamp(const uint8_t* data, size_t size)
 {
     const size_t expected_length = 13; // 3 (SOF, INFO) + 6 (TIMESTAMP) + 2 (EOF) + 2 (padding or other data)
     const size_t timestamp_offset = 5; // 3 (SOF, INFO) + 2 (padding or other data)
 
-    if (data.size() < expected_length) {
+    if (size < expected_length) {
         D(std::cout << "[ERROR] Data vector is too short to contain a valid timestamp." << std::endl;)
         return std::chrono::microseconds(0);
     }
@@ -511,13 +459,8 @@ std::chrono::microseconds CommandAssembler::get_device_timestamp(std::vector<uin
 }
 
 
-std::vector<uint8_t> CommandAssembler::get_payload(packet_queue_s packet)
+void CommandAssembler::get_payload(const packet_queue_s& packet, std::vector<uint8_t>& payload)
 {
-
-    std::vector<uint8_t> payload;
     // DATA N B
-    payload.insert(payload.end(), packet.packet.begin() + 12, packet.packet.end() - 4);
-
-
-    return payload;
+    payload.assign(packet.packet + 12, packet.packet + packet.length - 4);
 }
\ No newline at end of file
@@ -81,4 +81,25 @@ char* custom_strerror(int n_error){
     
     
     
-}
\ No newline at end of file
+}
+
+bool parse_queue_policy(const std::string& name, QueuePolicy& policy)
+{
+    if (name == "drop-oldest") policy = QueuePolicy::DROP_OLDEST;
+    else if (name == "drop-newest") policy = QueuePolicy::DROP_NEWEST;
+    else if (name == "block") policy = QueuePolicy::BLOCK;
+    else if (name == "spill") policy = QueuePolicy::SPILL;
+    else return false;
+    return true;
+}
+
+bool parse_reset_period(const std::string& name, ResetPeriod& period)
+{
+    if (name == "none") period = ResetPeriod::NONE;
+    else if (name == "hourly") period = ResetPeriod::HOURLY;
+    else if (name == "daily") period = ResetPeriod::DAILY;
+    else if (name == "weekly") period = ResetPeriod::WEEKLY;
+    else if (name == "monthly") period = ResetPeriod::MONTHLY;
+    else return false;
+    return true;
+}
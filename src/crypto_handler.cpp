@@ -388,7 +388,7 @@ bool CryptoHandler::handle_decryption(vector<uint8_t> header, vector<uint8_t> pa
     return false;
 }
 
-bool CryptoHandler::extract_key(vector<uint8_t> payload)
+bool CryptoHandler::extract_key(const vector<uint8_t>& payload)
 {
     if (security_level < 5 && security_level != -1){
         return false;
@@ -21,6 +21,7 @@
 
 #include "common.hpp"
 #include "device.hpp"
+#include "interface_registry.hpp"
 #include "framer.hpp"
 
 #ifdef __linux__
@@ -55,16 +56,31 @@ Device::Device(device_s device, int id_counter, std::mutex &coutMutex)
     port = device.port;
     radio_mode = device.radio_mode;
     channel = device.channel;
+    interface_id = 0;
+    if (!device.replay.empty()) replay = std::make_shared<ReplaySource>(device.replay, device.replay_speed);
 }
 
 bool Device::connect()
 {
-    is_ready = serial.connect();
+    // The interface is only registered once its radio mode and channel are known to be valid
+    if (!InterfaceRegistry::intern(port, radio_mode, channel, interface_id))
+    {
+        is_ready = false;
+        return is_ready;
+    }
+    if (replay) is_ready = replay->open();
+    else is_ready = serial.connect();
     return is_ready;
 }
 
 bool Device::init()
 {
+    // A replayed capture has no firmware to configure
+    if (replay)
+    {
+        state = State::STOPPED;
+        return true;
+    }
     serial.purge();
     uint8_t fwID;
     if(!stop()) return false;
@@ -76,6 +92,14 @@ bool Device::init()
 
 bool Device::start()
 {
+    if (replay)
+    {
+        std::lock_guard<std::mutex> lock(coutMutex);
+        std::cout << "[INFO] Device [" << id << "] started replaying " << port << "." << std::endl;
+        state = State::STARTED;
+        return true;
+    }
+
     std::vector<uint8_t> response;
     // Send start command
     serial.flush();
@@ -93,6 +117,12 @@ bool Device::start()
 
 bool Device::stop()
 {
+    if (replay)
+    {
+        state = State::STOPPED;
+        return true;
+    }
+
     std::vector<uint8_t> response;
     // Send stop command
     serial.flush();
@@ -187,10 +217,10 @@ void Device::stream()
 	signal(SIGTERM, signal_handler);
 
     is_streaming = true;
-    int totalPackets = 0;
+    // Reused for every frame, so it only allocates memory for the first one
+    std::vector<uint8_t> response;
     while(is_streaming)
     {
-        std::vector<uint8_t> response;
         if(!receive_response(response) && interruption)
         {
             // Reset SIGINT to default behavior
@@ -199,12 +229,7 @@ void Device::stream()
             signal(SIGTERM, SIG_DFL);
             return;
         }
-        if(!cmd.verify_response(response)) continue;
-        totalPackets++;
-        D({std::lock_guard<std::mutex> lock(coutMutex); std::cout << "[INFO] Device [" << id << "] received packet (" << std::dec << totalPackets << " received)." << std::endl;})
-        if (output_manager != nullptr) output_manager->add_packet(
-            {id, port, channel, radio_mode, response, std::chrono::system_clock::now()}
-        );
+        if(!dispatch_frame(response)) continue;
         if(interruption) is_streaming = false;
     }
 
@@ -223,11 +248,11 @@ void Device::stream(std::chrono::seconds seconds)
 	signal(SIGTERM, signal_handler);
 
     is_streaming = true;
-    int totalPackets = 0;
     auto start_time = std::chrono::steady_clock::now();
+    // Reused for every frame, so it only allocates memory for the first one
+    std::vector<uint8_t> response;
     while(is_streaming)
     {
-        std::vector<uint8_t> response;
         if(!receive_response(response) && interruption)
         {
             // Check if time has elapsed
@@ -237,12 +262,7 @@ void Device::stream(std::chrono::seconds seconds)
             //if (interruption) is_streaming = false;
             is_streaming = false;
         }
-        if(!cmd.verify_response(response)) continue;
-        totalPackets++;
-        D({std::lock_guard<std::mutex> lock(coutMutex); std::cout << "[INFO] Device [" << id << "] received packet (" << std::dec << totalPackets << " received)." << std::endl;})
-        if (output_manager != nullptr) output_manager->add_packet(
-            {id, port, channel, radio_mode, response, std::chrono::system_clock::now()}
-        );
+        if(!dispatch_frame(response)) continue;
         // Check if time has elapsed
         auto current_time = std::chrono::steady_clock::now();
         auto elapsed_time = std::chrono::duration_cast<std::chrono::seconds>(current_time - start_time);
@@ -257,14 +277,80 @@ void Device::stream(std::chrono::seconds seconds)
     signal(SIGTERM, SIG_DFL);
 }
 
+bool Device::dispatch_frame(std::vector<uint8_t>& frame)
+{
+    if(!cmd.verify_response(frame)) return false;
+    total_packets++;
+    D({std::lock_guard<std::mutex> lock(coutMutex); std::cout << "[INFO] Device [" << id << "] received packet (" << std::dec << total_packets << " received)." << std::endl;})
+    if (output_manager == nullptr) return true;
+
+    // The packet is written directly into a pooled frame, which is shared by every output
+    FrameRef packet = output_manager->frame_pool.acquire();
+    // Exhausted pool: the packet is dropped (and counted by the pool)
+    if (!packet) return true;
+    packet->id = id;
+    packet->interface_id = interface_id;
+    packet->channel = channel;
+    packet->mode = radio_mode;
+    // Replayed packets keep their capture time
+    packet->timestamp = replay ? replay_time : std::chrono::system_clock::now();
+    if (!packet->set_packet(frame.data(), frame.size()))
+    {
+        D({std::lock_guard<std::mutex> lock(coutMutex); std::cout << "[WARNING] Device [" << id << "] received a frame larger than " << FRAME_MAX_SIZE << " bytes. Discarding packet." << std::endl;})
+        return false;
+    }
+    output_manager->add_packet(std::move(packet));
+    return true;
+}
+
+int Device::stream_step()
+{
+    int bytes_read = 0;
+    // Only go to the port when the bytes left over by previous commands were consumed
+    if (!serial.hasBufferedData())
+    {
+        bytes_read = serial.fillBuffer();
+        if (bytes_read < 0) return -1;
+    }
+
+    // Feed every buffered byte to the persistent framer, dispatching each frame as soon as it is complete
+    uint8_t byte;
+    while (serial.nextBufferedByte(&byte))
+    {
+        stream_frame.push_back(byte);
+        FrameState state = stream_framer.process(byte);
+        if (state == FrameState::S_SUCCESS)
+        {
+            dispatch_frame(stream_frame);
+            stream_frame.clear();
+            stream_framer.reset();
+        }
+        if (state == FrameState::S_ERROR)
+        {
+            stream_frame.clear();
+            stream_framer.recover();
+        }
+    }
+
+    return bytes_read;
+}
+
 bool Device::disconnect()
 {
+    if (replay)
+    {
+        replay->close();
+        return true;
+    }
     return serial.disconnect();
 }
 
 bool Device::receive_response(std::vector<uint8_t>& ret)
 {
-    std::vector<uint8_t> response;
+    if (replay) return receive_replay(ret);
+
+    // The frame is assembled directly in ret, reusing its memory
+    ret.clear();
     Framer framer;
 
     // Set timeout duration to 10 seconds (adjust as needed)
@@ -273,62 +359,99 @@ bool Device::receive_response(std::vector<uint8_t>& ret)
 
     while (true)
     {
-        // Read byte from serial
-        uint8_t byte;
-        int read_byte = serial.readByte(&byte);
-
-        if(read_byte == 0)
+        // Refill the serial buffer with everything the port has in a single read when it runs dry
+        if (!serial.hasBufferedData())
         {
+            int bytes_read = serial.fillBuffer();
+
+            if (bytes_read == 0)
+            {
+                // Check if timeout has occurred
+                auto current_time = std::chrono::steady_clock::now();
+                auto elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(current_time - start_time);
+
+                if (elapsed_time >= timeout_duration)
+                {
+                    D({std::lock_guard<std::mutex> lock(coutMutex); std::cout << "[INFO] Timeout reached, no response received from Device [" << id << "] within 10 seconds." << std::endl;})
+                    ret.clear();
+                    return false;
+                }
 
-            // Check if timeout has occurred
-            auto current_time = std::chrono::steady_clock::now();
-            auto elapsed_time = std::chrono::duration_cast<std::chrono::seconds>(current_time - start_time);
+                // Block until bytes arrive (or the remaining timeout expires) and read them right away
+                serial.waitForData(timeout_duration - elapsed_time);
+                continue;
+            }
 
-            if (elapsed_time >= timeout_duration)
+            if (bytes_read == -1)
             {
-                D({std::lock_guard<std::mutex> lock(coutMutex); std::cout << "[INFO] Timeout reached, no response received from Device [" << id << "] within 10 seconds." << std::endl;})
-                return false;
+                if (!reconnect_on_loss || !reconnect()){
+                    ret.clear();
+                    return false;
+                }
+                return receive_response(ret);
             }
 
-            // Sleep for a short period before checking again
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-            continue;
+            // Reset timeout start time since we received data
+            start_time = std::chrono::steady_clock::now();
         }
 
-        if (read_byte == -1)
+        // Hand the buffered bytes to the framer until a frame is complete or the buffer is empty
+        // Bytes after the end of the frame stay in the serial buffer for the next call
+        uint8_t byte;
+        while (serial.nextBufferedByte(&byte))
         {
-            if (!reconnect()){
-                return false;
+            // Push byte to response
+            ret.push_back(byte);
+
+            // Process byte
+            FrameState state = framer.process(byte);
+
+            // If the frame is complete
+            if (state == FrameState::S_SUCCESS)
+            {
+                return true;
+            }
+            if (state == FrameState::S_ERROR)
+            {
+                ret.clear();
+                framer.recover();
             }
-            return receive_response(ret);
         }
+    }
 
-        // Push byte to response
-        response.push_back(byte);
+    return false;
+}
 
-        // Process byte
-        std::string oldState = framer.getStateString();
-        FrameState state = framer.process(byte);
-        // std::cout << oldState << "-(" << std::hex << static_cast<int>(byte) << ")->" << framer.getStateString() << std::endl;
+bool Device::receive_replay(std::vector<uint8_t>& ret)
+{
+    if (!replay->next_frame(ret, replay_time))
+    {
+        ret.clear();
+        is_streaming = false;
+        set_active(false);
+        std::lock_guard<std::mutex> lock(coutMutex);
+        std::cout << "[INFO] Device [" << id << "] finished replaying " << port << " (" << std::dec << total_packets << " packets replayed";
+        if (replay->get_skipped() > 0) std::cout << ", " << replay->get_skipped() << " skipped";
+        std::cout << ")." << std::endl;
+        return false;
+    }
+    if (!replay->wait(replay_time))
+    {
+        ret.clear();
+        return false;
+    }
 
-        // If the frame is complete
-        if (state == FrameState::S_SUCCESS)
+    // The rebuilt frame goes through the same framer as the bytes of a serial port
+    Framer framer;
+    for (uint8_t byte : ret)
+    {
+        if (framer.process(byte) == FrameState::S_ERROR)
         {
-            // Copy response to ret
-            ret = response;
+            ret.clear();
             return true;
         }
-        if (state == FrameState::S_ERROR)
-        {
-            response.clear();
-            framer.recover();
-        }
-
-        // Reset timeout start time since we received a byte
-        start_time = std::chrono::steady_clock::now();
     }
-
-    return false;
+    return true;
 }
 
 bool Device::reconnect()
@@ -337,6 +460,7 @@ bool Device::reconnect()
         std::lock_guard<std::mutex> lock(coutMutex);
         std::cout << "[ERROR] Connection lost with Device [" << id << "]." << std::endl;
     }
+    set_active(false);
     if (!disconnect())
     {
         D({std::lock_guard<std::mutex> lock(coutMutex); std::cout << "[ERROR] Error closing serial port. Impossible to reconect Device [" << id << "]." << std::endl;})
@@ -347,22 +471,32 @@ bool Device::reconnect()
     std::this_thread::sleep_for(std::chrono::milliseconds(10000));
     while (true)
     {
-        
-        serial.closePort();
-        if(connect()){
-            if(init()){
-                if(start())
-                {
-                    std::lock_guard<std::mutex> lock(coutMutex);
-                    std::cout << "[INFO] Reconnected with Device [" << id << "]." << std::endl;
-                    return true;
-                }
-            }
-        }    
+        if(try_reconnect())
+        {
+            std::lock_guard<std::mutex> lock(coutMutex);
+            std::cout << "[INFO] Reconnected with Device [" << id << "]." << std::endl;
+            return true;
+        }
         D({std::lock_guard<std::mutex> lock(coutMutex); std::cout << "[ERROR] Reconnection with Device [" << id << "] failed. Trying again in 10 seconds." << std::endl;})
         std::this_thread::sleep_for(std::chrono::milliseconds(10000));
         if (interruption) return false;
-        
     }
     return false;
 }
+
+bool Device::try_reconnect()
+{
+    serial.closePort();
+    stream_frame.clear();
+    stream_framer.reset();
+    if(!connect()) return false;
+    if(!init()) return false;
+    if(!start()) return false;
+    set_active(true);
+    return true;
+}
+
+void Device::set_active(bool active)
+{
+    if (output_manager != nullptr) output_manager->set_device_active(id, active);
+}
@@ -0,0 +1,156 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+
+#include <limits>
+#include <cstring>
+
+#include "duplicate_filter.hpp"
+#include "pcap_builder.hpp"
+
+DuplicateFilter::DuplicateFilter(int num_devices, int64_t window)
+: window(window), latest_time(std::numeric_limits<int64_t>::min()), table(DEDUP_TABLE_SIZE, dedup_slot_s{0, 0}),
+  mask(DEDUP_TABLE_SIZE - 1), suppressed(num_devices, 0)
+{
+}
+
+uint64_t DuplicateFilter::hash_payload(const packet_queue_s& packet)
+{
+    ti_frame_s frame;
+    if (!PcapBuilder::parse_frame(packet, frame)) return 0;
+    // FNV-1a, with the high bits folded into the low ones used to index the table
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < frame.payload_size; i++)
+    {
+        hash ^= frame.payload[i];
+        hash *= 0x100000001b3ULL;
+    }
+    hash ^= hash >> 32;
+    return hash == 0 ? 1 : hash;
+}
+
+bool DuplicateFilter::same_payload(const packet_queue_s& a, const packet_queue_s& b)
+{
+    ti_frame_s frame_a;
+    ti_frame_s frame_b;
+    if (a.length != b.length || !PcapBuilder::parse_frame(a, frame_a) || !PcapBuilder::parse_frame(b, frame_b)) return false;
+    return std::memcmp(frame_a.payload, frame_b.payload, frame_a.payload_size) == 0;
+}
+
+void DuplicateFilter::push(FrameRef frame, int64_t time)
+{
+    if (time > latest_time) latest_time = time;
+    uint64_t hash = hash_payload(*frame);
+
+    if (hash != 0)
+    {
+        for (size_t i = hash & mask; table[i].hash != 0; i = (i + 1) & mask)
+        {
+            if (table[i].hash != hash) continue;
+            dedup_entry_s& entry = held[table[i].sequence - first_sequence];
+            // Repeated frames of the same device are retransmissions, not copies
+            if (entry.frame->id == frame->id) continue;
+            if (time - entry.time > window || entry.time - time > window) continue;
+            if (!same_payload(*entry.frame, *frame)) continue;
+
+            // Keep the copy with the best RSSI (both are data frames, since their payloads were compared)
+            ti_frame_s held_fields;
+            ti_frame_s new_fields;
+            PcapBuilder::parse_frame(*entry.frame, held_fields);
+            PcapBuilder::parse_frame(*frame, new_fields);
+            if (static_cast<int8_t>(new_fields.rssi) > static_cast<int8_t>(held_fields.rssi))
+            {
+                if (entry.frame->id >= 0 && entry.frame->id < (int)suppressed.size()) suppressed[entry.frame->id]++;
+                entry.frame = std::move(frame);
+            }
+            else if (frame->id >= 0 && frame->id < (int)suppressed.size())
+            {
+                suppressed[frame->id]++;
+            }
+            return;
+        }
+
+        // Not a copy: index it, unless too many packets are held (the table must keep free slots to end the probes)
+        if (held.size() < DEDUP_MAX_PENDING)
+        {
+            size_t slot = hash & mask;
+            while (table[slot].hash != 0) slot = (slot + 1) & mask;
+            table[slot] = {hash, first_sequence + held.size()};
+        }
+        else hash = 0;
+    }
+
+    dedup_entry_s entry;
+    entry.frame = std::move(frame);
+    entry.time = time;
+    entry.hash = hash;
+    entry.arrival = std::chrono::steady_clock::now();
+    held.push(std::move(entry));
+}
+
+bool DuplicateFilter::pop(FrameRef& frame, bool flush)
+{
+    if (held.empty()) return false;
+    dedup_entry_s& entry = held.front();
+
+    // The window is closed when a packet captured after it arrived (packets come in capture order)
+    bool ready = flush || held.size() > DEDUP_MAX_PENDING || latest_time - entry.time > window;
+    if (!ready && entry.arrival + std::chrono::milliseconds(DEDUP_MAX_HOLD_MS) <= std::chrono::steady_clock::now()) ready = true;
+    if (!ready) return false;
+
+    if (entry.hash != 0) erase(entry.hash, first_sequence);
+    frame = std::move(entry.frame);
+    held.pop();
+    first_sequence++;
+    return true;
+}
+
+void DuplicateFilter::erase(uint64_t hash, uint64_t sequence)
+{
+    size_t i = hash & mask;
+    while (table[i].hash != hash || table[i].sequence != sequence)
+    {
+        if (table[i].hash == 0) return;
+        i = (i + 1) & mask;
+    }
+
+    // Backward shift deletion: move back the following entries that would no longer be found
+    size_t j = i;
+    while (true)
+    {
+        j = (j + 1) & mask;
+        if (table[j].hash == 0) break;
+        size_t home = table[j].hash & mask;
+        bool between = (i <= j) ? (i < home && home <= j) : (i < home || home <= j);
+        if (between) continue;
+        table[i] = table[j];
+        i = j;
+    }
+    table[i] = {0, 0};
+}
+
+std::chrono::steady_clock::time_point DuplicateFilter::next_release()
+{
+    if (held.empty()) return std::chrono::steady_clock::time_point::max();
+    return held.front().arrival + std::chrono::milliseconds(DEDUP_MAX_HOLD_MS);
+}
+
+std::vector<dedup_stats_s> DuplicateFilter::get_stats() const
+{
+    std::vector<dedup_stats_s> stats;
+    for (size_t i = 0; i < suppressed.size(); i++)
+    {
+        stats.push_back({(int)i, suppressed[i]});
+    }
+    return stats;
+}
@@ -0,0 +1,166 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+#include <iostream>
+#include <algorithm>
+
+#include "frame_pool.hpp"
+#include "common.hpp"
+
+FrameRef::FrameRef(FramePool* pool, pooled_frame_s* frame) : pool(pool), frame(frame)
+{
+    frame->references.store(1, std::memory_order_relaxed);
+}
+
+FrameRef::FrameRef(const FrameRef& other) : pool(other.pool), frame(other.frame)
+{
+    if (frame) frame->references.fetch_add(1, std::memory_order_relaxed);
+}
+
+FrameRef::FrameRef(FrameRef&& other) noexcept : pool(other.pool), frame(other.frame)
+{
+    other.pool = nullptr;
+    other.frame = nullptr;
+}
+
+FrameRef& FrameRef::operator=(const FrameRef& other)
+{
+    if (frame == other.frame) return *this;
+    if (other.frame) other.frame->references.fetch_add(1, std::memory_order_relaxed);
+    reset();
+    pool = other.pool;
+    frame = other.frame;
+    return *this;
+}
+
+FrameRef& FrameRef::operator=(FrameRef&& other) noexcept
+{
+    if (this == &other) return *this;
+    reset();
+    pool = other.pool;
+    frame = other.frame;
+    other.pool = nullptr;
+    other.frame = nullptr;
+    return *this;
+}
+
+FrameRef::~FrameRef()
+{
+    reset();
+}
+
+void FrameRef::reset()
+{
+    if (!frame) return;
+    // The last reference returns the frame (acq_rel makes every write to the frame visible before it is reused)
+    if (frame->references.fetch_sub(1, std::memory_order_acq_rel) == 1) pool->release(frame);
+    pool = nullptr;
+    frame = nullptr;
+}
+
+FramePool::FramePool(size_t slab_size, size_t max_slabs) :
+    slab_size(slab_size), slab_limit(std::max(max_slabs, (FRAME_POOL_MAX_FRAMES + slab_size - 1) / slab_size)), max_slabs(max_slabs)
+{
+    // Only the slab pointers are allocated for the largest pool, so the maximum can be raised later without moving them
+    slabs.reset(new std::unique_ptr<pooled_frame_s[]>[slab_limit]);
+}
+
+size_t FramePool::set_max_frames(size_t frames)
+{
+    std::lock_guard<std::mutex> lock(grow_mutex);
+    size_t slabs_needed = std::min((frames + slab_size - 1) / slab_size, slab_limit);
+    max_slabs.store(std::max(slabs_needed, (size_t)1), std::memory_order_relaxed);
+    return max_slabs.load(std::memory_order_relaxed) * slab_size;
+}
+
+bool FramePool::is_low() const
+{
+    size_t max_frames = max_slabs.load(std::memory_order_relaxed) * slab_size;
+    return in_use.load(std::memory_order_relaxed) + (max_frames >> FRAME_POOL_LOW_SHIFT) >= max_frames;
+}
+
+pooled_frame_s* FramePool::pop_free()
+{
+    // Acquire pairs with the release of push_free, so the slab and the links of the popped frame are visible
+    uint64_t head = free_head.load(std::memory_order_acquire);
+    while ((uint32_t)head != 0)
+    {
+        pooled_frame_s* frame = frame_at((uint32_t)head - 1);
+        uint64_t next = ((head >> 32) + 1) << 32 | frame->next_free.load(std::memory_order_relaxed);
+        if (free_head.compare_exchange_weak(head, next, std::memory_order_acq_rel, std::memory_order_acquire)) return frame;
+    }
+    return nullptr;
+}
+
+void FramePool::push_free(pooled_frame_s* first, pooled_frame_s* last)
+{
+    uint64_t head = free_head.load(std::memory_order_relaxed);
+    uint64_t next;
+    do
+    {
+        last->next_free.store((uint32_t)head, std::memory_order_relaxed);
+        next = ((head >> 32) + 1) << 32 | (first->index + 1);
+    } while (!free_head.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+}
+
+FrameRef FramePool::acquire()
+{
+    pooled_frame_s* frame = pop_free();
+    if (!frame)
+    {
+        std::lock_guard<std::mutex> lock(grow_mutex);
+        // Another thread may have grown the pool while waiting for the lock
+        frame = pop_free();
+        size_t slab = num_slabs.load(std::memory_order_relaxed);
+        if (!frame && slab < max_slabs.load(std::memory_order_relaxed))
+        {
+            // Grow by one slab: the first frame is taken and the others are linked and pushed at once
+            slabs[slab].reset(new pooled_frame_s[slab_size]);
+            pooled_frame_s* frames = slabs[slab].get();
+            for (size_t i = 0; i < slab_size; i++)
+            {
+                frames[i].index = (uint32_t)(slab * slab_size + i);
+                frames[i].next_free.store(frames[i].index + 2, std::memory_order_relaxed);
+            }
+            num_slabs.store(slab + 1, std::memory_order_relaxed);
+            frame = &frames[0];
+            if (slab_size > 1) push_free(&frames[1], &frames[slab_size - 1]);
+        }
+    }
+
+    if (!frame)
+    {
+        if (exhausted.fetch_add(1, std::memory_order_relaxed) == 0)
+        {
+            D(std::cout << "[WARNING] Frame pool is exhausted (" << std::dec << slab_size * max_slabs.load(std::memory_order_relaxed) << " frames in use). Dropping packets until frames are released." << std::endl;)
+        }
+        return FrameRef();
+    }
+
+    size_t used = in_use.fetch_add(1, std::memory_order_relaxed) + 1;
+    size_t high = high_water_mark.load(std::memory_order_relaxed);
+    while (used > high && !high_water_mark.compare_exchange_weak(high, used, std::memory_order_relaxed)) {}
+    return FrameRef(this, frame);
+}
+
+void FramePool::release(pooled_frame_s* frame)
+{
+    in_use.fetch_sub(1, std::memory_order_relaxed);
+    push_free(frame, frame);
+}
+
+frame_pool_stats_s FramePool::get_stats()
+{
+    return {num_slabs.load(std::memory_order_relaxed) * slab_size, slab_size * max_slabs.load(std::memory_order_relaxed), in_use.load(std::memory_order_relaxed),
+            high_water_mark.load(std::memory_order_relaxed), exhausted.load(std::memory_order_relaxed)};
+}
@@ -57,7 +57,9 @@ FrameState Framer::process(uint8_t byte)
             break;
         case FrameState::S_LENGTH_2:
             data_length = (byte << 8) | data_length;
-            state = FrameState::S_DATA;
+            // Frames larger than the payload buffer are not valid sniffer frames
+            if(data_length > FRAME_DATA_MAX_SIZE) state = FrameState::S_ERROR;
+            else state = FrameState::S_DATA;
             break;
         case FrameState::S_DATA:
             frame_payload[current_data_index] = byte;
@@ -0,0 +1,89 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+#include <iostream>
+#include <cctype>
+
+#include "interface_registry.hpp"
+#include "command_assembler.hpp"
+#include "common.hpp"
+
+std::mutex InterfaceRegistry::m_mutex;
+interface_entry_s InterfaceRegistry::entries[MAX_INTERFACES];
+std::atomic<uint16_t> InterfaceRegistry::entries_count{0};
+
+bool InterfaceRegistry::intern(const std::string& name, uint8_t mode, int channel, uint16_t& id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint16_t count = entries_count.load(std::memory_order_relaxed);
+    for (uint16_t i = 0; i < count; i++)
+    {
+        if (entries[i].name == name && entries[i].mode == mode && entries[i].channel == channel)
+        {
+            id = i;
+            return true;
+        }
+    }
+
+    CommandAssembler command_assembler;
+    float freq;
+    if (mode >= sizeof(radio_mode_table[0]) / sizeof(radio_mode_table[0][0]))
+    {
+        std::cout << "[ERROR] Invalid Radio Mode " << std::dec << (int)mode << " for interface " << name << ". Check table to see available values with ./tuxniffer -l." << std::endl;
+        return false;
+    }
+    if (!command_assembler.tryCalculateFinalFreq(mode, radio_mode_table[0][mode].freq, channel, &freq))
+    {
+        std::cout << "[ERROR] Invalid channel " << std::dec << channel << " for Radio Mode " << (int)mode << " on interface " << name << ". Check table to see available values with ./tuxniffer -l." << std::endl;
+        return false;
+    }
+    if (count >= MAX_INTERFACES)
+    {
+        std::cout << "[ERROR] Too many interfaces registered (" << std::dec << MAX_INTERFACES << "). Interface " << name << " was not registered." << std::endl;
+        return false;
+    }
+
+    // The interface number is made of the digits in the name (e.g. /dev/ttyACM0 is 0 and COM3 is 3)
+    uint32_t number = 0;
+    for (char c : name)
+    {
+        if (std::isdigit(static_cast<unsigned char>(c))) number = number * 10 + (c - '0');
+    }
+    interface_entry_s& entry = entries[count];
+    entry.name = name;
+    entry.mode = mode;
+    entry.channel = channel;
+    entry.number = static_cast<uint16_t>(number);
+
+    // Interface as 16 bits (inverted endianess), protocol, phy, frequency and channel as 16 bits
+    uint8_t* prefix = entry.ti_rpi_prefix;
+    prefix[0] = entry.number & 0xFF;
+    prefix[1] = entry.number >> 8;
+    prefix[2] = command_assembler.get_protocol_value(mode);
+    prefix[3] = command_assembler.get_ti_phy_value(mode);
+    command_assembler.convertFreqToByte(freq, &prefix[4]);
+    prefix[8] = channel & 0xFF;
+    prefix[9] = channel >> 8;
+
+    // Publish the entry only after it is complete
+    entries_count.store(count + 1, std::memory_order_release);
+    id = count;
+    return true;
+}
+
+const interface_entry_s& InterfaceRegistry::get(uint16_t id)
+{
+    static const interface_entry_s unknown = {"", 0, 0, 0, {0}};
+    if (id >= entries_count.load(std::memory_order_acquire)) return unknown;
+    return entries[id];
+}
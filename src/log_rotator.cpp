@@ -0,0 +1,222 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <cstdio>
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#include "log_rotator.hpp"
+#include "common.hpp"
+
+LogRotator::LogRotator(Opener opener, int max_sets) : opener(opener), max_sets(max_sets)
+{
+    thread = std::thread(&LogRotator::run, this);
+}
+
+LogRotator::~LogRotator()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    cv.notify_one();
+    if (thread.joinable()) thread.join();
+}
+
+void LogRotator::prepare(uint64_t index, std::chrono::system_clock::time_point when)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = true;
+        pending_index = index;
+        pending_when = when;
+    }
+    cv.notify_one();
+}
+
+bool LogRotator::take(uint64_t index, log_file_set_s& set)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    taken_index = index;
+    // The rotation is due: it will not be opened in the background anymore
+    if (pending && pending_index <= index) pending = false;
+    if (!ready) return false;
+    ready = false;
+    if (ready_index != index)
+    {
+        closing.emplace_back(std::move(ready_set), true);
+        ready_set = log_file_set_s();
+        return false;
+    }
+    set = std::move(ready_set);
+    ready_set = log_file_set_s();
+    return true;
+}
+
+void LogRotator::retire(log_file_set_s& set)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing.emplace_back(std::move(set), false);
+    }
+    set = log_file_set_s();
+    cv.notify_one();
+}
+
+void LogRotator::preallocate(FILE* file, uint64_t bytes)
+{
+#ifdef __linux__
+    if (!file || bytes == 0) return;
+    // Only reserves the blocks: readers still see the size of the data written
+    if (fallocate(fileno(file), FALLOC_FL_KEEP_SIZE, 0, (off_t)bytes) != 0)
+    {
+        D(char* errmsg = custom_strerror(errno);
+            std::cout << "[WARNING] Could not preallocate log file" << errmsg << "." << std::endl;
+            free(errmsg);)
+    }
+#else
+    (void)file;
+    (void)bytes;
+#endif
+}
+
+void LogRotator::close_set(log_file_set_s& set, bool remove)
+{
+    for (size_t i = 0; i < set.files.size(); i++)
+    {
+        FILE* file = set.files[i];
+        if (!file) continue;
+        if (!remove)
+        {
+            fflush(file);
+#ifdef _WIN32
+            _commit(_fileno(file));
+#else
+            // Release the preallocated blocks after the data (the records are written to the descriptor, at its offset)
+            off_t end = lseek(fileno(file), 0, SEEK_CUR);
+            if (end >= 0 && ftruncate(fileno(file), end) != 0)
+            {
+                D(std::cout << "[WARNING] Could not truncate log file: " << (i < set.paths.size() ? set.paths[i] : "") << "." << std::endl;)
+            }
+            fsync(fileno(file));
+#endif
+        }
+        fclose(file);
+        if (remove && i < set.paths.size()) std::remove(set.paths[i].c_str());
+    }
+    for (size_t i = 0; i < set.index_files.size(); i++)
+    {
+        FILE* file = set.index_files[i];
+        if (!file) continue;
+        if (!remove)
+        {
+            fflush(file);
+#ifdef _WIN32
+            _commit(_fileno(file));
+#else
+            fsync(fileno(file));
+#endif
+        }
+        fclose(file);
+        if (remove && i < set.index_paths.size()) std::remove(set.index_paths[i].c_str());
+    }
+    set.files.clear();
+    set.paths.clear();
+    set.index_files.clear();
+    set.index_paths.clear();
+    set.data_offsets.clear();
+}
+
+void LogRotator::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        // Close the retired file sets first, they are the ones holding data
+        if (!closing.empty())
+        {
+            std::pair<log_file_set_s, bool> entry = std::move(closing.front());
+            closing.pop_front();
+            lock.unlock();
+            std::vector<std::string> paths = entry.first.paths;
+            paths.insert(paths.end(), entry.first.index_paths.begin(), entry.first.index_paths.end());
+            close_set(entry.first, entry.second);
+            if (!entry.second && max_sets > 0)
+            {
+                // The set being written counts towards the sets kept
+                kept.push_back(paths);
+                while ((int)kept.size() > max_sets - 1)
+                {
+                    for (const auto& path : kept.front())
+                    {
+                        if (!path.empty() && std::remove(path.c_str()) == 0)
+                        {
+                            D(std::cout << "[INFO] Log file removed: " << path << "." << std::endl;)
+                        }
+                    }
+                    kept.pop_front();
+                }
+            }
+            lock.lock();
+            continue;
+        }
+        if (!running) break;
+        if (!pending)
+        {
+            cv.wait(lock);
+            continue;
+        }
+
+        auto open_time = pending_when - std::chrono::seconds(LOG_ROTATION_PREPARE_LEAD);
+        if (std::chrono::system_clock::now() < open_time)
+        {
+            cv.wait_until(lock, open_time);
+            continue;
+        }
+
+        uint64_t index = pending_index;
+        std::chrono::system_clock::time_point when = pending_when;
+        pending = false;
+        lock.unlock();
+        log_file_set_s set;
+        bool opened = opener(index, when, set);
+        lock.lock();
+        if (!opened)
+        {
+            // The output manager opens the files itself when the rotation is due
+            close_set(set, true);
+            continue;
+        }
+        // Discard the file set if its rotation already happened, or the one it replaces if it was not taken
+        if (index <= taken_index)
+        {
+            closing.emplace_back(std::move(set), true);
+            continue;
+        }
+        if (ready) closing.emplace_back(std::move(ready_set), true);
+        ready_set = std::move(set);
+        ready_index = index;
+        ready = true;
+    }
+
+    // Remove the file set prepared for a rotation that did not happen
+    if (ready)
+    {
+        ready = false;
+        close_set(ready_set, true);
+    }
+}
@@ -43,6 +43,7 @@ SOFTWARE.
 #include "common.hpp"
 #include "fkYAML.hpp"
 #include "sniffer.hpp"
+#include "capture_index.hpp"
 
 #ifdef __linux__
     #define DEFAULT_PIPE_PATH "/tmp/"
@@ -60,6 +61,7 @@ void print_version() {
 void print_help()
 {
     std::cout << "Usage: ./tuxniffer -p <port> -m <mode> -c <channel> [options]" << std::endl;
+    std::cout << "       ./tuxniffer extract <log file> <from> <to> <output file>" << std::endl;
     std::cout << "Options:" << std::endl;
     std::cout << "  -h, --help          \tShow this help message and exit." << std::endl;
     std::cout << "  -l, --list_modes    \tShow radio mode table and exit." << std::endl;
@@ -68,15 +70,25 @@ void print_help()
     std::cout << "  -p, --port          \tSerial port to connect to." << std::endl;
     std::cout << "  -m, --radio_mode    \tRadio mode to use." << std::endl;
     std::cout << "  -c, --channel       \tChannel to use." << std::endl;
+    std::cout << "Replay (optional)" << std::endl;
+    std::cout << "  -x, --replay        \tReplay a pcap/pcapng file instead of a serial port (-p not required). -m and -c are written to the output." << std::endl;
+    std::cout << "  -s, --replay_speed  \tReplay speed relative to the capture (default 1, real time; 0 replays as fast as possible)." << std::endl;
     std::cout << "Log Settings (optional)" << std::endl;
     std::cout << "  -n, --name          \tPipe name / log file name (.pcap)." << std::endl;
     std::cout << "  -P, --path          \tPath to save file." << std::endl;
     std::cout << "  -r, --reset_period  \tLog file reset period (none | hourly | daily | weekly | monthly)." << std::endl;
+    std::cout << "  -f, --format        \tLog file format (pcap | pcapng). pcapng keeps the capturing device of each packet in a single file." << std::endl;
     std::cout << "Others (optional)" << std::endl;
     std::cout << "  -k, --key_extraction\tTry to decrypt zigbee packets and print keys extracted from transport packets. Save extracted keys in keys.txt." << std::endl;
     std::cout << "  -t, --time_duration \tSniffing duration in seconds. Runs indefinitely when missing." << std::endl;
+    std::cout << "  -R, --reactor       \tStream all devices from a single event loop instead of one thread per device (Linux only)." << std::endl;
+    std::cout << "  -w, --merge_window  \tMilliseconds a packet waits for the other devices to be written in capture order (default 100, 0 disables)." << std::endl;
+    std::cout << "  -d, --dedup_window  \tMicroseconds between copies of a frame captured by different devices to keep only the one with the best RSSI (default 0, disabled)." << std::endl;
     std::cout << "  -i, --input         \tInput config file. When present Device Settings flags are no longer required." << std::endl;
     std::cout << "  -y, --yaml_example  \tShow default .yaml config file and exit." << std::endl;
+    std::cout << "Extract" << std::endl;
+    std::cout << "  extract             \tCopy the packets of a UTC time range of a log file to a new file, using its index (log.index) when present." << std::endl;
+    std::cout << "                      \tTimes are as written in the packets: YYYY-MM-DD HH:MM:SS[.ffffff] or seconds since epoch." << std::endl;
     std::cout << "(See README.md for more information)." << std::endl;
 }
 
@@ -120,6 +132,10 @@ void print_default_config_file() {
               << "# - port: /dev/ttyACM2\n"
               << "#   radio_mode: 20\n"
               << "#   channel: 25\n"
+              << "# - replay: capture.pcap   # Replays a pcap/pcapng file instead of a serial port (port not required).\n"
+              << "#   replaySpeed: 1         # Speed relative to the capture (1 is real time, 0 as fast as possible).\n"
+              << "#   radio_mode: 20\n"
+              << "#   channel: 25\n"
               << "\n"
               << "## Optional log parameters. Values below are the default ones.\n"
               << "# log:\n"
@@ -128,6 +144,15 @@ void print_default_config_file() {
               << "#   base_name: aceno          # Log file name.\n"
               << "#   splitDevicesLog: false    # Set true to create a separate log file for each device ([name]_[device_id].pcap).\n"
               << "#   resetPeriod: none         # Log file reset period  (none | hourly | daily | weekly | monthly).\n"
+              << "#   format: pcap              # Log file format (pcap | pcapng). pcapng describes each device as an interface and adds RSSI and FCS to each packet.\n"
+              << "#   queueSizeKB: 16384        # Memory budget of the packets waiting to be written to the log files, for each device.\n"
+              << "#   queuePolicy: drop-newest  # What to do when the budget is reached (drop-newest | block). block waits up to 50 ms for room, then drops the packet.\n"
+              << "#   rotateSizeMB: 0           # Start a new log file when the current one reaches this size (0 to disable). The files are numbered ([name]_[number].pcap) and preallocated.\n"
+              << "#   rotatePackets: 0          # Start a new log file when the current one has this number of packets (0 to disable).\n"
+              << "#   maxFiles: 0               # Number of log files kept when they rotate, the oldest are removed (0 to keep all). With splitDevicesLog, the files of every device rotate together and count as one.\n"
+              << "#   index: false              # Set true to write a sidecar index of each log file ([log file].idx), used by the extract command.\n"
+              << "#   indexPackets: 1000        # Maximum number of packets between two index entries.\n"
+              << "#   indexIntervalMs: 1000     # Maximum time between two index entries.\n"
               << "\n"
               << "## Optional pipe parameters. Values below are the default ones.\n"
               << "# pipe:\n"
@@ -135,6 +160,35 @@ void print_default_config_file() {
               << "#   name: aceno               # Pipe file name.\n"
               << "#   path: /tmp/               # Path to save pipe file. On Windows the path name is ignored because the only path is \\\\.\\pipe\\.\n"
               << "#   splitDevicesPipe: false   # Set true to create a separate log file for each device ([name]_[device_id]).\n"
+              << "#   queueSizeKB: 65536        # Memory budget of the packets waiting for the pipe consumer, for each pipe.\n"
+              << "#   queuePolicy: drop-oldest  # What to do when the budget is reached (drop-oldest | drop-newest | spill). spill writes the packets to [path][name].spill, also while there is no consumer, and sends them when a consumer connects.\n"
+              << "#   spillSizeMB: 1024         # Maximum size of the spill file (it is reused as a ring). Packets are dropped when it is full.\n"
+              << "#   spillRecover: false       # Set true to keep the packets not sent in the spill file for the next run (otherwise the file is removed on exit).\n"
+              << "\n"
+              << "## Optional socket parameters. Values below are the default ones.\n"
+              << "# socket:\n"
+              << "#   enabled: false            # Set true to serve the pcap stream to any number of clients on a Unix domain socket (Linux only).\n"
+              << "#   path: /tmp/aceno.sock     # Path of the socket.\n"
+              << "#   bufferSizeKB: 16384       # Size of the buffer shared by the clients. A client that lags more than this behind the capture is slow.\n"
+              << "#   slowClient: skip          # What to do with a slow client (skip: jump to the oldest buffered packet | drop: disconnect it).\n"
+              << "#   clientQueueKB: 0          # Maximum data waiting to be sent to a client before it is slow (0 is the buffer size).\n"
+              << "\n"
+              << "## Optional TCP parameters. Values below are the default ones.\n"
+              << "# tcp:\n"
+              << "#   enabled: false            # Set true to serve the pcap stream to remote clients over TCP (pcap over IP, Linux only).\n"
+              << "#   address: 127.0.0.1:57012  # Address and port to listen on (0.0.0.0 for every interface). IPv6 addresses go in brackets ([::1]:57012).\n"
+              << "#   bufferSizeKB: 16384       # Size of the buffer shared by the clients.\n"
+              << "#   slowClient: skip          # What to do with a slow client (skip: jump to the oldest packet within its queue | drop: disconnect it).\n"
+              << "#   clientQueueKB: 4096       # Maximum data waiting to be sent to a client before it is slow.\n"
+              << "#   noDelay: true             # Set false to enable Nagle's algorithm on the connections.\n"
+              << "#   batchSizeKB: 16           # Data waiting for a client before it is sent (0 sends each packet immediately).\n"
+              << "#   batchDelayMs: 5           # Maximum time data waits for a batch.\n"
+              << "\n"
+              << "## Optional shared memory parameters. Values below are the default ones.\n"
+              << "# shm:\n"
+              << "#   enabled: false            # Set true to publish the packets to a shared memory ring, read in place by local consumers with include/shm_ring.hpp (Linux only).\n"
+              << "#   name: /aceno              # Name of the shared memory (/dev/shm/aceno).\n"
+              << "#   bufferSizeKB: 16384       # Size of the ring. Readers that lag more than this lose the oldest packets.\n"
               << "\n"
               << "## Optional crypto parameters. Values below are the default ones.\n"
               << "# crypto:\n"
@@ -155,13 +209,24 @@ void print_default_config_file() {
               << "## Optional time in seconds to execute the sniffer. When -1 runs indefinitely (default).\n"
               << "# duration: -1\n"
               << "\n"
+              << "## Optional. Set true to stream all devices from a single event loop instead of one thread per device (Linux only).\n"
+              << "# reactor: false\n"
+              << "\n"
+              << "## Optional. Milliseconds a packet waits for the packets of the other devices, so devices sharing a log file or pipe\n"
+              << "## are written in capture order. Packets arriving later are written anyway and reported as late. 0 disables the merge.\n"
+              << "# merge_window: 100\n"
+              << "\n"
+              << "## Optional. Microseconds between copies of the same frame captured by different devices (overlapping or redundant\n"
+              << "## channels) to keep only the copy with the best RSSI. 0 disables the duplicate filter.\n"
+              << "# dedup_window: 0\n"
+              << "\n"
               << "## You can add more devices to the list, but for each one, you need to set valid\n"
               << "## values for all three required parameters (port, radio mode, and channel).\n"
               << "## For log and pipe options, you can only set the parameters you want to change.\n";
 }
 
 
-std::vector<device_s> parse_input_file_yaml(const std::string& filePath, log_s* log, int* duration)
+std::vector<device_s> parse_input_file_yaml(const std::string& filePath, log_s* log, int* duration, bool* reactor)
 {
     if (filePath.empty() || log == nullptr)
     {
@@ -203,15 +268,28 @@ std::vector<device_s> parse_input_file_yaml(const std::string& filePath, log_s*
     // Parse the devices
     for (auto& device : yaml["devices"]) {
         // Checks if all required fields exists
-        if (!device.contains("port") || !device.contains("radio_mode") || !device.contains("channel")) {
-            D(std::cout << "[ERROR] Missing required fields (port, radio_mode, or channel) for a device. Skipping device." << std::endl;)
+        if ((!device.contains("port") && !device.contains("replay")) || !device.contains("radio_mode") || !device.contains("channel")) {
+            D(std::cout << "[ERROR] Missing required fields (port or replay, radio_mode, or channel) for a device. Skipping device." << std::endl;)
             continue;
         }
-        devices.push_back(device_s{
-            device["port"].get_value<std::string>(),
+        double replay_speed = 1.0;
+        if (device.contains("replaySpeed")) {
+            auto& speed = device["replaySpeed"];
+            // Whole numbers are integer nodes, which fkyaml does not convert to float
+            replay_speed = speed.is_integer() ? speed.get_value<int>() : speed.get_value<double>();
+        }
+        if (replay_speed < 0) {
+            D(std::cout << "[ERROR] Invalid replay speed. Defaulting to 1 (real time)." << std::endl;)
+            replay_speed = 1.0;
+        }
+        device_s settings{
+            device.contains("port") ? device["port"].get_value<std::string>() : device["replay"].get_value<std::string>(),
             device["radio_mode"].get_value<int>(),
-            device["channel"].get_value<int>()
-        });
+            device["channel"].get_value<int>(),
+            device.contains("replay") ? device["replay"].get_value<std::string>() : std::string(),
+            replay_speed
+        };
+        devices.push_back(settings);
     }
 
     // Parse the log settings
@@ -222,20 +300,153 @@ std::vector<device_s> parse_input_file_yaml(const std::string& filePath, log_s*
     log->file.base_name =           yaml_log.contains("base_name")          ? yaml_log["base_name"].get_value<std::string>()    : "aceno";
     log->file.split_devices_log =   yaml_log.contains("splitDevicesLog")    ? yaml_log["splitDevicesLog"].get_value<bool>()     : false;
     log->file.reset_period =        yaml_log.contains("resetPeriod")        ? yaml_log["resetPeriod"].get_value<std::string>()  : "none";
+    log->file.format =              yaml_log.contains("format")             ? yaml_log["format"].get_value<std::string>()       : "pcap";
+    log->file.queue_size_kb =       yaml_log.contains("queueSizeKB")        ? yaml_log["queueSizeKB"].get_value<int>()          : 16384;
+    log->file.queue_policy =        yaml_log.contains("queuePolicy")        ? yaml_log["queuePolicy"].get_value<std::string>()  : "drop-newest";
+    log->file.rotate_size_mb =      yaml_log.contains("rotateSizeMB")       ? yaml_log["rotateSizeMB"].get_value<int>()         : 0;
+    log->file.rotate_packets =      yaml_log.contains("rotatePackets")      ? yaml_log["rotatePackets"].get_value<int>()        : 0;
+    log->file.max_files =           yaml_log.contains("maxFiles")           ? yaml_log["maxFiles"].get_value<int>()             : 0;
+    log->file.index =               yaml_log.contains("index")              ? yaml_log["index"].get_value<bool>()               : false;
+    log->file.index_packets =       yaml_log.contains("indexPackets")       ? yaml_log["indexPackets"].get_value<int>()         : 1000;
+    log->file.index_interval_ms =   yaml_log.contains("indexIntervalMs")    ? yaml_log["indexIntervalMs"].get_value<int>()      : 1000;
 
     // Checks if reset period is valid, if not, default to none
-    if(log->file.reset_period != "none" && log->file.reset_period != "hourly" && log->file.reset_period != "daily" && log->file.reset_period != "weekly" && log->file.reset_period != "monthly") {
+    ResetPeriod reset_period;
+    if(!parse_reset_period(log->file.reset_period, reset_period)) {
         D(std::cout << "[ERROR] Invalid reset period for file log. Defaulting to none." << std::endl;)
         log->file.reset_period = "none";
     }
 
+    // Checks if format is valid, if not, default to pcap
+    if(log->file.format != "pcap" && log->file.format != "pcapng") {
+        D(std::cout << "[ERROR] Invalid format for file log. Defaulting to pcap." << std::endl;)
+        log->file.format = "pcap";
+    }
+
+    // Checks if the queue settings are valid, if not, use the defaults (the log file queues can only drop new packets or block)
+    QueuePolicy policy;
+    if(!parse_queue_policy(log->file.queue_policy, policy) || (policy != QueuePolicy::DROP_NEWEST && policy != QueuePolicy::BLOCK)) {
+        D(std::cout << "[ERROR] Invalid queue policy for file log. Defaulting to drop-newest." << std::endl;)
+        log->file.queue_policy = "drop-newest";
+    }
+    if(log->file.queue_size_kb <= 0) {
+        D(std::cout << "[ERROR] Invalid queue size for file log. Defaulting to 16384 KB." << std::endl;)
+        log->file.queue_size_kb = 16384;
+    }
+
+    // Checks if the rotation settings are valid, if not, disable them
+    if(log->file.rotate_size_mb < 0 || log->file.rotate_packets < 0 || log->file.max_files < 0) {
+        D(std::cout << "[ERROR] Invalid rotation settings for file log. Defaulting to 0 (disabled)." << std::endl;)
+        if(log->file.rotate_size_mb < 0) log->file.rotate_size_mb = 0;
+        if(log->file.rotate_packets < 0) log->file.rotate_packets = 0;
+        if(log->file.max_files < 0) log->file.max_files = 0;
+    }
+    if(log->file.index_packets <= 0 || log->file.index_interval_ms <= 0) {
+        D(std::cout << "[ERROR] Invalid index interval for file log. Defaulting to 1000 packets and 1000 ms." << std::endl;)
+        log->file.index_packets = 1000;
+        log->file.index_interval_ms = 1000;
+    }
+
     yaml_log = yaml["pipe"];
     // Property                     Optional Field                          Read Value                                          Default Value 
     log->pipe.enabled =             yaml_log.contains("enabled")            ? yaml_log["enabled"].get_value<bool>()             : true;
     log->pipe.path =                yaml_log.contains("path")               ? yaml_log["path"].get_value<std::string>()         : DEFAULT_PIPE_PATH;
     log->pipe.base_name =           yaml_log.contains("base_name")          ? yaml_log["base_name"].get_value<std::string>()    : "aceno";
     log->pipe.split_devices_log =   yaml_log.contains("splitDevicesPipe")   ? yaml_log["splitDevicesPipe"].get_value<bool>()    : false;
+    log->pipe.queue_size_kb =       yaml_log.contains("queueSizeKB")        ? yaml_log["queueSizeKB"].get_value<int>()          : 65536;
+    log->pipe.queue_policy =        yaml_log.contains("queuePolicy")        ? yaml_log["queuePolicy"].get_value<std::string>()  : "drop-oldest";
+    log->pipe.spill_size_mb =       yaml_log.contains("spillSizeMB")        ? yaml_log["spillSizeMB"].get_value<int>()          : 1024;
+    log->pipe.spill_recover =       yaml_log.contains("spillRecover")       ? yaml_log["spillRecover"].get_value<bool>()        : false;
     log->pipe.reset_period = "none";
+    log->pipe.format = "pcap";
+
+    // Checks if the queue settings are valid, if not, use the defaults (a pipe can not block, since it would stall the other outputs)
+    if(!parse_queue_policy(log->pipe.queue_policy, policy) || policy == QueuePolicy::BLOCK) {
+        D(std::cout << "[ERROR] Invalid queue policy for pipe. Defaulting to drop-oldest." << std::endl;)
+        log->pipe.queue_policy = "drop-oldest";
+    }
+    if(log->pipe.spill_size_mb <= 0) {
+        D(std::cout << "[ERROR] Invalid spill size for pipe. Defaulting to 1024 MB." << std::endl;)
+        log->pipe.spill_size_mb = 1024;
+    }
+    if(log->pipe.queue_size_kb <= 0) {
+        D(std::cout << "[ERROR] Invalid queue size for pipe. Defaulting to 65536 KB." << std::endl;)
+        log->pipe.queue_size_kb = 65536;
+    }
+
+    yaml_log = yaml["socket"];
+    // Property                     Optional Field                          Read Value                                          Default Value 
+    log->socket.enabled =           yaml_log.contains("enabled")            ? yaml_log["enabled"].get_value<bool>()             : false;
+    log->socket.address =           yaml_log.contains("path")               ? yaml_log["path"].get_value<std::string>()         : "/tmp/aceno.sock";
+    log->socket.buffer_size_kb =    yaml_log.contains("bufferSizeKB")       ? yaml_log["bufferSizeKB"].get_value<int>()         : 16384;
+    log->socket.slow_client =       yaml_log.contains("slowClient")         ? yaml_log["slowClient"].get_value<std::string>()   : "skip";
+    log->socket.client_queue_kb =   yaml_log.contains("clientQueueKB")      ? yaml_log["clientQueueKB"].get_value<int>()        : 0;
+
+    // Checks if the socket settings are valid, if not, use the defaults
+    if(log->socket.slow_client != "skip" && log->socket.slow_client != "drop") {
+        D(std::cout << "[ERROR] Invalid slow client policy for socket. Defaulting to skip." << std::endl;)
+        log->socket.slow_client = "skip";
+    }
+    if(log->socket.buffer_size_kb <= 0) {
+        D(std::cout << "[ERROR] Invalid buffer size for socket. Defaulting to 16384 KB." << std::endl;)
+        log->socket.buffer_size_kb = 16384;
+    }
+    if(log->socket.client_queue_kb < 0) {
+        D(std::cout << "[ERROR] Invalid client queue size for socket. Defaulting to the buffer size." << std::endl;)
+        log->socket.client_queue_kb = 0;
+    }
+
+    yaml_log = yaml["tcp"];
+    // Property                     Optional Field                          Read Value                                          Default Value 
+    log->tcp.enabled =              yaml_log.contains("enabled")            ? yaml_log["enabled"].get_value<bool>()             : false;
+    log->tcp.address =              yaml_log.contains("address")            ? yaml_log["address"].get_value<std::string>()      : "127.0.0.1:57012";
+    log->tcp.buffer_size_kb =       yaml_log.contains("bufferSizeKB")       ? yaml_log["bufferSizeKB"].get_value<int>()         : 16384;
+    log->tcp.slow_client =          yaml_log.contains("slowClient")         ? yaml_log["slowClient"].get_value<std::string>()   : "skip";
+    log->tcp.client_queue_kb =      yaml_log.contains("clientQueueKB")      ? yaml_log["clientQueueKB"].get_value<int>()        : 4096;
+    log->tcp.no_delay =             yaml_log.contains("noDelay")            ? yaml_log["noDelay"].get_value<bool>()             : true;
+    log->tcp.batch_size_kb =        yaml_log.contains("batchSizeKB")        ? yaml_log["batchSizeKB"].get_value<int>()          : 16;
+    log->tcp.batch_delay_ms =       yaml_log.contains("batchDelayMs")       ? yaml_log["batchDelayMs"].get_value<int>()         : 5;
+
+    // Checks if the TCP settings are valid, if not, use the defaults
+    const std::string& address = log->tcp.address;
+    bool bracketed = !address.empty() && address.front() == '[' && address.find("]:") != std::string::npos;
+    if(!bracketed && (address.find(':') == std::string::npos || address.find(':') != address.rfind(':'))) {
+        D(std::cout << "[ERROR] Invalid TCP address (it must be host:port, or [address]:port for IPv6). Defaulting to 127.0.0.1:57012." << std::endl;)
+        log->tcp.address = "127.0.0.1:57012";
+    }
+    if(log->tcp.slow_client != "skip" && log->tcp.slow_client != "drop") {
+        D(std::cout << "[ERROR] Invalid slow client policy for TCP. Defaulting to skip." << std::endl;)
+        log->tcp.slow_client = "skip";
+    }
+    if(log->tcp.buffer_size_kb <= 0) {
+        D(std::cout << "[ERROR] Invalid buffer size for TCP. Defaulting to 16384 KB." << std::endl;)
+        log->tcp.buffer_size_kb = 16384;
+    }
+    if(log->tcp.client_queue_kb < 0) {
+        D(std::cout << "[ERROR] Invalid client queue size for TCP. Defaulting to 4096 KB." << std::endl;)
+        log->tcp.client_queue_kb = 4096;
+    }
+    if(log->tcp.batch_size_kb < 0 || log->tcp.batch_delay_ms < 0) {
+        D(std::cout << "[ERROR] Invalid batch settings for TCP. Defaulting to 16 KB and 5 ms." << std::endl;)
+        log->tcp.batch_size_kb = 16;
+        log->tcp.batch_delay_ms = 5;
+    }
+
+    yaml_log = yaml["shm"];
+    // Property                     Optional Field                          Read Value                                          Default Value 
+    log->shm.enabled =              yaml_log.contains("enabled")            ? yaml_log["enabled"].get_value<bool>()             : false;
+    log->shm.name =                 yaml_log.contains("name")               ? yaml_log["name"].get_value<std::string>()         : "/aceno";
+    log->shm.buffer_size_kb =       yaml_log.contains("bufferSizeKB")       ? yaml_log["bufferSizeKB"].get_value<int>()         : 16384;
+
+    // Checks if the shared memory settings are valid, if not, use the defaults
+    if(log->shm.name.empty() || log->shm.name[0] != '/') {
+        D(std::cout << "[ERROR] Invalid shared memory name (it must start with /). Defaulting to /aceno." << std::endl;)
+        log->shm.name = "/aceno";
+    }
+    if(log->shm.buffer_size_kb <= 0) {
+        D(std::cout << "[ERROR] Invalid buffer size for shared memory. Defaulting to 16384 KB." << std::endl;)
+        log->shm.buffer_size_kb = 16384;
+    }
 
     yaml_log = yaml["crypto"];
     // Property                     Optional Field                              Read Value                                                  Default Value 
@@ -264,6 +475,25 @@ std::vector<device_s> parse_input_file_yaml(const std::string& filePath, log_s*
     {
         std::cout << " seconds." << std::endl;
     }
+
+    // Takes the streaming mode from the yaml file
+    *reactor =                      yaml.contains("reactor")                    ? yaml["reactor"].get_value<bool>()                         : false;
+
+    // Takes the merge window from the yaml file
+    log->merge_window =             yaml.contains("merge_window")               ? yaml["merge_window"].get_value<int>()                     : 100;
+    if (log->merge_window < 0)
+    {
+        D(std::cout << "[ERROR] Invalid merge window. Defaulting to 100 ms." << std::endl;)
+        log->merge_window = 100;
+    }
+
+    // Takes the duplicate filter window from the yaml file
+    log->dedup_window =             yaml.contains("dedup_window")               ? yaml["dedup_window"].get_value<int>()                     : 0;
+    if (log->dedup_window < 0)
+    {
+        D(std::cout << "[ERROR] Invalid dedup window. Duplicated packets will not be filtered." << std::endl;)
+        log->dedup_window = 0;
+    }
     
 
     // Return the vector of devices
@@ -279,23 +509,56 @@ std::vector<std::string> parse_arguments(int argc, char* argv[]) {
 }
 
 
+/**
+ * @brief Runs the extract command: copies the packets of a time range of a log file to a new file.
+ * 
+ * @param args Arguments: extract <log file> <from> <to> <output file>.
+ * @return int Exit code.
+ */
+int extract_capture(const std::vector<std::string>& args)
+{
+    int64_t from, to;
+    if (args.size() != 6)
+    {
+        std::cout << "[ERROR] Usage: ./tuxniffer extract <log file> <from> <to> <output file>" << std::endl;
+        return 1;
+    }
+    if (!CaptureIndex::parse_time(args[3], from) || !CaptureIndex::parse_time(args[4], to) || to < from)
+    {
+        std::cout << "[ERROR] Invalid time range. Use YYYY-MM-DD HH:MM:SS[.ffffff] or seconds since epoch." << std::endl;
+        return 1;
+    }
+    int64_t copied = CaptureIndex::extract(args[2], from, to, args[5]);
+    if (copied < 0) return 1;
+    std::cout << "[INFO] " << std::dec << copied << " packets copied to " << args[5] << "." << std::endl;
+    return 0;
+}
+
 int main(int argc, char* argv[])
 {
     D(std::cout << "[INFO] Debug mode is on!" << std::endl;)
 
     std::vector<std::string> args = parse_arguments(argc, argv);
 
+    if (args.size() > 1 && args[1] == "extract") return extract_capture(args);
+
     bool useInput = false;
     std::string configFilePath;
     std::vector<device_s> devices;
     device_s device;
     int duration = -1;
+    bool reactor = false;
 
     // If theres no input file to config the log, use default values
     log_s log = {
-        {false, "./", "aceno", false, "none"},
-        {true, DEFAULT_PIPE_PATH, "aceno", false, "none"},
-        {false, -1, false, "keys", false, "", false, ""}
+        {false, "./", "aceno", false, "none", "pcap", 16384, "drop-newest", 0, false, 0, 0, 0, false, 1000, 1000},
+        {true, DEFAULT_PIPE_PATH, "aceno", false, "none", "pcap", 65536, "drop-oldest", 1024, false, 0, 0, 0, false, 0, 0},
+        {false, -1, false, "keys", false, "", false, ""},
+        100,
+        0,
+        {false, "/tmp/aceno.sock", 16384, "skip", 0, false, 0, 0},
+        {false, "/aceno", 16384},
+        {false, "127.0.0.1:57012", 16384, "skip", 4096, true, 16, 5}
     };
 
     for (size_t i = 1; i < args.size(); ++i) {
@@ -331,6 +594,20 @@ int main(int argc, char* argv[])
             D(std::cout << "[CONFIG] Channel: " << args[i] << std::endl;)
             device.channel = std::stoi(args[i]);
         }
+        else if (arg == "-x" || arg == "--replay") {
+            ++i;
+            D(std::cout << "[CONFIG] Replay file: " << args[i] << std::endl;)
+            device.replay = args[i];
+        }
+        else if (arg == "-s" || arg == "--replay_speed") {
+            ++i;
+            D(std::cout << "[CONFIG] Replay speed: " << args[i] << std::endl;)
+            device.replay_speed = std::stod(args[i]);
+            if (device.replay_speed < 0) {
+                std::cout << "[ERROR] Invalid replay speed. Please use a positive factor (0 replays as fast as possible)." << std::endl;
+                return 0;
+            }
+        }
         else if (arg == "-n" || arg == "--name") {
             ++i;
             D(std::cout << "[CONFIG] Name: " << args[i] << std::endl;)
@@ -341,7 +618,8 @@ int main(int argc, char* argv[])
             ++i;
             D(std::cout << "[CONFIG] Reset period: " << args[i] << std::endl;)
             std::string resetPeriod = args[i];
-            if (resetPeriod == "none" || resetPeriod == "hourly" || resetPeriod == "daily" || resetPeriod == "weekly" || resetPeriod == "monthly") {
+            ResetPeriod period;
+            if (parse_reset_period(resetPeriod, period)) {
                 log.file.reset_period = resetPeriod;
             }
             else {
@@ -349,6 +627,18 @@ int main(int argc, char* argv[])
                 return 0;
             }
         }
+        else if (arg == "-f" || arg == "--format") {
+            ++i;
+            D(std::cout << "[CONFIG] Format: " << args[i] << std::endl;)
+            std::string format = args[i];
+            if (format == "pcap" || format == "pcapng") {
+                log.file.format = format;
+            }
+            else {
+                std::cout << "[ERROR] Invalid format. Please choose from: pcap or pcapng." << std::endl;
+                return 0;
+            }
+        }
         else if (arg == "-P" || arg == "--path") {
             ++i;
             D(std::cout << "[CONFIG] Path " << args[i] << std::endl;)
@@ -359,6 +649,28 @@ int main(int argc, char* argv[])
             D(std::cout << "[CONFIG] Time duration: " << args[i] << std::endl;)
             duration = std::stoi(args[i]);
         }
+        else if (arg == "-R" || arg == "--reactor") {
+            D(std::cout << "[CONFIG] Reactor mode enabled" << std::endl;)
+            reactor = true;
+        }
+        else if (arg == "-w" || arg == "--merge_window") {
+            ++i;
+            D(std::cout << "[CONFIG] Merge window: " << args[i] << " ms" << std::endl;)
+            log.merge_window = std::stoi(args[i]);
+            if (log.merge_window < 0) {
+                std::cout << "[ERROR] Invalid merge window. Please use a number of milliseconds (0 disables the merge)." << std::endl;
+                return 0;
+            }
+        }
+        else if (arg == "-d" || arg == "--dedup_window") {
+            ++i;
+            D(std::cout << "[CONFIG] Dedup window: " << args[i] << " us" << std::endl;)
+            log.dedup_window = std::stoi(args[i]);
+            if (log.dedup_window < 0) {
+                std::cout << "[ERROR] Invalid dedup window. Please use a number of microseconds (0 disables the filter)." << std::endl;
+                return 0;
+            }
+        }
         else if (arg == "-k" || arg == "--key_extraction") {
             D(std::cout << "[CONFIG] Key extraction enabled" << std::endl;)
             log.crypto.key_extraction = true;
@@ -372,7 +684,10 @@ int main(int argc, char* argv[])
         }
     }
 
-    // If useInput is false and there are no port, radio_mode or channel, print help and exit
+    // A replayed file is identified by its path
+    if (device.port.empty()) device.port = device.replay;
+
+    // If useInput is false and there are no port (or replay file), radio_mode or channel, print help and exit
     if (!useInput && (device.port.empty() || !device.radio_mode || !device.channel)) {
         print_version();
         cout << std::endl;
@@ -386,7 +701,7 @@ int main(int argc, char* argv[])
     if (useInput) {
         std::string fileExtension = configFilePath.substr(configFilePath.find_last_of(".") + 1);
         if (fileExtension.compare(("yaml")) == 0)
-            devices = parse_input_file_yaml(configFilePath, &log, &duration);
+            devices = parse_input_file_yaml(configFilePath, &log, &duration, &reactor);
         else {
             std::cout << "[ERROR] Invalid file extension. Please use a .yaml file." << std::endl;
             return 0;
@@ -398,8 +713,9 @@ int main(int argc, char* argv[])
 
     sniffer.configureAllDevices();
     sniffer.initAllDevices();
-    if (duration != -1) sniffer.streamAll(std::chrono::seconds(duration));
-    if (duration == -1) sniffer.streamAll();
+    if (reactor) sniffer.streamAllReactor(std::chrono::seconds(duration));
+    else if (duration != -1) sniffer.streamAll(std::chrono::seconds(duration));
+    else sniffer.streamAll();
 
     return 0;
 }
\ No newline at end of file
@@ -16,6 +16,7 @@
 #include <queue>
 #include <ctime>
 #include <iomanip>
+#include <algorithm>
 #include <memory>
 #include <errno.h>
 #include <cstring> 
@@ -26,88 +27,417 @@
 #include "pcap_builder.hpp"
 #include "command_assembler.hpp"
 #include "pipe_packet_handler.hpp"
+#include "interface_registry.hpp"
+#include "capture_index.hpp"
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Converts the byte budget of a queue to a number of packets.
+ * - Each queued packet keeps a pooled frame in use, so the budget is divided by the size of a frame.
+ */
+static size_t queue_budget_packets(int size_kb)
+{
+    size_t packets = (size_t)std::max(size_kb, 0) * 1024 / sizeof(pooled_frame_s);
+    return std::max(packets, (size_t)1);
+}
+
+/**
+ * @brief Gets the time between two rotations of the log files.
+ */
+static std::chrono::system_clock::duration reset_period_length(ResetPeriod period)
+{
+    switch (period)
+    {
+        case ResetPeriod::HOURLY: return std::chrono::hours(1);
+        case ResetPeriod::DAILY: return std::chrono::hours(24);
+        case ResetPeriod::WEEKLY: return std::chrono::hours(24 * 7);
+        case ResetPeriod::MONTHLY: return std::chrono::hours(24 * 30);
+        default: return std::chrono::system_clock::duration::max();
+    }
+}
 
 OutputManager::OutputManager(log_s log_settings)
 {
     log = log_settings;
+    if (log.file.format == "pcapng") file_format = CaptureFormat::PCAPNG;
+    parse_reset_period(log.file.reset_period, reset_period);
     crypto_handler.security_level = log_settings.crypto.security_level;
+
+    queue_max_size = queue_budget_packets(log.file.queue_size_kb);
+    parse_queue_policy(log.file.queue_policy, queue_policy);
+    // The device queues are lock free with a single producer and consumer, so the producer can only drop the new packet or wait
+    if (queue_policy != QueuePolicy::DROP_NEWEST && queue_policy != QueuePolicy::BLOCK)
+    {
+        std::cout << "[WARNING] Queue policy " << log.file.queue_policy << " is not supported by the log file queues. Using drop-newest." << std::endl;
+        queue_policy = QueuePolicy::DROP_NEWEST;
+    }
 }
 
 
-void OutputManager::add_packet(packet_queue_s packet)
+void OutputManager::add_packet(FrameRef frame)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    
+    if (!frame || frame->id < 0 || frame->id >= (int)device_rings.size()) return;
+
     // Check if the queue size has reached the maximum limit
-    if ((int)packet_queue.size() >= queue_max_size)
+    int id = frame->id;
+    bool pushed = device_rings[id]->push(std::move(frame));
+    // Wait a bounded time for the run method to make room, so a stalled output can not hold the device forever
+    if (!pushed && queue_policy == QueuePolicy::BLOCK && is_running)
+    {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(QUEUE_BLOCK_TIMEOUT_MS);
+        std::unique_lock<std::mutex> lock(wakeup_mutex);
+        producers_waiting.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // Announce the wait before trying again, so room made in between is not missed
+        while (!(pushed = device_rings[id]->push(std::move(frame))) && is_running)
+        {
+            if (space_cv.wait_until(lock, deadline) == std::cv_status::timeout)
+            {
+                pushed = device_rings[id]->push(std::move(frame));
+                break;
+            }
+        }
+        producers_waiting.fetch_sub(1);
+    }
+    if (!pushed)
     {
-        packet_queue.pop();
-        D(std::cout << "[WARNING] File packet queue is full (over " << queue_max_size << " entries). Deleting oldest packet to add the new one." << std::endl;)
+        dropped_packets[id].fetch_add(1, std::memory_order_relaxed);
+        D(std::cout << "[WARNING] File packet queue of Device [" << id << "] is full (" << queue_max_size << " packets). Discarding packet." << std::endl;)
+        return;
     }
 
-    // Add the new packet to the queue
-    packet_queue.push(packet);
+    // Wake up the run method only if it is waiting (the fence orders the push before reading the flag)
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (consumer_waiting.load(std::memory_order_relaxed))
+    {
+        std::lock_guard<std::mutex> lock(wakeup_mutex);
+        wakeup_cv.notify_one();
+    }
 }
 
-bool OutputManager::configure_files(std::vector<bool> readyDevices)
+void OutputManager::set_device_active(int device_id, bool active)
 {
-    if (log.file.enabled)
+    if (!device_active || device_id < 0 || device_id >= num_devices) return;
+    device_active[device_id].store(active, std::memory_order_relaxed);
+    // Wake up the run method, so the packets held waiting for a lost device are released right away
+    std::lock_guard<std::mutex> lock(wakeup_mutex);
+    wakeup_cv.notify_one();
+}
+
+void OutputManager::stop()
+{
+    is_running = false;
+    std::lock_guard<std::mutex> lock(wakeup_mutex);
+    wakeup_cv.notify_one();
+    space_cv.notify_all();
+}
+
+std::vector<merge_stats_s> OutputManager::get_merge_stats()
+{
+    if (!merger) return std::vector<merge_stats_s>();
+    return merger->get_stats();
+}
+
+std::vector<dedup_stats_s> OutputManager::get_dedup_stats()
+{
+    if (!dedup) return std::vector<dedup_stats_s>();
+    return dedup->get_stats();
+}
+
+std::vector<queue_stats_s> OutputManager::get_queue_stats()
+{
+    std::vector<queue_stats_s> stats;
+    for (size_t i = 0; i < device_rings.size(); i++)
     {
-        std::time_t t = std::time(nullptr);
-        std::tm tm = *std::localtime(&t);
-        std::stringstream ss;
-        ss << std::put_time(&tm, "%Y-%m-%d_%H-%M");
+        stats.push_back({(int)i, device_rings[i]->capacity(), device_rings[i]->high_water_mark(), dropped_packets[i].load(std::memory_order_relaxed)});
+    }
+    return stats;
+}
 
-        std::string timestamp = ss.str();
-        std::string base_filename = log.file.path;
-        if (log.file.reset_period != "none")
+int OutputManager::drain_queues()
+{
+    int handled = 0;
+    int released = 0;
+    FrameRef frame;
+    for (auto& ring : device_rings)
+    {
+        for (int i = 0; i < drain_batch_size && ring->pop(frame); i++)
         {
-            base_filename += timestamp + "_";
+            int64_t time = align_clock(frame);
+            if (merger) merger->push(std::move(frame), time);
+            else if (dedup) dedup->push(std::move(frame), time);
+            else handle_packet(frame);
+            handled++;
         }
-        base_filename += log.file.base_name;
-
-        if (log.file.split_devices_log)
+    }
+    // Wake up the devices waiting for room (block policy)
+    if (handled > 0)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (producers_waiting.load(std::memory_order_relaxed) > 0)
         {
-            for (int i = 0; i < num_devices; ++i)
-            {
-                if (!readyDevices[i])
-                {
-                    continue;
-                }
-                std::string filename = base_filename + "_" + std::to_string(i) + ".pcap";
-                FILE* log_file = fopen(filename.c_str(), "wb");
-                if (!log_file)
-                {
-                    D(char* errmsg = custom_strerror(errno);
-                        std::cout << "[ERROR] Could not open log file: " << filename << errmsg << ". Packets will be discarded." << std::endl;
-                        free(errmsg);)
-                    return false;
-                }
-                // Write global header
-                std::vector<uint8_t> global_header = PcapBuilder::get_global_header();
-                fwrite(global_header.data(), 1, global_header.size(), log_file);
-                log_files.push_back(log_file);
-                D(std::cout << "[INFO] Log file created: " << filename << "." << std::endl;);
-            }
+            std::lock_guard<std::mutex> lock(wakeup_mutex);
+            space_cv.notify_all();
         }
+    }
+    if (merger || dedup) released = release_packets(false);
+    // Write what was collected for the log files with one vectored write per file
+    if (handled > 0 || released > 0) flush_log_files();
+    return handled;
+}
+
+int64_t OutputManager::align_clock(const FrameRef& frame, bool sample)
+{
+    CommandAssembler command_assembler;
+    int64_t device_time = command_assembler.get_device_timestamp(frame->packet, frame->length).count();
+    int64_t system_time = std::chrono::duration_cast<std::chrono::microseconds>(frame->timestamp.time_since_epoch()).count();
+    int id = frame->id;
+    if (id < 0 || id >= (int)clocks.size())
+    {
+        frame->clock_offset = system_time - device_time;
+        return system_time;
+    }
+
+    ClockModel& clock = clocks[id];
+    if (sample) clock.add_sample(device_time, system_time);
+    // Without a model the packet is placed at the time it was received
+    frame->clock_offset = clock.empty() ? system_time - device_time : clock.offset_at(device_time);
+    return device_time + frame->clock_offset;
+}
+
+std::vector<clock_stats_s> OutputManager::get_clock_stats()
+{
+    std::vector<clock_stats_s> stats;
+    for (size_t i = 0; i < clocks.size(); i++)
+    {
+        if (clocks[i].empty()) continue;
+        stats.push_back({(int)i, clocks[i].current_offset(), clocks[i].drift_ppm(), clocks[i].sample_count()});
+    }
+    return stats;
+}
+
+int OutputManager::release_packets(bool flush)
+{
+    int released = 0;
+    FrameRef frame;
+    int64_t time;
+    // A device whose connection was lost is not waited for until it is back
+    for (int i = 0; merger && i < num_devices; ++i) merger->set_active(i, device_active[i].load(std::memory_order_relaxed));
+    while (merger && merger->pop(frame, &time, flush))
+    {
+        if (dedup) dedup->push(std::move(frame), time);
         else
         {
-            std::string filename = base_filename + ".pcap";
-            FILE* log_file = fopen(filename.c_str(), "wb");
-            if (!log_file)
+            handle_packet(frame);
+            released++;
+        }
+    }
+    while (dedup && dedup->pop(frame, flush))
+    {
+        handle_packet(frame);
+        released++;
+    }
+    return released;
+}
+
+// Write position of a log file (on Linux the records bypass stdio, so its position is read from the descriptor)
+static int64_t log_file_position(FILE* file)
+{
+    #ifdef __linux__
+        return (int64_t)lseek(fileno(file), 0, SEEK_CUR);
+    #endif
+    #ifdef _WIN32
+        return (int64_t)_ftelli64(file);
+    #endif
+}
+
+void OutputManager::write_to_log_file(size_t index, const FrameRef& frame, std::chrono::microseconds start_time, uint32_t interface_index)
+{
+    while (file_batches.size() < log_set.files.size()) file_batches.emplace_back(new RecordBatch(RECORD_BATCH_MAX_RECORDS, file_format));
+    RecordBatch& batch = *file_batches[index];
+    if (batch.full()) write_log_batch(index);
+    uint64_t offset = log_file_bytes[index] + batch.bytes();
+    if (!batch.add(frame, start_time, interface_index)) return;
+
+    // Index the record every log.file.index_packets packets or log.file.index_interval_ms milliseconds
+    FILE* index_file = index < log_set.index_files.size() ? log_set.index_files[index] : nullptr;
+    if (index_file)
+    {
+        CommandAssembler command_assembler;
+        int64_t device_time = command_assembler.get_device_timestamp(frame->packet, frame->length).count();
+        // The index is in UTC for both formats (the pcap records have TIMEZONE applied)
+        int64_t timestamp = device_time + start_time.count();
+        if (file_format == CaptureFormat::PCAP) timestamp -= (int64_t)TIMEZONE * 1000000;
+        if (++index_packets[index] >= (uint64_t)log.file.index_packets || index_times[index] == INT64_MIN || timestamp - index_times[index] >= (int64_t)log.file.index_interval_ms * 1000)
+        {
+            capture_index_entry_s entry = {};
+            entry.timestamp = timestamp;
+            entry.device_time = (uint64_t)device_time;
+            entry.offset = log_set.data_offsets[index] + offset;
+            entry.device_id = (uint16_t)frame->id;
+            entry.channel = (uint8_t)frame->channel;
+            CaptureIndex::add(index_file, entry);
+            index_packets[index] = 0;
+            index_times[index] = timestamp;
+        }
+    }
+
+    // Start new log files before the next packet when this one reached the size or the number of packets of a file
+    if (log.file.rotate_size_mb > 0 && log_file_bytes[index] + batch.bytes() >= (rotation_failures + 1) * log.file.rotate_size_mb * 1024 * 1024) rotation_due = true;
+    if (log.file.rotate_packets > 0 && log_file_packets[index] + batch.size() >= (rotation_failures + 1) * log.file.rotate_packets) rotation_due = true;
+}
+
+void OutputManager::flush_log_files()
+{
+    for (size_t i = 0; i < file_batches.size() && i < log_set.files.size(); i++) write_log_batch(i);
+}
+
+void OutputManager::write_log_batch(size_t index)
+{
+    RecordBatch& batch = *file_batches[index];
+    FILE* file = log_set.files[index];
+    // A file that could not be opened still counts its records, so its rotation keeps the pace of the others
+    if (!file || batch.write_to(file))
+    {
+        log_file_bytes[index] += batch.bytes();
+        log_file_packets[index] += batch.size();
+    }
+    else
+    {
+        // Part of the batch may have reached the file: the next records are indexed from the actual end of the file
+        int64_t position = log_file_position(file);
+        if (position >= (int64_t)log_set.data_offsets[index]) log_file_bytes[index] = (uint64_t)position - log_set.data_offsets[index];
+    }
+    batch.clear();
+}
+
+FILE* OutputManager::open_log_file(const std::string& path, int device_id)
+{
+    FILE* log_file = fopen(path.c_str(), "wb");
+    if (!log_file)
+    {
+        D(char* errmsg = custom_strerror(errno);
+            std::cout << "[ERROR] Could not open log file: " << path << errmsg << ". Packets will be discarded." << std::endl;
+            free(errmsg);)
+        return nullptr;
+    }
+
+    if (file_format == CaptureFormat::PCAPNG)
+    {
+        // Section header and one interface per device, so the interface index of a packet is its device id
+        std::vector<uint8_t> section_header = PcapBuilder::get_section_header();
+        fwrite(section_header.data(), 1, section_header.size(), log_file);
+        for (int i = 0; i < (int)device_interfaces.size(); i++)
+        {
+            if (device_id != -1 && i != device_id) continue;
+            std::vector<uint8_t> interface_description = PcapBuilder::get_interface_description(InterfaceRegistry::get(device_interfaces[i]));
+            fwrite(interface_description.data(), 1, interface_description.size(), log_file);
+        }
+    }
+    else
+    {
+        // Write global header
+        std::vector<uint8_t> global_header = PcapBuilder::get_global_header();
+        fwrite(global_header.data(), 1, global_header.size(), log_file);
+    }
+    D(std::cout << "[INFO] Log file created: " << path << "." << std::endl;);
+    return log_file;
+}
+
+bool OutputManager::open_log_file_set(uint64_t index, std::chrono::system_clock::time_point when, log_file_set_s& set)
+{
+    // Files that rotate by size or packets are numbered, and named after the start of the capture
+    bool numbered = log.file.rotate_size_mb > 0 || log.file.rotate_packets > 0;
+    std::string base_filename = log.file.path;
+    if (reset_period != ResetPeriod::NONE || numbered)
+    {
+        std::time_t t = std::chrono::system_clock::to_time_t(numbered ? capture_start : when);
+        std::tm tm;
+#ifdef _WIN32
+        localtime_s(&tm, &t);
+#else
+        localtime_r(&t, &tm);
+#endif
+        std::stringstream ss;
+        ss << std::put_time(&tm, "%Y-%m-%d_%H-%M");
+        base_filename += ss.str() + "_";
+    }
+    base_filename += log.file.base_name;
+    if (numbered)
+    {
+        char number[24];
+        snprintf(number, sizeof(number), "_%05llu", (unsigned long long)index);
+        base_filename += number;
+    }
+    std::string extension = file_format == CaptureFormat::PCAPNG ? ".pcapng" : ".pcap";
+
+    set = log_file_set_s();
+    if (log.file.split_devices_log)
+    {
+        for (int i = 0; i < num_devices; ++i)
+        {
+            set.files.push_back(nullptr);
+            set.paths.push_back(base_filename + "_" + std::to_string(i) + extension);
+            // Keep the index of the device, without creating a file it would leave empty
+            if (!file_devices[i]) continue;
+            set.files[i] = open_log_file(set.paths[i], i);
+            if (!set.files[i])
             {
-                D(char* errmsg = custom_strerror(errno);
-                    std::cout << "[ERROR] Could not open log file: " << filename << errmsg << ". Packets will be discarded." << std::endl;
-                    free(errmsg);)
+                LogRotator::close_set(set, true);
                 return false;
             }
-            // Write global header
-            std::vector<uint8_t> global_header = PcapBuilder::get_global_header();
-            fwrite(global_header.data(), 1, global_header.size(), log_file);
-            log_files.push_back(log_file);
-            D(std::cout << "[INFO] Log file created: " << filename << "." << std::endl;);
+            LogRotator::preallocate(set.files[i], (uint64_t)log.file.rotate_size_mb * 1024 * 1024);
+        }
+    }
+    else
+    {
+        set.paths.push_back(base_filename + extension);
+        set.files.push_back(open_log_file(set.paths[0], -1));
+        if (!set.files[0])
+        {
+            set.files.clear();
+            set.paths.clear();
+            return false;
+        }
+        LogRotator::preallocate(set.files[0], (uint64_t)log.file.rotate_size_mb * 1024 * 1024);
+    }
+
+    // The records are indexed from where the header ends (a file that cannot be indexed is still written)
+    for (size_t i = 0; i < set.files.size(); i++)
+    {
+        set.data_offsets.push_back(set.files[i] ? (uint64_t)ftell(set.files[i]) : 0);
+        set.index_paths.push_back(log.file.index && set.files[i] ? set.paths[i] + CAPTURE_INDEX_EXTENSION : "");
+        set.index_files.push_back(set.index_paths[i].empty() ? nullptr : CaptureIndex::create(set.index_paths[i], file_format, set.data_offsets[i]));
+    }
+    return true;
+}
+
+bool OutputManager::configure_files(std::vector<bool> readyDevices)
+{
+    if (log.file.enabled)
+    {
+        file_devices = readyDevices;
+        capture_start = std::chrono::system_clock::now();
+        rotation_index = 1;
+        log_file_set_s set;
+        if (!open_log_file_set(rotation_index, capture_start, set)) return false;
+        log_set = set;
+        log_file_bytes.assign(log_set.files.size(), 0);
+        log_file_packets.assign(log_set.files.size(), 0);
+        index_packets.assign(log_set.files.size(), 0);
+        index_times.assign(log_set.files.size(), INT64_MIN);
+
+        bool numbered = log.file.rotate_size_mb > 0 || log.file.rotate_packets > 0;
+        if (reset_period != ResetPeriod::NONE || numbered)
+        {
+            // The period is parsed once: each packet is only compared with the time of the next rotation
+            if (reset_period != ResetPeriod::NONE) next_rotation = capture_start + reset_period_length(reset_period);
+            log_rotator.reset(new LogRotator([this](uint64_t index, std::chrono::system_clock::time_point when, log_file_set_s& set) { return open_log_file_set(index, when, set); }, log.file.max_files));
+            // A rotation by size or packets can happen at any time, so its files are opened right away
+            log_rotator->prepare(rotation_index + 1, numbered ? capture_start : next_rotation);
         }
-    last_update = std::chrono::system_clock::now();
     }
 
     return true;
@@ -119,6 +449,22 @@ bool OutputManager::configure_pipes(std::vector<bool> readyDevices)
     D(std::cout << "[INFO] Initializing Pipe threads." << std::endl;)
     if(log.pipe.enabled)
     {
+        size_t pipe_max_size = pipe_queue_max_size;
+        QueuePolicy pipe_policy = QueuePolicy::DROP_OLDEST;
+        // The pipes are fed by the output thread, so waiting for a pipe without consumer would stall every output
+        if (!parse_queue_policy(log.pipe.queue_policy, pipe_policy) || pipe_policy == QueuePolicy::BLOCK)
+        {
+            std::cout << "[WARNING] Queue policy " << log.pipe.queue_policy << " is not supported by the pipes. Using drop-oldest." << std::endl;
+            pipe_policy = QueuePolicy::DROP_OLDEST;
+        }
+        // Spill files are kept next to the pipes (the Windows pipe namespace cannot hold files)
+        #ifdef _WIN32
+            std::string spill_path = log.file.path;
+        #else
+            std::string spill_path = log.pipe.path;
+        #endif
+        uint64_t spill_size = (uint64_t)std::max(log.pipe.spill_size_mb, 1) * 1024 * 1024;
+
         if(log.pipe.split_devices_log)
         {
             for (int i = 0; i < num_devices; ++i)
@@ -129,7 +475,7 @@ bool OutputManager::configure_pipes(std::vector<bool> readyDevices)
                 }
                 std::string pipe_path = log.pipe.path;
                 std::string pipe_base_name =  log.file.base_name + "_" + std::to_string(i);
-                std::shared_ptr<PipePacketHandler> pipe_packet_handler = std::make_shared<PipePacketHandler>(pipe_path, pipe_base_name, start_time);
+                std::shared_ptr<PipePacketHandler> pipe_packet_handler = std::make_shared<PipePacketHandler>(pipe_path, pipe_base_name, num_devices, pipe_max_size, pipe_policy, spill_path + pipe_base_name + ".spill", spill_size, log.pipe.spill_recover, &frame_pool);
                 log_pipes_handlers.push_back(pipe_packet_handler);
                 std::thread pipe_thread(&PipePacketHandler::run, pipe_packet_handler);
                 log_pipes_threads.push_back(std::move(pipe_thread));
@@ -138,7 +484,7 @@ bool OutputManager::configure_pipes(std::vector<bool> readyDevices)
         else
         {
             std::string pipe_path = log.pipe.path;
-            std::shared_ptr<PipePacketHandler> pipe_packet_handler = std::make_shared<PipePacketHandler>(pipe_path, log.file.base_name, start_time);
+            std::shared_ptr<PipePacketHandler> pipe_packet_handler = std::make_shared<PipePacketHandler>(pipe_path, log.file.base_name, num_devices, pipe_max_size, pipe_policy, spill_path + log.file.base_name + ".spill", spill_size, log.pipe.spill_recover, &frame_pool);
             log_pipes_handlers.push_back(pipe_packet_handler);
             std::thread pipe_thread(&PipePacketHandler::run, pipe_packet_handler);
             log_pipes_threads.push_back(std::move(pipe_thread));
@@ -148,9 +494,63 @@ bool OutputManager::configure_pipes(std::vector<bool> readyDevices)
     return true;
 }
 
-bool OutputManager::configure(int num_devices, std::vector<bool> readyDevices)
+bool OutputManager::configure(int num_devices, std::vector<bool> readyDevices, std::vector<uint16_t> interfaces)
 {
     this->num_devices = num_devices;
+    device_interfaces = interfaces;
+    clocks.assign(num_devices, ClockModel());
+
+    // Merge the devices in capture order when they share a log file or pipe
+    bool shared_output = (log.file.enabled && !log.file.split_devices_log) || (log.pipe.enabled && !log.pipe.split_devices_log) || log.socket.enabled || log.tcp.enabled || log.shm.enabled;
+    // The devices update their state from their own threads, the merge reads it before releasing packets
+    device_active.reset(new std::atomic<bool>[num_devices]);
+    for (int i = 0; i < num_devices; ++i) device_active[i] = readyDevices[i];
+    merger.reset();
+    if (num_devices > 1 && shared_output && log.merge_window > 0)
+    {
+        merger.reset(new PacketMerger(num_devices, std::chrono::milliseconds(log.merge_window)));
+        for (int i = 0; i < num_devices; ++i) merger->set_active(i, readyDevices[i]);
+        D(std::cout << "[INFO] Merging devices in capture order (window of " << std::dec << log.merge_window << " ms)." << std::endl;)
+    }
+
+    // Discard the copies of a frame captured by more than one device
+    dedup.reset();
+    if (num_devices > 1 && shared_output && log.dedup_window > 0)
+    {
+        dedup.reset(new DuplicateFilter(num_devices, log.dedup_window));
+        D(std::cout << "[INFO] Discarding duplicated packets between devices (window of " << std::dec << log.dedup_window << " us)." << std::endl;)
+    }
+
+    // Size the frame pool from the budgets of every queue that holds frames, so an output that is behind can not take the frames of the others
+    size_t num_pipes = log.pipe.enabled ? (log.pipe.split_devices_log ? (size_t)num_devices : 1) : 0;
+    pipe_queue_max_size = queue_budget_packets(log.pipe.queue_size_kb);
+    // Frames held by the merge and dedup windows, the record batches being written and the key packets
+    size_t held_frames = FRAME_POOL_SLAB_SIZE;
+    if (merger) held_frames += (size_t)num_devices * MERGE_MAX_PENDING;
+    if (dedup) held_frames += DEDUP_MAX_PENDING;
+    size_t budget_frames = (size_t)num_devices * queue_max_size + num_pipes * pipe_queue_max_size;
+    if (held_frames + budget_frames > FRAME_POOL_MAX_FRAMES)
+    {
+        // The budgets do not fit in the largest pool: the log file queues keep theirs if it fits in half the pool, and the pipes share the rest
+        size_t available = FRAME_POOL_MAX_FRAMES - held_frames;
+        size_t device_share = num_pipes > 0 ? available / 2 : available;
+        if ((size_t)num_devices * queue_max_size > device_share) queue_max_size = std::max(device_share / num_devices, (size_t)1);
+        if (num_pipes > 0) pipe_queue_max_size = std::min(pipe_queue_max_size, std::max((available - (size_t)num_devices * queue_max_size) / num_pipes, (size_t)1));
+        std::cout << "[WARNING] Queue budgets exceed the frame pool (" << std::dec << FRAME_POOL_MAX_FRAMES << " frames). Using " << queue_max_size << " packets for each log file queue";
+        if (num_pipes > 0) std::cout << " and " << pipe_queue_max_size << " packets for each pipe queue";
+        std::cout << "." << std::endl;
+    }
+    size_t pool_frames = frame_pool.set_max_frames(held_frames + (size_t)num_devices * queue_max_size + num_pipes * pipe_queue_max_size);
+    D(std::cout << "[INFO] Frame pool sized for " << std::dec << pool_frames << " frames." << std::endl;)
+
+    // Create one queue per device
+    device_rings.clear();
+    for (int i = 0; i < num_devices; ++i)
+    {
+        device_rings.emplace_back(new SpscRing<FrameRef>(queue_max_size));
+    }
+    dropped_packets.reset(new std::atomic<uint64_t>[num_devices]);
+    for (int i = 0; i < num_devices; ++i) dropped_packets[i] = 0;
 
     if(log.file.enabled)
         if(!configure_files(readyDevices)) return false;
@@ -158,6 +558,23 @@ bool OutputManager::configure(int num_devices, std::vector<bool> readyDevices)
     if(log.pipe.enabled)
         if(!configure_pipes(readyDevices)) return false;
 
+    // Serve the stream to the socket clients (the capture goes on without a server if its socket cannot be created)
+    stream_servers.clear();
+    if(log.socket.enabled) stream_servers.emplace_back(new StreamServer(StreamTransport::UNIX, log.socket));
+    if(log.tcp.enabled) stream_servers.emplace_back(new StreamServer(StreamTransport::TCP, log.tcp));
+    stream_servers.erase(std::remove_if(stream_servers.begin(), stream_servers.end(), [](const std::unique_ptr<StreamServer>& server) { return !server->start(); }), stream_servers.end());
+    for (auto& server : stream_servers)
+    {
+        stream_threads.emplace_back(&StreamServer::run, server.get());
+    }
+
+    // Publish the packets to the shared memory ring
+    if(log.shm.enabled)
+    {
+        shm_writer.reset(new ShmRingWriter(log.shm.name, (uint32_t)((size_t)log.shm.buffer_size_kb * 1024 / sizeof(shm_ring_slot_s))));
+        if (!shm_writer->open()) shm_writer.reset();
+    }
+
     can_run = true;
     return true;
 }
@@ -169,37 +586,102 @@ void OutputManager::run()
     if(log.crypto.simulation)
     {
         loadAndSimulateKeyPackets();
+        flush_log_files();
+    }
+
+    while (can_run)
+    {
+        // Keep draining without sleeping while any queue has packets
+        if (drain_queues() > 0) continue;
+        // Queues are empty: stop if the devices finished streaming (they were joined before is_running was cleared)
+        if (!is_running) break;
+        // Announce the wait and check the queues again, so a packet pushed in between is not missed
+        std::unique_lock<std::mutex> lock(wakeup_mutex);
+        consumer_waiting.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool pending = false;
+        for (auto& ring : device_rings) pending = pending || !ring->empty();
+        // Sleep until a producer adds a packet or a held packet must be released (the timeout is only a safety net)
+        auto wakeup_time = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+        if (merger && merger->next_release() < wakeup_time) wakeup_time = merger->next_release();
+        if (dedup && dedup->next_release() < wakeup_time) wakeup_time = dedup->next_release();
+        if (!pending && is_running) wakeup_cv.wait_until(lock, wakeup_time);
+        consumer_waiting.store(false);
+        lock.unlock();
+        // Release the packets whose window ended
+        if ((merger || dedup) && release_packets(false) > 0) flush_log_files();
+    }
+
+    // Write the packets still held by the merge and the duplicate filter
+    if ((merger || dedup) && release_packets(true) > 0) flush_log_files();
+
+    // Report the duplicate filter statistics
+    D({
+        for (const auto& stats : get_dedup_stats())
+        {
+            std::cout << "[INFO] Device [" << std::dec << stats.device_id << "] had " << stats.suppressed << " duplicated packets discarded for a copy with a better RSSI." << std::endl;
+        }
+    })
+
+    // Report the clock model of each device
+    D({
+        for (const auto& stats : get_clock_stats())
+        {
+            std::cout << "[INFO] Device [" << std::dec << stats.device_id << "] clock offset: " << stats.offset << " us, drift: " << std::fixed << std::setprecision(3) << stats.drift_ppm << " ppm (" << stats.samples << " samples)." << std::defaultfloat << std::endl;
+        }
+    })
+
+    // Report the merge statistics
+    for (const auto& stats : get_merge_stats())
+    {
+        if (stats.late > 0)
+        {
+            std::cout << "[WARNING] Device [" << std::dec << stats.device_id << "] had " << stats.late << " packets written out of capture order (arrived after the merge window of " << log.merge_window << " ms)." << std::endl;
+        }
+        else
+        {
+            D(std::cout << "[INFO] Device [" << std::dec << stats.device_id << "] merge high-water mark: " << stats.high_water_mark << " packets." << std::endl;)
+        }
     }
 
-    while ((is_running || !packet_queue.empty()) && can_run)
+    // Report the queues statistics
+    for (const auto& stats : get_queue_stats())
     {
-        if(!packet_queue.empty())
+        if (stats.dropped > 0)
+        {
+            std::cout << "[WARNING] Device [" << stats.device_id << "] queue dropped " << stats.dropped << " packets (high-water mark " << stats.high_water_mark << " of " << stats.capacity << ")." << std::endl;
+        }
+        else
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            packet_queue_s packet = packet_queue.front();
-            packet_queue.pop();
-            // D(std::cout << "[INFO] Packet processed by Output Manager. Size: " << packet.packet.size()  << "." << std::endl;)
-            handle_packet(packet);
+            D(std::cout << "[INFO] Device [" << stats.device_id << "] queue high-water mark: " << stats.high_water_mark << " of " << stats.capacity << "." << std::endl;)
         }
-        // Sleep to avoid busy waiting
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
 
-    // Close log files
-    for (auto log_file : log_files)
+    // Report the frame pool statistics
+    frame_pool_stats_s pool_stats = frame_pool.get_stats();
+    if (pool_stats.exhausted > 0)
+    {
+        std::cout << "[WARNING] Frame pool was exhausted: " << std::dec << pool_stats.exhausted << " packets were dropped (high-water mark " << pool_stats.high_water_mark << " of " << pool_stats.max_capacity << ")." << std::endl;
+    }
+    else
     {
-        fclose(log_file);
+        D(std::cout << "[INFO] Frame pool high-water mark: " << pool_stats.high_water_mark << " of " << pool_stats.capacity << " allocated frames (maximum " << pool_stats.max_capacity << ")." << std::endl;)
     }
 
+    // Close log files (after the files of the previous rotations were closed in the background)
+    flush_log_files();
+    log_rotator.reset();
+    LogRotator::close_set(log_set);
+
     if(log.crypto.save_packets)
     {
         saveKeyPackets();
     }
 
-    // The PipePacketHandler to is_running = false
+    // Stop the PipePacketHandlers
     for (auto pipe_packet_handler : log_pipes_handlers)
     {
-        pipe_packet_handler->is_running = false;
+        pipe_packet_handler->stop();
     }
     // Join the threads from the pipes
     for (auto& pipe_thread : log_pipes_threads)
@@ -207,6 +689,44 @@ void OutputManager::run()
         pipe_thread.join();
     }
 
+    // Remove the shared memory ring
+    if (shm_writer)
+    {
+        D(std::cout << "[INFO] Published " << std::dec << shm_writer->published() << " packets to the shared memory ring." << std::endl;)
+        shm_writer.reset();
+    }
+
+    // Stop the stream servers
+    for (size_t i = 0; i < stream_servers.size(); i++)
+    {
+        stream_servers[i]->stop();
+        stream_threads[i].join();
+        stream_stats_s stream_stats = stream_servers[i]->get_stats();
+        D(std::cout << "[INFO] Stream server had " << std::dec << stream_stats.clients << " clients." << std::endl;)
+        if (stream_stats.dropped_clients > 0 || stream_stats.skipped_bytes > 0)
+        {
+            std::cout << "[WARNING] Stream server disconnected " << std::dec << stream_stats.dropped_clients << " slow clients and skipped " << stream_stats.skipped_bytes << " bytes of packets." << std::endl;
+        }
+    }
+    stream_threads.clear();
+    stream_servers.clear();
+
+    // Report the packets that did not fit in the pipe queues
+    for (auto pipe_packet_handler : log_pipes_handlers)
+    {
+        for (const auto& stats : pipe_packet_handler->get_queue_stats())
+        {
+            if (stats.dropped > 0)
+            {
+                std::cout << "[WARNING] Device [" << std::dec << stats.device_id << "] pipe queue dropped " << stats.dropped << " packets." << std::endl;
+            }
+            if (stats.spilled > 0)
+            {
+                D(std::cout << "[INFO] Device [" << std::dec << stats.device_id << "] pipe queue spilled " << stats.spilled << " packets to disk." << std::endl;)
+            }
+        }
+    }
+
     if(log.crypto.save_keys)
     {
         std::string filename = log.crypto.keys_path + ".txt";
@@ -241,56 +761,30 @@ void OutputManager::run()
     D(std::cout << "[INFO] Output Manager stopped. Queues empty." << std::endl;)
 }
 
-void OutputManager::handle_packet(packet_queue_s packet, bool isTransportKey)
-{   
-    // Check if it is the first packet
-    // If so, defines the start-time to system time - first packet timestamp
-    // This base will be summed to the timestamp of each packet to get the correct timestamp
+void OutputManager::handle_packet(const FrameRef& frame, bool isTransportKey)
+{
+    const packet_queue_s& packet = *frame;
     CommandAssembler command_assembler;
-    if(is_first_packet)
-    {        
-        auto now = std::chrono::system_clock::now();
-        start_time = now - command_assembler.get_device_timestamp(packet.packet) + std::chrono::seconds(TIMEZONE);
-        is_first_packet = false;
-        // Update the time on the PipePacketHandler
-        for (auto pipe_packet_handler : log_pipes_handlers)
-        {
-            pipe_packet_handler->start_time = start_time;
-        }
-    }
 
-    // Recreate log files if necessary (based on reset period)
-    recreate_log_files();
+    // Recreate the log files when the current ones are full or the packet was received after the next rotation
+    if (rotation_due || packet.timestamp >= next_rotation) recreate_log_files(packet.timestamp);
 
-    std::vector<uint8_t> payload = command_assembler.get_payload(packet);
-    if (crypto_handler.extract_key(payload))
+    command_assembler.get_payload(packet, payload_buffer);
+    if (crypto_handler.extract_key(payload_buffer))
     {
-        key_packets.push_back(packet);
+        key_packets.push_back(frame);
         isTransportKey = true;
     }
     if(log.file.enabled)
     {
         // Check if i have more than one log file
-        if(log.file.split_devices_log)
-        {
-            // If so, write to the correct file
-            FILE* log_file = log_files[packet.id];
-            auto start_time_micros = std::chrono::duration_cast<std::chrono::microseconds>(start_time.time_since_epoch());
-            std::vector<uint8_t> packet_header = PcapBuilder::get_packet_header(packet, start_time_micros);
-            fwrite(packet_header.data(), 1, packet_header.size(), log_file);
-            std::vector<uint8_t> packet_data = PcapBuilder::get_packet_data(packet);
-            fwrite(packet_data.data(), 1, packet_data.size(), log_file);
-        }
-        // If not, write to the only file
-        if(!log.file.split_devices_log)
-        {
-            FILE* log_file = log_files[0];
-            auto start_time_micros = std::chrono::duration_cast<std::chrono::microseconds>(start_time.time_since_epoch());
-            std::vector<uint8_t> packet_header = PcapBuilder::get_packet_header(packet, start_time_micros);
-            fwrite(packet_header.data(), 1, packet_header.size(), log_file);
-            std::vector<uint8_t> packet_data = PcapBuilder::get_packet_data(packet);
-            fwrite(packet_data.data(), 1, packet_data.size(), log_file);
-        }
+        // If so, write to the correct file. If not, write to the only file
+        // pcapng has no time zone field, so its timestamps are kept in UTC
+        auto start_time_micros = std::chrono::microseconds(packet.clock_offset);
+        if (file_format == CaptureFormat::PCAP) start_time_micros += std::chrono::seconds(TIMEZONE);
+        // A shared pcapng file has one interface per device, in device id order
+        uint32_t interface_index = log.file.split_devices_log ? 0 : packet.id;
+        write_to_log_file(log.file.split_devices_log ? packet.id : 0, frame, start_time_micros, interface_index);
     }
 
     if(log.pipe.enabled)
@@ -298,98 +792,60 @@ void OutputManager::handle_packet(packet_queue_s packet, bool isTransportKey)
         if(log.pipe.split_devices_log)
         {
             PipePacketHandler* pipe_packet_handler = log_pipes_handlers[packet.id].get();
-            pipe_packet_handler->add_packet(packet, isTransportKey);
+            pipe_packet_handler->add_packet(frame, isTransportKey);
         }
         else
         {
             PipePacketHandler* pipe_packet_handler = log_pipes_handlers[0].get();
-            pipe_packet_handler->add_packet(packet, isTransportKey);
+            pipe_packet_handler->add_packet(frame, isTransportKey);
         }
     }
-}
-
-void OutputManager::recreate_log_files()
-{
-    // Check if the reset period is none
-    if (log.file.reset_period == "none" || !log.file.enabled) return;
-
-    // Calculate the time difference since the last update
-    auto now = std::chrono::system_clock::now();
-    auto diff = now - last_update;
-    
-    bool recreate = false;
-    if (log.file.reset_period == "hourly" && diff > std::chrono::hours(1)) recreate = true;
-    if (log.file.reset_period == "daily" && diff > std::chrono::hours(24)) recreate = true;
-    if (log.file.reset_period == "weekly" && diff > std::chrono::hours(24 * 7)) recreate = true;
-    if (log.file.reset_period == "monthly" && diff > std::chrono::hours(24 * 30)) recreate = true;
-
-    // If the time has not come yet, return
-    if (!recreate) return;
-
-    // TODO: Empty the packet queue here before recreating the log files
-    D(std::cout << "[INFO] Recreating log files..." << std::endl;)
-
 
-    // Update the last update time
-    last_update = now;
+    for (auto& server : stream_servers)
+    {
+        server->add_packet(frame, isTransportKey);
+    }
 
-    // Generate the timestamp
-    std::time_t t = std::time(nullptr);
-    std::tm tm = *std::localtime(&t);
-    std::stringstream ss;
-    ss << std::put_time(&tm, "%Y-%m-%d_%H-%M");
-    std::string timestamp = ss.str();
+    // The ring keeps the capture time in UTC, like pcapng
+    if (shm_writer) shm_writer->publish(packet, std::chrono::microseconds(packet.clock_offset));
+}
 
-    // Construct the base filename
-    std::string base_filename = log.file.path;
-    if (log.file.reset_period != "none") base_filename += timestamp;
-    base_filename += "_" + log.file.base_name;
+void OutputManager::recreate_log_files(std::chrono::system_clock::time_point receive_time)
+{
+    rotation_due = false;
+    if (!log_rotator) return;
 
-    // Close old log files
-    for (auto log_file : log_files) {
-        fclose(log_file);
+    // Use the files opened ahead of time, or open them now if they are not ready (a failed rotation keeps its number)
+    log_file_set_s next_set;
+    if (!log_rotator->take(rotation_index + 1, next_set) && !open_log_file_set(rotation_index + 1, next_rotation, next_set))
+    {
+        // The current files keep their counters (the index offsets stay valid) and the next attempt waits for another file size
+        std::cout << "[ERROR] Could not recreate the log files. Packets will be written to the current files." << std::endl;
+        rotation_failures++;
     }
-    log_files.clear();
-
-    // Recreate log files
-    if (log.file.split_devices_log)
+    else
     {
-        for (int i = 0; i < num_devices; ++i) {
-            std::string filename = base_filename + "_" + std::to_string(i) + ".pcap";
-            FILE* new_log_file = fopen(filename.c_str(), "wb");
-            if (!new_log_file) {
-                D(char* errmsg = custom_strerror(errno);
-                    std::cout << "[ERROR] Could not open log file: " << filename << errmsg << "." << std::endl;
-                    free(errmsg);)
-                return;
-            }
-            // Write global header
-            std::vector<uint8_t> global_header = PcapBuilder::get_global_header();
-            fwrite(global_header.data(), 1, global_header.size(), new_log_file);
-
-
-            log_files.push_back(new_log_file);
-            D(std::cout << "[INFO] Log file recreated: " << filename << "." << std::endl;)
-        }
-
-        return;
+        D(std::cout << "[INFO] Recreating log files..." << std::endl;)
+        rotation_index++;
+        rotation_failures = 0;
+        // The records of the current files are written before the files are closed in the background
+        flush_log_files();
+        log_rotator->retire(log_set);
+        log_set = next_set;
+        log_file_bytes.assign(log_set.files.size(), 0);
+        log_file_packets.assign(log_set.files.size(), 0);
+        index_packets.assign(log_set.files.size(), 0);
+        index_times.assign(log_set.files.size(), INT64_MIN);
     }
 
-    std::string filename = base_filename + ".pcap";
-    FILE* new_log_file = fopen(filename.c_str(), "wb");
-    if (!new_log_file) {
-        D(char* errmsg = custom_strerror(errno);
-            std::cout << "[ERROR] Could not open log file: " << filename << errmsg << "." << std::endl;
-            free(errmsg);)
-        return;
+    // Skip the rotations that were missed (no packets during a whole period)
+    if (reset_period != ResetPeriod::NONE)
+    {
+        auto length = reset_period_length(reset_period);
+        while (next_rotation <= receive_time) next_rotation += length;
     }
-    // Write global header
-    std::vector<uint8_t> global_header = PcapBuilder::get_global_header();
-    fwrite(global_header.data(), 1, global_header.size(), new_log_file);
-
-    log_files.push_back(new_log_file);
-    D(std::cout << "[INFO] Log file recreated: " << filename << "." << std::endl;)
-
+    bool numbered = log.file.rotate_size_mb > 0 || log.file.rotate_packets > 0;
+    log_rotator->prepare(rotation_index + 1, numbered ? receive_time : next_rotation);
 }
 
 void OutputManager::saveKeyPackets() {
@@ -405,18 +861,20 @@ void OutputManager::saveKeyPackets() {
         return;
     }
 
-    for (const auto& p : key_packets) {
+    for (const auto& key_packet : key_packets) {
+        const packet_queue_s& p = *key_packet;
         // Serializar os dados
         //outFile.write(reinterpret_cast<const char*>(&p.id), sizeof(p.id));
-        int interfaceSize = p.serial_interface.size();
+        const std::string& serial_interface = InterfaceRegistry::get(p.interface_id).name;
+        int interfaceSize = serial_interface.size();
         outFile.write(reinterpret_cast<const char*>(&interfaceSize), sizeof(interfaceSize));
-        outFile.write(p.serial_interface.data(), interfaceSize);
+        outFile.write(serial_interface.data(), interfaceSize);
         outFile.write(reinterpret_cast<const char*>(&p.channel), sizeof(p.channel));
         outFile.write(reinterpret_cast<const char*>(&p.mode), sizeof(p.mode));
 
-        int packetSize = p.packet.size();
+        int packetSize = p.length;
         outFile.write(reinterpret_cast<const char*>(&packetSize), sizeof(packetSize));
-        outFile.write(reinterpret_cast<const char*>(p.packet.data()), packetSize);
+        outFile.write(reinterpret_cast<const char*>(p.packet), packetSize);
         //auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(
         //    p.timestamp.time_since_epoch()).count();
         //outFile.write(reinterpret_cast<const char*>(&timestamp), sizeof(timestamp));
@@ -443,28 +901,42 @@ void OutputManager::loadAndSimulateKeyPackets() {
         while (inFile.peek() != EOF) 
         {
             packet_queue_s p;
+            p.id = 0;
 
             // Desserializar os dados
             //inFile.read(reinterpret_cast<char*>(&p.id), sizeof(p.id));
             int interfaceSize;
             inFile.read(reinterpret_cast<char*>(&interfaceSize), sizeof(interfaceSize));
-            p.serial_interface.resize(interfaceSize);
-            inFile.read(&p.serial_interface[0], interfaceSize);
+            std::string serial_interface(interfaceSize, '\0');
+            inFile.read(&serial_interface[0], interfaceSize);
             inFile.read(reinterpret_cast<char*>(&p.channel), sizeof(p.channel));
             inFile.read(reinterpret_cast<char*>(&p.mode), sizeof(p.mode));
+            bool valid_interface = InterfaceRegistry::intern(serial_interface, p.mode, p.channel, p.interface_id);
 
             int packetSize;
             inFile.read(reinterpret_cast<char*>(&packetSize), sizeof(packetSize));
-            p.packet.resize(packetSize);
-            inFile.read(reinterpret_cast<char*>(p.packet.data()), packetSize);
+            if (!inFile || packetSize < 0 || packetSize > FRAME_MAX_SIZE)
+            {
+                D(std::cout << "[ERROR] Invalid packet in: " << log.crypto.simulation_path << ". Stopping simulation." << std::endl;)
+                break;
+            }
+            p.length = static_cast<uint16_t>(packetSize);
+            inFile.read(reinterpret_cast<char*>(p.packet), packetSize);
+            // Packets from an interface that can not be registered are skipped
+            if (!valid_interface) continue;
 
             //long long timestampSeconds;
             //inFile.read(reinterpret_cast<char*>(&timestampSeconds), sizeof(timestampSeconds));
             p.timestamp = std::chrono::system_clock::now();
-            std::lock_guard<std::mutex> lock(m_mutex);
             for (int i = 0; i < log_pipes_handlers.size(); i++){
-                p.id = i;
-                handle_packet(p, true);
+                // Each pipe gets its own frame, since the id differs
+                FrameRef frame = frame_pool.acquire();
+                if (!frame) continue;
+                *frame = p;
+                frame->id = i;
+                // The packets come from another capture, so they are placed at the time they are simulated
+                align_clock(frame, false);
+                handle_packet(frame, true);
             }
             
         }
@@ -0,0 +1,104 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+
+#include <limits>
+
+#include "packet_merger.hpp"
+
+PacketMerger::PacketMerger(int num_devices, std::chrono::milliseconds window, size_t max_pending)
+: window(window), max_pending(max_pending), last_time(std::numeric_limits<int64_t>::min()),
+  queues(num_devices), active(num_devices, true), high_water_marks(num_devices, 0), late(num_devices, 0)
+{
+}
+
+void PacketMerger::set_active(int device_id, bool active)
+{
+    if (device_id < 0 || device_id >= (int)queues.size()) return;
+    this->active[device_id] = active;
+}
+
+void PacketMerger::push(FrameRef frame, int64_t time)
+{
+    int id = frame->id;
+    if (id < 0 || id >= (int)queues.size()) return;
+    merge_entry_s entry;
+    entry.frame = std::move(frame);
+    entry.time = time;
+    entry.arrival = std::chrono::steady_clock::now();
+    queues[id].push(std::move(entry));
+    held++;
+    if (queues[id].size() > high_water_marks[id]) high_water_marks[id] = queues[id].size();
+}
+
+int PacketMerger::oldest_device()
+{
+    int oldest = -1;
+    for (int i = 0; i < (int)queues.size(); i++)
+    {
+        if (queues[i].empty()) continue;
+        if (oldest == -1 || queues[i].front().time < queues[oldest].front().time) oldest = i;
+    }
+    return oldest;
+}
+
+bool PacketMerger::pop(FrameRef& frame, int64_t* time, bool flush)
+{
+    int oldest = oldest_device();
+    if (oldest == -1) return false;
+
+    bool ready = flush;
+    // Nothing older can arrive when every active device has a packet held (each device delivers in capture order)
+    if (!ready)
+    {
+        ready = true;
+        for (size_t i = 0; i < queues.size() && ready; i++)
+        {
+            if (active[i] && queues[i].empty()) ready = false;
+        }
+    }
+    // A device holding too many packets releases the oldest ones, so memory stays bounded
+    for (size_t i = 0; i < queues.size() && !ready; i++)
+    {
+        if (queues[i].size() >= max_pending) ready = true;
+    }
+    // Otherwise the packet waits for the other devices at most for the window
+    merge_entry_s& entry = queues[oldest].front();
+    if (!ready && entry.arrival + window <= std::chrono::steady_clock::now()) ready = true;
+    if (!ready) return false;
+
+    if (entry.time < last_time) late[oldest]++;
+    else last_time = entry.time;
+    if (time) *time = entry.time;
+    frame = std::move(entry.frame);
+    queues[oldest].pop();
+    held--;
+    return true;
+}
+
+std::chrono::steady_clock::time_point PacketMerger::next_release()
+{
+    int oldest = oldest_device();
+    if (oldest == -1) return std::chrono::steady_clock::time_point::max();
+    return queues[oldest].front().arrival + window;
+}
+
+std::vector<merge_stats_s> PacketMerger::get_stats() const
+{
+    std::vector<merge_stats_s> stats;
+    for (size_t i = 0; i < queues.size(); i++)
+    {
+        stats.push_back({(int)i, high_water_marks[i], late[i]});
+    }
+    return stats;
+}
@@ -52,7 +52,7 @@ bool PayloadHandler::parseAddressingInfo(uint8_t highByte, uint8_t lowByte, size
     return true;
 }
 
-bool PayloadHandler::getNwkLayer(std::vector<uint8_t> payload, std::vector<uint8_t>& nwkLayer){
+bool PayloadHandler::getNwkLayer(const std::vector<uint8_t>& payload, std::vector<uint8_t>& nwkLayer){
     size_t offset = 0;
     if (payload.size() < 9)
     {
@@ -12,11 +12,103 @@
 
 #include <iostream>
 #include <algorithm>
+#include <cstring>
+#include <cstdio>
 
 #include "pcap_builder.hpp"
 #include "command_assembler.hpp"
+#include "interface_registry.hpp"
 #include "common.hpp"
 
+// pcapng block types
+#define PCAPNG_SECTION_HEADER_BLOCK 0x0A0D0D0A
+#define PCAPNG_INTERFACE_DESCRIPTION_BLOCK 0x00000001
+#define PCAPNG_ENHANCED_PACKET_BLOCK 0x00000006
+// pcapng option codes
+#define PCAPNG_OPT_ENDOFOPT 0
+#define PCAPNG_OPT_COMMENT 1
+#define PCAPNG_SHB_USERAPPL 4
+#define PCAPNG_IF_NAME 2
+#define PCAPNG_IF_DESCRIPTION 3
+#define PCAPNG_IF_TSRESOL 9
+#define PCAPNG_EPB_FLAGS 2
+// epb_flags bits: inbound packet and CRC error
+#define PCAPNG_EPB_FLAG_INBOUND 0x00000001
+#define PCAPNG_EPB_FLAG_CRC_ERROR 0x01000000
+/**
+ * @brief Writes the encapsulation of a packet (IPv4, UDP, TI header and TI Radio Packet Info) into a buffer.
+ * 
+ * @param packet The packet information.
+ * @param frame The fields of its data frame.
+ * @param out Buffer where the PCAP_ENCAPSULATION_SIZE bytes are written.
+ */
+static void write_encapsulation(const packet_queue_s& packet, const ti_frame_s& frame, uint8_t* out)
+{
+    size_t total_length = PCAP_ENCAPSULATION_SIZE + frame.payload_size;
+
+    // IPv4 header with the total length
+    std::memcpy(out, ipv4_header.data(), ipv4_header.size());
+    out[2] = total_length >> 8;
+    out[3] = total_length & 0xFF;
+    out += ipv4_header.size();
+
+    // UDP header with the UDP length
+    std::memcpy(out, udp_header.data(), udp_header.size());
+    out[4] = (total_length - 20) >> 8;
+    out[5] = (total_length - 20) & 0xFF;
+    out += udp_header.size();
+
+    std::memcpy(out, ti_header.data(), ti_header.size());
+    out += ti_header.size();
+
+    // Interface, protocol, phy, frequency and channel were encoded when the interface was registered
+    std::memcpy(out, InterfaceRegistry::get(packet.interface_id).ti_rpi_prefix, TI_RPI_PREFIX_SIZE);
+    out += TI_RPI_PREFIX_SIZE;
+
+    // RSSI and FCS (status byte)
+    *out++ = frame.rssi;
+    *out++ = frame.status;
+}
+
+/**
+ * @brief Writes a 32 bits value in the host byte order (pcapng readers detect it from the Section Header Block).
+ */
+static uint8_t* put_u32(uint8_t* out, uint32_t value)
+{
+    std::memcpy(out, &value, sizeof(value));
+    return out + sizeof(value);
+}
+
+/**
+ * @brief Writes a pcapng option (code, length, value and padding to 32 bits).
+ * 
+ * @return uint8_t* Position after the option.
+ */
+static uint8_t* put_option(uint8_t* out, uint16_t code, const void* value, uint16_t length)
+{
+    std::memcpy(out, &code, sizeof(code));
+    std::memcpy(out + 2, &length, sizeof(length));
+    out += 4;
+    if (length > 0) std::memcpy(out, value, length);
+    size_t padded = (length + 3) & ~3u;
+    std::memset(out + length, 0, padded - length);
+    return out + padded;
+}
+
+/**
+ * @brief Builds a pcapng block from its body, adding the block type and the block length before and after it.
+ */
+static std::vector<uint8_t> make_block(uint32_t block_type, const uint8_t* body, size_t body_size)
+{
+    uint32_t total_length = static_cast<uint32_t>(12 + body_size);
+    std::vector<uint8_t> block(total_length);
+    uint8_t* out = put_u32(block.data(), block_type);
+    out = put_u32(out, total_length);
+    std::memcpy(out, body, body_size);
+    put_u32(out + body_size, total_length);
+    return block;
+}
+
 std::vector<uint8_t> PcapBuilder::get_global_header()
 {
     pcap_hdr_s pcap_hdr;
@@ -31,14 +123,16 @@ std::vector<uint8_t> PcapBuilder::get_global_header()
     return std::vector<uint8_t>(reinterpret_cast<uint8_t*>(&pcap_hdr), reinterpret_cast<uint8_t*>(&pcap_hdr) + sizeof(pcap_hdr_s));
 }
 
-std::vector<uint8_t> PcapBuilder::get_packet_header(packet_queue_s packet, std::chrono::microseconds start_time)
+std::vector<uint8_t> PcapBuilder::get_packet_header(const packet_queue_s& packet, std::chrono::microseconds start_time)
 {
     CommandAssembler command_assembler;
-    packet_data data = command_assembler.convert_to_network_packet(packet.packet, start_time);
+    packet_data data = command_assembler.convert_to_network_packet(packet.packet, packet.length, start_time);
 
     pcaprec_hdr_s pcaprec_hdr;
-    pcaprec_hdr.ts_sec = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(start_time).count()) + std::chrono::duration_cast<std::chrono::seconds>(data.device_timestamp).count();
-    pcaprec_hdr.ts_usec = (static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(start_time).count()) + std::chrono::duration_cast<std::chrono::microseconds>(data.device_timestamp).count()) % 1000000;
+    // Add the full microsecond values, so the seconds get the carry of the microseconds
+    uint64_t timestamp = start_time.count() + data.device_timestamp.count();
+    pcaprec_hdr.ts_sec = static_cast<uint32_t>(timestamp / 1000000);
+    pcaprec_hdr.ts_usec = static_cast<uint32_t>(timestamp % 1000000);
     
     int total_length = (
         ipv4_header.size() +
@@ -60,11 +154,11 @@ std::vector<uint8_t> PcapBuilder::get_packet_header(packet_queue_s packet, std::
     return std::vector<uint8_t>(reinterpret_cast<uint8_t*>(&pcaprec_hdr), reinterpret_cast<uint8_t*>(&pcaprec_hdr) + sizeof(pcaprec_hdr_s));
 }
 
-std::vector<uint8_t> PcapBuilder::get_packet_data(packet_queue_s packet)
+std::vector<uint8_t> PcapBuilder::get_packet_data(const packet_queue_s& packet)
 {
     CommandAssembler command_assembler;
 
-    packet_data data = command_assembler.convert_to_network_packet(packet.packet, std::chrono::microseconds(0));
+    packet_data data = command_assembler.convert_to_network_packet(packet.packet, packet.length, std::chrono::microseconds(0));
 
     std::vector<uint8_t> final_packet;
 
@@ -101,12 +195,8 @@ std::vector<uint8_t> PcapBuilder::get_packet_data(packet_queue_s packet)
     std::vector<uint8_t> ti = ti_header;
     final_packet.insert(final_packet.end(), ti.begin(), ti.end());
 
-    // Get only number from string packet.interface
-    std::string interface_string = packet.serial_interface;
-    // Remove anything that is not a number
-    interface_string.erase(std::remove_if(interface_string.begin(), interface_string.end(), [](char c) { return !std::isdigit(c); }), interface_string.end());
-    // Convert string to int
-    int interface = std::stoi(interface_string);
+    // Get the interface number (digits of the interface name) from the registry
+    int interface = InterfaceRegistry::get(packet.interface_id).number;
     // Add interface to final_packet as 16 bits (inverted endianess)
     final_packet.push_back(interface & 0xFF);
     final_packet.push_back(interface >> 8);
@@ -132,4 +222,124 @@ std::vector<uint8_t> PcapBuilder::get_packet_data(packet_queue_s packet)
     final_packet.insert(final_packet.end(), data.data.begin(), data.data.end());
 
     return final_packet;
-}
\ No newline at end of file
+}
+
+size_t PcapBuilder::write_record(const packet_queue_s& packet, std::chrono::microseconds start_time, uint8_t* buffer, size_t buffer_size)
+{
+    const uint8_t* payload;
+    size_t payload_size;
+    if (buffer_size < PCAP_RECORD_HEADER_SIZE) return 0;
+    if (!write_record_header(packet, start_time, buffer, &payload, &payload_size)) return 0;
+    if (PCAP_RECORD_HEADER_SIZE + payload_size > buffer_size) return 0;
+    std::memcpy(buffer + PCAP_RECORD_HEADER_SIZE, payload, payload_size);
+    return PCAP_RECORD_HEADER_SIZE + payload_size;
+}
+
+bool PcapBuilder::write_record_header(const packet_queue_s& packet, std::chrono::microseconds start_time, uint8_t* buffer, const uint8_t** payload, size_t* payload_size)
+{
+    ti_frame_s frame;
+    if (!parse_frame(packet, frame)) return false;
+    *payload = frame.payload;
+    *payload_size = frame.payload_size;
+    size_t total_length = PCAP_ENCAPSULATION_SIZE + frame.payload_size;
+
+    // Packet header
+    pcaprec_hdr_s pcaprec_hdr;
+    uint64_t timestamp = start_time.count() + frame.device_timestamp;
+    pcaprec_hdr.ts_sec = static_cast<uint32_t>(timestamp / 1000000);
+    pcaprec_hdr.ts_usec = static_cast<uint32_t>(timestamp % 1000000);
+    pcaprec_hdr.incl_len = total_length;
+    pcaprec_hdr.orig_len = total_length;
+    std::memcpy(buffer, &pcaprec_hdr, sizeof(pcaprec_hdr_s));
+
+    write_encapsulation(packet, frame, buffer + sizeof(pcaprec_hdr_s));
+
+    return true;
+}
+
+std::vector<uint8_t> PcapBuilder::get_section_header()
+{
+    const std::string application = "Tuxniffer 1.1.3";
+    uint8_t body[16 + 4 + 64 + 4];
+    uint8_t* out = put_u32(body, 0x1A2B3C4D);
+    uint16_t version[2] = {1, 0};
+    std::memcpy(out, version, sizeof(version));
+    out += sizeof(version);
+    // Section length is not known while capturing
+    int64_t section_length = -1;
+    std::memcpy(out, &section_length, sizeof(section_length));
+    out += sizeof(section_length);
+    out = put_option(out, PCAPNG_SHB_USERAPPL, application.data(), application.size());
+    out = put_option(out, PCAPNG_OPT_ENDOFOPT, nullptr, 0);
+
+    return make_block(PCAPNG_SECTION_HEADER_BLOCK, body, out - body);
+}
+
+std::vector<uint8_t> PcapBuilder::get_interface_description(const interface_entry_s& interface)
+{
+    CommandAssembler command_assembler;
+    std::stringstream description;
+    description << "Radio mode " << (int)interface.mode << ", channel " << interface.channel << ", "
+                << std::fixed << std::setprecision(3)
+                << command_assembler.calculateFinalFreq(interface.mode, radio_mode_table[0][interface.mode].freq, interface.channel) << " MHz";
+    std::string if_description = description.str();
+    // Option values are limited to 16 bits
+    std::string if_name = interface.name.substr(0, 0xFFF0);
+
+    std::vector<uint8_t> body(8 + if_name.size() + if_description.size() + 40);
+    uint16_t link_type[2] = {228, 0};
+    std::memcpy(body.data(), link_type, sizeof(link_type));
+    uint8_t* out = put_u32(body.data() + sizeof(link_type), 65535);
+    out = put_option(out, PCAPNG_IF_NAME, if_name.data(), if_name.size());
+    out = put_option(out, PCAPNG_IF_DESCRIPTION, if_description.data(), if_description.size());
+    uint8_t tsresol = 9;
+    out = put_option(out, PCAPNG_IF_TSRESOL, &tsresol, sizeof(tsresol));
+    out = put_option(out, PCAPNG_OPT_ENDOFOPT, nullptr, 0);
+
+    return make_block(PCAPNG_INTERFACE_DESCRIPTION_BLOCK, body.data(), out - body.data());
+}
+
+bool PcapBuilder::write_enhanced_packet(const packet_queue_s& packet, uint32_t interface_index, std::chrono::microseconds start_time, uint8_t* header, uint8_t* trailer, size_t* trailer_size, const uint8_t** payload, size_t* payload_size)
+{
+    ti_frame_s frame;
+    if (!parse_frame(packet, frame)) return false;
+    *payload = frame.payload;
+    *payload_size = frame.payload_size;
+    size_t captured_length = PCAP_ENCAPSULATION_SIZE + frame.payload_size;
+    uint64_t timestamp = (start_time.count() + frame.device_timestamp) * 1000;
+
+    // Trailer: padding of the packet data, options and block length
+    uint8_t* out = trailer;
+    size_t padding = ((captured_length + 3) & ~static_cast<size_t>(3)) - captured_length;
+    std::memset(out, 0, padding);
+    out += padding;
+
+    int8_t rssi = static_cast<int8_t>(frame.rssi);
+    bool fcs_ok = (frame.status & TI_STATUS_FCS_OK) != 0;
+    uint32_t flags = PCAPNG_EPB_FLAG_INBOUND | (fcs_ok ? 0 : PCAPNG_EPB_FLAG_CRC_ERROR);
+    out = put_option(out, PCAPNG_EPB_FLAGS, &flags, sizeof(flags));
+
+    char comment[32];
+    int comment_length = snprintf(comment, sizeof(comment), "RSSI %d dBm, FCS %s", rssi, fcs_ok ? "OK" : "error");
+    out = put_option(out, PCAPNG_OPT_COMMENT, comment, static_cast<uint16_t>(comment_length));
+    out = put_option(out, PCAPNG_OPT_ENDOFOPT, nullptr, 0);
+
+    size_t block_length = PCAPNG_EPB_HEADER_SIZE + *payload_size + (out - trailer) + 4;
+    out = put_u32(out, static_cast<uint32_t>(block_length));
+    *trailer_size = out - trailer;
+
+    // Fixed part of the block
+    pcapng_epb_hdr_s epb_hdr;
+    epb_hdr.block_type = PCAPNG_ENHANCED_PACKET_BLOCK;
+    epb_hdr.block_total_length = static_cast<uint32_t>(block_length);
+    epb_hdr.interface_id = interface_index;
+    epb_hdr.ts_high = static_cast<uint32_t>(timestamp >> 32);
+    epb_hdr.ts_low = static_cast<uint32_t>(timestamp & 0xFFFFFFFF);
+    epb_hdr.captured_len = static_cast<uint32_t>(captured_length);
+    epb_hdr.orig_len = static_cast<uint32_t>(captured_length);
+    std::memcpy(header, &epb_hdr, sizeof(pcapng_epb_hdr_s));
+
+    write_encapsulation(packet, frame, header + sizeof(pcapng_epb_hdr_s));
+
+    return true;
+}
@@ -145,6 +145,21 @@ bool Pipe::close()
 // Writes data to the pipe.
 bool Pipe::write(const std::vector<uint8_t>& data)
 {
+    return write(data.data(), data.size());
+}
+
+// Writes data to the pipe.
+bool Pipe::write(const uint8_t* data, size_t size)
+{
+    struct iovec iov = {const_cast<uint8_t*>(data), size};
+    size_t written;
+    return write(&iov, 1, &written);
+}
+
+// Writes several buffers to the pipe.
+bool Pipe::write(struct iovec* iov, int count, size_t* written)
+{
+    *written = 0;
     if (pipeWrite == INVALID_PIPE_DESCRIPTOR)
     {
         D(std::cout << "[ERROR] Pipe: Invalid pipe descriptor." << std::endl;)
@@ -152,8 +167,8 @@ bool Pipe::write(const std::vector<uint8_t>& data)
     }
 
     #ifdef __linux__
-        ssize_t result = ::write(pipeWrite, data.data(), data.size());
-        if (result == -1)
+        // The pipe is non-blocking: short writes are resumed and a full pipe is waited on
+        if (!writev_all(pipeWrite, iov, count, BATCH_WRITE_TIMEOUT_MS, written))
         {
             D(char* errmsg = custom_strerror(errno);
                 std::cout << "[ERROR] Linux Pipe: write failed" << errmsg << "." << std::endl;
@@ -163,13 +178,17 @@ bool Pipe::write(const std::vector<uint8_t>& data)
     #endif
 
     #ifdef _WIN32
-        DWORD bytesWritten;
-        if (!WriteFile(pipeWrite, data.data(), data.size(), &bytesWritten, NULL))
+        for (int i = 0; i < count; i++)
         {
-            D(char* errmsg = custom_strerror(errno);
-                std::cout << "[ERROR] Windows Pipe: WriteFile failed" << errmsg << "." << std::endl;
-                free(errmsg);)
-            return false;
+            DWORD bytesWritten;
+            if (!WriteFile(pipeWrite, iov[i].iov_base, iov[i].iov_len, &bytesWritten, NULL))
+            {
+                D(char* errmsg = custom_strerror(errno);
+                    std::cout << "[ERROR] Windows Pipe: WriteFile failed" << errmsg << "." << std::endl;
+                    free(errmsg);)
+                return false;
+            }
+            *written += bytesWritten;
         }
     #endif
     return true;
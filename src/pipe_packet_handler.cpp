@@ -13,10 +13,10 @@
 #include "pcap_builder.hpp"
 #include "pipe_packet_handler.hpp"
 #include <csignal>
+#include <cstring>
 #include <iostream>
 #include <thread>
 #include <mutex>
-#include <queue>
 #include <chrono>
 #include <vector>
 
@@ -30,8 +30,16 @@ volatile std::sig_atomic_t pipe_interrupted = 0;
     }
 #endif
 
-PipePacketHandler::PipePacketHandler(std::string pipe_path, std::string base, std::chrono::time_point<std::chrono::system_clock> start_time)
+PipePacketHandler::PipePacketHandler(std::string pipe_path, std::string base, int num_devices, size_t max_packets, QueuePolicy policy, std::string spill_path, uint64_t spill_size, bool spill_recover, FramePool* frame_pool)
+: queue_max_size(max_packets > 0 ? max_packets : 1), queue_policy(policy), frame_pool(frame_pool), dropped(num_devices, 0), spilled(num_devices, 0), spill(spill_path, spill_size, spill_recover)
 {
+    record_positions.reserve(RECORD_BATCH_MAX_RECORDS);
+    if (policy == QueuePolicy::SPILL)
+    {
+        spill_record.resize(PCAP_RECORD_MAX_SIZE);
+        // Map the spill file now, so the packets recovered from a previous run are sent to the first consumer
+        spill.open();
+    }
     #ifdef __linux__
         this->pipe_path = pipe_path;
     #endif
@@ -39,26 +47,132 @@ PipePacketHandler::PipePacketHandler(std::string pipe_path, std::string base, st
         this->pipe_path = "\\\\.\\pipe\\";
     #endif
     this->base = base;
-    this->start_time = start_time;
 }
 
-void PipePacketHandler::add_packet(packet_queue_s packet, bool isTransportKey)
+void PipePacketHandler::add_packet(const FrameRef& frame, bool isTransportKey)
 {
     std::lock_guard<std::mutex> lock(m_mutex);
-    
-    // Check if the queue size has reached the maximum limit
-    if ((int)packet_queue.size() >= queue_max_size)
+    if (isTransportKey)
+    {
+        key_packets.push_back(frame);
+    }
+
+    // Once packets are spilled, the next ones also go to the spill file until it is sent, to keep their order
+    bool full = packet_queue.size() + writing >= queue_max_size;
+    bool pool_low = frame_pool && frame_pool->is_low();
+    if (queue_policy == QueuePolicy::SPILL && (full || !connected || !spill.empty() || pool_low))
+    {
+        spill_packet(frame);
+        queue_cv.notify_one();
+        return;
+    }
+
+    // While the frame pool is low, the pipe gives its oldest frame back for each new one, so a pipe that is behind can not starve the other outputs
+    if (pool_low && !packet_queue.empty())
     {
+        count(dropped, packet_queue.front()->id);
         packet_queue.pop();
-        D(std::cout << "[WARNING] Packet queue from pipe: " << pipe_path << base << " is full (over " << queue_max_size << " entries). Deleting oldest packet to add the new one." << std::endl;)
+        full = packet_queue.size() + writing >= queue_max_size;
+        D(std::cout << "[WARNING] Frame pool is low. Pipe: " << pipe_path << base << " dropped its oldest packet to add the new one." << std::endl;)
+    }
+
+    // Check if the queue size has reached the maximum limit (this runs on the output thread, so it never waits for room)
+    if (full)
+    {
+        if (queue_policy == QueuePolicy::DROP_OLDEST && !packet_queue.empty())
+        {
+            count(dropped, packet_queue.front()->id);
+            packet_queue.pop();
+            D(std::cout << "[WARNING] Packet queue from pipe: " << pipe_path << base << " is full (" << queue_max_size << " packets). Deleting oldest packet to add the new one." << std::endl;)
+        }
+        else
+        {
+            count(dropped, frame->id);
+            D(std::cout << "[WARNING] Packet queue from pipe: " << pipe_path << base << " is full (" << queue_max_size << " packets). Discarding packet." << std::endl;)
+            return;
+        }
     }
 
     // Add the new packet to the queue
-    packet_queue.push(packet);
-    if (isTransportKey)
+    packet_queue.push(frame);
+    queue_cv.notify_one();
+}
+
+void PipePacketHandler::spill_packet(const FrameRef& frame)
+{
+    // Capture time set by the output manager, shifted to local time like the legacy pcap files
+    auto start_time_micros = std::chrono::microseconds(frame->clock_offset) + std::chrono::seconds(TIMEZONE);
+    size_t size = PcapBuilder::write_record(*frame, start_time_micros, spill_record.data(), spill_record.size());
+    if (size == 0) return;
+    if (spill.append(spill_record.data(), size)) count(spilled, frame->id);
+    else count(dropped, frame->id);
+}
+
+bool PipePacketHandler::write_spilled()
+{
+    while (is_running)
+    {
+        size_t size;
+        const uint8_t* records;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            records = spill.front(PIPE_SPILL_WRITE_SIZE, &size);
+        }
+        if (size == 0) return true;
+
+        // The records are only removed by this thread, and appends do not touch them, so they are written without the lock
+        struct iovec iov = {(void*)records, size};
+        size_t written = 0;
+        bool success = pipe.write(&iov, 1, &written);
+
+        // Remove only the complete records that were written, so a new consumer gets the partial one again
+        size_t complete = 0;
+        while (complete + sizeof(pcaprec_hdr_s) <= written)
+        {
+            pcaprec_hdr_s pcaprec_hdr;
+            std::memcpy(&pcaprec_hdr, records + complete, sizeof(pcaprec_hdr_s));
+            size_t record_size = sizeof(pcaprec_hdr_s) + pcaprec_hdr.incl_len;
+            if (complete + record_size > written) break;
+            complete += record_size;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            spill.consume(complete);
+        }
+        if (!success) return false;
+    }
+    return true;
+}
+
+std::vector<pipe_queue_stats_s> PipePacketHandler::get_queue_stats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<pipe_queue_stats_s> stats;
+    for (size_t i = 0; i < dropped.size(); i++)
+    {
+        stats.push_back({(int)i, dropped[i], spilled[i]});
+    }
+    return stats;
+}
+
+void PipePacketHandler::stop()
+{
+    is_running = false;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    queue_cv.notify_one();
+}
+
+void PipePacketHandler::requeue_front(RingQueue<FrameRef>& pending)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Packets added while the batch was being written go after the pending ones
+    while (!packet_queue.empty())
     {
-        key_packets.push_back(packet);
+        pending.push(packet_queue.front());
+        packet_queue.pop();
     }
+    std::swap(pending, packet_queue);
+    writing = 0;
 }
 
 void PipePacketHandler::run()
@@ -94,6 +208,10 @@ void PipePacketHandler::run()
         }
 
         D(std::cout << "[INFO] Pipe Packet Handler received a consumer." << std::endl;)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            connected = true;
+        }
 
         // Write global header
         std::vector<uint8_t> global_header = PcapBuilder::get_global_header();
@@ -101,29 +219,66 @@ void PipePacketHandler::run()
 
         // Handle packets and check for interruptions
         while (is_running)
-        {     
-            if (!packet_queue.empty())
+        {
+            // Take every pending packet at once and write them without holding the lock
+            RingQueue<FrameRef>& batch = write_queue;
             {
-                std::lock_guard<std::mutex> lock(m_mutex);
-                packet_queue_s packet = packet_queue.front();
-                packet_queue.pop();
-                auto start_time_micros = std::chrono::duration_cast<std::chrono::microseconds>(start_time.time_since_epoch());
-                std::vector<uint8_t> packet_header = PcapBuilder::get_packet_header(packet, start_time_micros);
-                if(!pipe.write(packet_header))
+                std::unique_lock<std::mutex> lock(m_mutex);
+                if (packet_queue.empty() && spill.empty())
                 {
-                    #ifdef _WIN32
-                        pipe_interrupted = 1;
-                    #endif
-                    break;
+                    // The timeout keeps checking the pipe state while there is no traffic
+                    queue_cv.wait_for(lock, std::chrono::milliseconds(100), [this]() { return !packet_queue.empty() || !spill.empty() || !is_running; });
                 }
-                std::vector<uint8_t> packet_data = PcapBuilder::get_packet_data(packet);
-                if(!pipe.write(packet_data))
+                std::swap(batch, packet_queue);
+                // The packets being written still count for the queue budget
+                writing = batch.size();
+            }
+
+            bool write_failed = false;
+            while (!batch.empty())
+            {
+                // Put as many packets as possible in a record batch. They stay queued until written
+                size_t taken = 0;
+                record_batch.clear();
+                record_positions.clear();
+                while (taken < batch.size() && !record_batch.full())
                 {
-                    #ifdef _WIN32
-                        pipe_interrupted = 1;
-                    #endif
+                    // Capture time set by the output manager, shifted to local time like the legacy pcap files
+                    auto start_time_micros = std::chrono::microseconds(batch[taken]->clock_offset) + std::chrono::seconds(TIMEZONE);
+                    if (record_batch.add(batch[taken], start_time_micros)) record_positions.push_back(taken);
+                    taken++;
+                }
+
+                // Write the whole batch with a single vectored write
+                size_t written = 0;
+                if(!record_batch.empty() && !pipe.write(record_batch.iovecs(), record_batch.iovec_count(), &written))
+                {
+                    // Drop only the packets written before the failure
+                    size_t first_unwritten = record_positions[record_batch.records_within(written)];
+                    for (size_t i = 0; i < first_unwritten; i++) batch.pop();
+                    record_batch.clear();
+                    write_failed = true;
                     break;
                 }
+                record_batch.clear();
+                for (size_t i = 0; i < taken; i++) batch.pop();
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    writing = batch.size();
+                }
+            }
+
+            // The spilled packets are newer than the queued ones
+            if (!write_failed && queue_policy == QueuePolicy::SPILL && !write_spilled()) write_failed = true;
+
+            if (write_failed)
+            {
+                // Keep the packets that were not written for the next consumer
+                requeue_front(batch);
+                #ifdef _WIN32
+                    pipe_interrupted = 1;
+                #endif
+                break;
             }
             
             #ifdef _WIN32
@@ -139,7 +294,6 @@ void PipePacketHandler::run()
                     break;
                 }
             #endif
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
         }
         if (pipe_interrupted)
         {
@@ -147,9 +301,14 @@ void PipePacketHandler::run()
             D(std::cout << "[INFO] Please reconnect pipe. Pipe streaming will be put on hold." << std::endl;)
             pipe_interrupted = 0;
             pipe.close();
-            for (auto packet : key_packets)
             {
-                add_packet(packet);
+                // The key packets are sent again to the next consumer (out of the queue budget, so this thread never waits for itself)
+                std::lock_guard<std::mutex> lock(m_mutex);
+                connected = false;
+                for (auto packet : key_packets)
+                {
+                    packet_queue.push(packet);
+                }
             }
             continue; // Restart the loop to wait for a new connection
         }
@@ -157,5 +316,7 @@ void PipePacketHandler::run()
         // Close the pipe if no longer running
         pipe.close();
         is_open = false;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        connected = false;
     }
 }
\ No newline at end of file
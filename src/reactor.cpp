@@ -0,0 +1,251 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <signal.h>
+#include <errno.h>
+
+#include "common.hpp"
+#include "device.hpp"
+#include "reactor.hpp"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+// Maximum number of events handled per epoll_wait call
+#define REACTOR_MAX_EVENTS 64
+// Longest time the loop sleeps, so interruptions, duration and reconnections are checked regularly
+#define REACTOR_TICK_MS 1000
+// Time between reconnection attempts
+#define REACTOR_RETRY_SECONDS 10
+// Longest sleep of a reconnection worker, so it notices quickly that the reactor stopped
+#define REACTOR_WORKER_SLICE_MS 100
+
+Reactor::Reactor(std::mutex &coutMutex)
+    : coutMutex(coutMutex)
+{
+    #ifdef __linux__
+    epoll_fd = epoll_create1(0);
+    if (epoll_fd == -1)
+    {
+        D(char* errmsg = custom_strerror(errno);
+            std::cout << "[ERROR] Could not create epoll instance" << errmsg << "." << std::endl;
+            free(errmsg);)
+        return;
+    }
+
+    // The eventfd is registered with a null pointer, which tells it apart from the devices
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    if (wake_fd == -1 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &event) != 0)
+    {
+        D(char* errmsg = custom_strerror(errno);
+            std::cout << "[ERROR] Could not create the reactor wake up descriptor" << errmsg << "." << std::endl;
+            free(errmsg);)
+    }
+    #else
+    epoll_fd = -1;
+    #endif
+}
+
+Reactor::~Reactor()
+{
+    stop_workers();
+    #ifdef __linux__
+    if (wake_fd != -1) close(wake_fd);
+    if (epoll_fd != -1) close(epoll_fd);
+    #endif
+}
+
+bool Reactor::add(Device* device)
+{
+    #ifdef __linux__
+    if (epoll_fd == -1) return false;
+
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = device;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, device->serial.descriptor, &event) != 0)
+    {
+        D(char* errmsg = custom_strerror(errno);
+            std::lock_guard<std::mutex> lock(coutMutex);
+            std::cout << "[ERROR] Could not add Device [" << device->id << "] to the reactor" << errmsg << "." << std::endl;
+            free(errmsg);)
+        return false;
+    }
+    active_devices++;
+    device->is_streaming = true;
+    // Losses are handled by the reactor, the device must not block the loop reconnecting by itself
+    device->reconnect_on_loss = false;
+
+    // Frames that arrived together with the start response are already in the serial buffer, epoll will not report them
+    if (device->serial.hasBufferedData() && device->stream_step() < 0) lose(device);
+
+    return true;
+    #else
+    (void)device;
+    return false;
+    #endif
+}
+
+void Reactor::lose(Device* device)
+{
+    #ifdef __linux__
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, device->serial.descriptor, nullptr);
+    #endif
+    active_devices--;
+    device->is_streaming = false;
+    device->set_active(false);
+    device->state = State::WAITING_FOR_COMMAND;
+    device->serial.closePort();
+    {
+        std::lock_guard<std::mutex> lock(coutMutex);
+        std::cout << "[ERROR] Connection lost with Device [" << device->id << "]." << std::endl;
+    }
+    D({std::lock_guard<std::mutex> lock(coutMutex); std::cout << "[INFO] Trying to reconnect with Device [" << device->id << "] in " << REACTOR_RETRY_SECONDS << " seconds." << std::endl;})
+    lost_devices.push_back({device, std::thread(&Reactor::reconnect, this, device)});
+}
+
+void Reactor::reconnect(Device* device)
+{
+    while (!stopping && !interruption)
+    {
+        auto next_attempt = std::chrono::steady_clock::now() + std::chrono::seconds(REACTOR_RETRY_SECONDS);
+        while (!stopping && !interruption && std::chrono::steady_clock::now() < next_attempt)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(REACTOR_WORKER_SLICE_MS));
+        }
+        if (stopping || interruption) return;
+
+        if (device->try_reconnect())
+        {
+            {
+                std::lock_guard<std::mutex> lock(reconnected_mutex);
+                reconnected.push_back(device);
+            }
+            #ifdef __linux__
+            uint64_t one = 1;
+            if (write(wake_fd, &one, sizeof(one)) != sizeof(one))
+            {
+                D({std::lock_guard<std::mutex> lock(coutMutex); std::cout << "[ERROR] Could not wake up the reactor." << std::endl;})
+            }
+            #endif
+            return;
+        }
+        D({std::lock_guard<std::mutex> lock(coutMutex); std::cout << "[ERROR] Reconnection with Device [" << device->id << "] failed. Trying again in " << REACTOR_RETRY_SECONDS << " seconds." << std::endl;})
+    }
+}
+
+void Reactor::add_reconnected_devices()
+{
+    #ifdef __linux__
+    uint64_t count;
+    while (read(wake_fd, &count, sizeof(count)) == sizeof(count)) {}
+    #endif
+
+    std::vector<Device*> devices;
+    {
+        std::lock_guard<std::mutex> lock(reconnected_mutex);
+        devices.swap(reconnected);
+    }
+    for (Device* device : devices)
+    {
+        // The worker returns right after publishing the device
+        for (size_t i = 0; i < lost_devices.size(); i++)
+        {
+            if (lost_devices[i].device != device) continue;
+            if (lost_devices[i].worker.joinable()) lost_devices[i].worker.join();
+            lost_devices.erase(lost_devices.begin() + i);
+            break;
+        }
+        if (add(device))
+        {
+            std::lock_guard<std::mutex> lock(coutMutex);
+            std::cout << "[INFO] Reconnected with Device [" << device->id << "]." << std::endl;
+        }
+    }
+}
+
+void Reactor::stop_workers()
+{
+    stopping = true;
+    for (auto& lost : lost_devices)
+    {
+        if (lost.worker.joinable()) lost.worker.join();
+    }
+    lost_devices.clear();
+}
+
+void Reactor::run(std::chrono::seconds duration)
+{
+    #ifdef __linux__
+    // ctrl-c
+    signal(SIGINT, signal_handler);
+    // killall
+    signal(SIGTERM, signal_handler);
+
+    auto start_time = std::chrono::steady_clock::now();
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+
+    while (!interruption && (active_devices > 0 || !lost_devices.empty()))
+    {
+        int timeout_ms = REACTOR_TICK_MS;
+        if (duration.count() >= 0)
+        {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(start_time + duration - std::chrono::steady_clock::now());
+            if (remaining.count() <= 0) break;
+            if (remaining.count() < timeout_ms) timeout_ms = static_cast<int>(remaining.count());
+        }
+
+        int ready = epoll_wait(epoll_fd, events, REACTOR_MAX_EVENTS, timeout_ms);
+        if (ready < 0 && errno != EINTR)
+        {
+            D(char* errmsg = custom_strerror(errno);
+                std::cout << "[ERROR] Reactor epoll_wait failed" << errmsg << "." << std::endl;
+                free(errmsg);)
+            break;
+        }
+
+        // Each ready device reads once per iteration, so a busy device cannot starve the others
+        bool wake = false;
+        for (int i = 0; i < ready; i++)
+        {
+            Device* device = static_cast<Device*>(events[i].data.ptr);
+            if (device == nullptr)
+            {
+                wake = true;
+                continue;
+            }
+            if (device->stream_step() < 0) lose(device);
+        }
+
+        if (wake) add_reconnected_devices();
+    }
+
+    // Devices still being reconnected are given up
+    stop_workers();
+
+    // Reset SIGINT to default behavior
+    signal(SIGINT, SIG_DFL);
+    // Reset SIGTERM to default behavior
+    signal(SIGTERM, SIG_DFL);
+    #else
+    (void)duration;
+    #endif
+}
@@ -0,0 +1,161 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+#include <iostream>
+#include <cstring>
+#include <errno.h>
+
+#include "record_batch.hpp"
+#include "common.hpp"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <poll.h>
+#include <limits.h>
+#endif
+
+#ifdef __linux__
+bool writev_all(int fd, struct iovec* iov, int count, int timeout_ms, size_t* written)
+{
+    size_t total = 0;
+    while (count > 0)
+    {
+        ssize_t result = ::writev(fd, iov, count < IOV_MAX ? count : IOV_MAX);
+        if (result < 0)
+        {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                // Wait for the consumer to read before giving up
+                struct pollfd pfd = {fd, POLLOUT, 0};
+                if (poll(&pfd, 1, timeout_ms) > 0 && !(pfd.revents & (POLLERR | POLLHUP))) continue;
+            }
+            if (written) *written = total;
+            return false;
+        }
+        total += result;
+
+        // Skip the iovecs that were completely written and advance into a partially written one
+        size_t remaining = result;
+        while (count > 0 && remaining >= iov->iov_len)
+        {
+            remaining -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0)
+        {
+            iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + remaining;
+            iov->iov_len -= remaining;
+        }
+    }
+    if (written) *written = total;
+    return true;
+}
+#endif
+
+RecordBatch::RecordBatch(size_t max_records, CaptureFormat format) : max_records(max_records), format(format)
+{
+    bool pcapng = format == CaptureFormat::PCAPNG;
+    header_size = pcapng ? PCAPNG_EPB_HEADER_SIZE : PCAP_RECORD_HEADER_SIZE;
+    iovecs_per_record = pcapng ? 3 : 2;
+    headers.resize(max_records * header_size);
+    if (pcapng) trailers.resize(max_records * PCAPNG_EPB_TRAILER_MAX_SIZE);
+    iov.resize(max_records * iovecs_per_record);
+    frames.resize(max_records);
+}
+
+bool RecordBatch::add(const FrameRef& frame, std::chrono::microseconds start_time, uint32_t interface_index)
+{
+    if (full()) return false;
+
+    uint8_t* header = &headers[records * header_size];
+    const uint8_t* payload;
+    size_t payload_size;
+    struct iovec* record_iov = &iov[records * iovecs_per_record];
+    if (format == CaptureFormat::PCAPNG)
+    {
+        uint8_t* trailer = &trailers[records * PCAPNG_EPB_TRAILER_MAX_SIZE];
+        size_t trailer_size;
+        if (!PcapBuilder::write_enhanced_packet(*frame, interface_index, start_time, header, trailer, &trailer_size, &payload, &payload_size)) return false;
+        record_iov[2] = {trailer, trailer_size};
+    }
+    else
+    {
+        if (!PcapBuilder::write_record_header(*frame, start_time, header, &payload, &payload_size)) return false;
+    }
+
+    record_iov[0] = {header, header_size};
+    record_iov[1] = {const_cast<uint8_t*>(payload), payload_size};
+    frames[records] = frame;
+    records++;
+    byte_count += header_size + payload_size + (format == CaptureFormat::PCAPNG ? record_iov[2].iov_len : 0);
+    return true;
+}
+
+bool RecordBatch::write_to(FILE* file)
+{
+    if (empty()) return true;
+    #ifdef __linux__
+        // The global header (or the pcapng section and interface blocks) is written through stdio, so it must reach the file before the records
+        fflush(file);
+        size_t written = 0;
+        if (!writev_all(fileno(file), iov.data(), iovec_count(), BATCH_WRITE_TIMEOUT_MS, &written))
+        {
+            D(char* errmsg = custom_strerror(errno);
+                std::cout << "[ERROR] Could not write to log file" << errmsg << ". " << size() - records_within(written) << " packets were lost." << std::endl;
+                free(errmsg);)
+            return false;
+        }
+    #endif
+    #ifdef _WIN32
+        for (int i = 0; i < iovec_count(); i++)
+        {
+            if (fwrite(iov[i].iov_base, 1, iov[i].iov_len, file) != iov[i].iov_len) return false;
+        }
+    #endif
+    return true;
+}
+
+size_t RecordBatch::records_within(size_t bytes) const
+{
+    // Uses the record sizes kept in the headers, since the iovecs may have been advanced by a short write
+    size_t complete = 0;
+    for (size_t i = 0; i < records; i++)
+    {
+        size_t record_size;
+        if (format == CaptureFormat::PCAPNG)
+        {
+            pcapng_epb_hdr_s epb_hdr;
+            std::memcpy(&epb_hdr, &headers[i * header_size], sizeof(pcapng_epb_hdr_s));
+            record_size = epb_hdr.block_total_length;
+        }
+        else
+        {
+            pcaprec_hdr_s pcaprec_hdr;
+            std::memcpy(&pcaprec_hdr, &headers[i * header_size], sizeof(pcaprec_hdr_s));
+            record_size = sizeof(pcaprec_hdr_s) + pcaprec_hdr.incl_len;
+        }
+        if (bytes < record_size) break;
+        bytes -= record_size;
+        complete++;
+    }
+    return complete;
+}
+
+void RecordBatch::clear()
+{
+    for (size_t i = 0; i < records; i++) frames[i].reset();
+    records = 0;
+    byte_count = 0;
+}
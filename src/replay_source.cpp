@@ -0,0 +1,311 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "replay_source.hpp"
+#include "common.hpp"
+#include "device.hpp"
+
+#define PCAP_MAGIC_MICROSECONDS 0xA1B2C3D4
+#define PCAP_MAGIC_NANOSECONDS 0xA1B23C4D
+#define PCAPNG_SHB_TYPE 0x0A0D0D0A
+#define PCAPNG_IDB_TYPE 0x00000001
+#define PCAPNG_EPB_TYPE 0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4D
+#define PCAPNG_OPTION_TSRESOL 9
+// Largest pcapng block that is read (larger blocks are skipped)
+#define PCAPNG_BLOCK_MAX_SIZE (1 << 20)
+// Longest pcap record accepted when the file header does not give a smaller snaplen
+#define PCAP_SNAPLEN_MAX 65535
+// Longest sleep while pacing, so an interruption is noticed quickly
+#define REPLAY_WAIT_SLICE std::chrono::milliseconds(100)
+
+static uint16_t read_le16(const uint8_t* data)
+{
+    return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+static uint32_t read_le32(const uint8_t* data)
+{
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) | (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+// Converts a timestamp in units of 1/ticks seconds to microseconds
+static int64_t ticks_to_micros(uint64_t timestamp, uint64_t ticks)
+{
+    if (ticks == 1000000) return static_cast<int64_t>(timestamp);
+    return static_cast<int64_t>((timestamp / ticks) * 1000000 + (timestamp % ticks) * 1000000 / ticks);
+}
+
+ReplaySource::ReplaySource(const std::string& path, double speed)
+    : path(path), speed(speed)
+{
+    record.reserve(PCAP_RECORD_MAX_SIZE);
+}
+
+ReplaySource::~ReplaySource()
+{
+    close();
+}
+
+bool ReplaySource::open()
+{
+    close();
+    file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+    {
+        std::cout << "[ERROR] Failed to open replay file " << path << "." << std::endl;
+        return false;
+    }
+
+    uint8_t header[24];
+    if (fread(header, 1, 4, file) != 4)
+    {
+        std::cout << "[ERROR] Replay file " << path << " is empty." << std::endl;
+        close();
+        return false;
+    }
+
+    uint32_t magic = read_le32(header);
+    if (magic == PCAP_MAGIC_MICROSECONDS || magic == PCAP_MAGIC_NANOSECONDS)
+    {
+        if (fread(header + 4, 1, 20, file) != 20)
+        {
+            std::cout << "[ERROR] Replay file " << path << " has a truncated pcap header." << std::endl;
+            close();
+            return false;
+        }
+        format = CaptureFormat::PCAP;
+        nanoseconds = magic == PCAP_MAGIC_NANOSECONDS;
+        snaplen = read_le32(header + 16);
+        if (snaplen == 0 || snaplen > PCAP_SNAPLEN_MAX) snaplen = PCAP_SNAPLEN_MAX;
+        link_type = read_le32(header + 20);
+    }
+    else if (magic == PCAPNG_SHB_TYPE)
+    {
+        // The Section Header Block is read again by next_record, like any other block
+        rewind(file);
+        format = CaptureFormat::PCAPNG;
+    }
+    else
+    {
+        std::cout << "[ERROR] Replay file " << path << " is not a little-endian pcap or pcapng file." << std::endl;
+        close();
+        return false;
+    }
+
+    started = false;
+    skipped = 0;
+    return true;
+}
+
+void ReplaySource::close()
+{
+    if (file != nullptr) fclose(file);
+    file = nullptr;
+    interface_link_types.clear();
+    interface_ticks.clear();
+}
+
+void ReplaySource::add_interface(const uint8_t* body, size_t size)
+{
+    uint32_t type = size >= 2 ? read_le16(body) : 0;
+    uint64_t ticks = 1000000;
+    // Options start after link type (2), reserved (2) and snap length (4)
+    size_t position = 8;
+    while (position + 4 <= size)
+    {
+        uint16_t code = read_le16(body + position);
+        uint16_t length = read_le16(body + position + 2);
+        position += 4;
+        if (code == 0 || position + length > size) break;
+        if (code == PCAPNG_OPTION_TSRESOL && length >= 1)
+        {
+            uint8_t resolution = body[position];
+            uint8_t exponent = resolution & 0x7F;
+            // The high bit selects a power of two, otherwise it is a power of ten
+            if (exponent < 64)
+            {
+                ticks = 1;
+                for (uint8_t i = 0; i < exponent; i++) ticks *= (resolution & 0x80) ? 2 : 10;
+            }
+        }
+        position += (length + 3) & ~3u;
+    }
+    interface_link_types.push_back(type);
+    interface_ticks.push_back(ticks);
+}
+
+bool ReplaySource::next_record(uint32_t& type, size_t& length, int64_t& timestamp)
+{
+    if (file == nullptr) return false;
+
+    if (format == CaptureFormat::PCAP)
+    {
+        pcaprec_hdr_s header;
+        if (fread(&header, sizeof(header), 1, file) != 1) return false;
+        // A record longer than the snaplen can only come from a corrupted file
+        if (header.incl_len > snaplen)
+        {
+            std::cout << "[ERROR] Replay file " << path << " has a pcap record of " << std::dec << header.incl_len << " bytes (snaplen " << snaplen << ")." << std::endl;
+            return false;
+        }
+        record.resize(header.incl_len);
+        if (header.incl_len > 0 && fread(record.data(), 1, header.incl_len, file) != header.incl_len) return false;
+        type = link_type;
+        length = header.incl_len;
+        timestamp = static_cast<int64_t>(header.ts_sec) * 1000000 + (nanoseconds ? header.ts_usec / 1000 : header.ts_usec);
+        // tuxniffer writes its pcap files in local time (see TIMEZONE)
+        if (type == REPLAY_LINKTYPE_TI) timestamp -= static_cast<int64_t>(TIMEZONE) * 1000000;
+        return true;
+    }
+
+    while (true)
+    {
+        uint8_t block_header[8];
+        if (fread(block_header, 1, 8, file) != 8) return false;
+        uint32_t block_type = read_le32(block_header);
+        uint32_t block_length = read_le32(block_header + 4);
+        if (block_length < 12 || block_length % 4 != 0)
+        {
+            std::cout << "[ERROR] Replay file " << path << " has an invalid pcapng block." << std::endl;
+            return false;
+        }
+        size_t body_length = block_length - 8;
+        if (body_length > PCAPNG_BLOCK_MAX_SIZE)
+        {
+            if (fseek(file, static_cast<long>(body_length), SEEK_CUR) != 0) return false;
+            continue;
+        }
+        record.resize(body_length);
+        if (fread(record.data(), 1, body_length, file) != body_length) return false;
+        // The body ends with the repeated block length
+        body_length -= 4;
+
+        if (block_type == PCAPNG_SHB_TYPE)
+        {
+            if (body_length < 4 || read_le32(record.data()) != PCAPNG_BYTE_ORDER_MAGIC)
+            {
+                std::cout << "[ERROR] Replay file " << path << " is not a little-endian pcapng file." << std::endl;
+                return false;
+            }
+            // Interfaces are numbered per section
+            interface_link_types.clear();
+            interface_ticks.clear();
+        }
+        else if (block_type == PCAPNG_IDB_TYPE)
+        {
+            add_interface(record.data(), body_length);
+        }
+        else if (block_type == PCAPNG_EPB_TYPE && body_length >= 20)
+        {
+            uint32_t interface = read_le32(record.data());
+            uint64_t ts = (static_cast<uint64_t>(read_le32(record.data() + 4)) << 32) | read_le32(record.data() + 8);
+            uint32_t captured = read_le32(record.data() + 12);
+            if (interface >= interface_link_types.size() || captured > body_length - 20)
+            {
+                skipped++;
+                continue;
+            }
+            type = interface_link_types[interface];
+            timestamp = ticks_to_micros(ts, interface_ticks[interface]);
+            // Move the packet data to the start of the record
+            memmove(record.data(), record.data() + 20, captured);
+            length = captured;
+            return true;
+        }
+    }
+}
+
+bool ReplaySource::next_frame(std::vector<uint8_t>& frame, std::chrono::system_clock::time_point& capture_time)
+{
+    uint32_t type;
+    size_t length;
+    int64_t timestamp;
+    while (next_record(type, length, timestamp))
+    {
+        const uint8_t* payload = record.data();
+        size_t payload_length = length;
+        uint8_t rssi = 0;
+        // Packets that were not captured by a sniffer are replayed as received with a valid FCS
+        uint8_t status = 0x80;
+        if (type == REPLAY_LINKTYPE_TI && length >= PCAP_ENCAPSULATION_SIZE)
+        {
+            payload += PCAP_ENCAPSULATION_SIZE;
+            payload_length -= PCAP_ENCAPSULATION_SIZE;
+            rssi = record[PCAP_ENCAPSULATION_SIZE - 2];
+            status = record[PCAP_ENCAPSULATION_SIZE - 1];
+        }
+        else if (type == REPLAY_LINKTYPE_IEEE802_15_4 && length >= 2)
+        {
+            // The sniffer frames do not carry the FCS
+            payload_length -= 2;
+        }
+        else if (type != REPLAY_LINKTYPE_IEEE802_15_4_NOFCS)
+        {
+            skipped++;
+            continue;
+        }
+
+        // The framer rejects frames that do not fit its buffer or have a zero status
+        if (payload_length + 16 > FRAME_MAX_SIZE || status == 0)
+        {
+            skipped++;
+            continue;
+        }
+
+        if (!started)
+        {
+            started = true;
+            first_time = timestamp;
+            start = std::chrono::steady_clock::now();
+        }
+        uint64_t device_time = timestamp > first_time ? static_cast<uint64_t>(timestamp - first_time) : 0;
+        uint16_t frame_length = static_cast<uint16_t>(payload_length + 9);
+
+        frame.clear();
+        frame.push_back(0x40);
+        frame.push_back(0x53);
+        frame.push_back(0xC0);
+        frame.push_back(frame_length & 0xFF);
+        frame.push_back(frame_length >> 8);
+        for (int i = 0; i < 6; i++) frame.push_back((device_time >> (i * 8)) & 0xFF);
+        frame.push_back(0x00);
+        frame.insert(frame.end(), payload, payload + payload_length);
+        frame.push_back(rssi);
+        frame.push_back(status);
+        frame.push_back(0x40);
+        frame.push_back(0x45);
+
+        capture_time = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::microseconds(timestamp)));
+        return true;
+    }
+    return false;
+}
+
+bool ReplaySource::wait(std::chrono::system_clock::time_point capture_time)
+{
+    if (speed <= 0 || !started) return !interruption;
+    int64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(capture_time.time_since_epoch()).count() - first_time;
+    auto due = start + std::chrono::microseconds(static_cast<int64_t>(elapsed / speed));
+    while (!interruption)
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= due) return true;
+        auto remaining = due - now;
+        std::this_thread::sleep_for(remaining < REPLAY_WAIT_SLICE ? remaining : std::chrono::duration_cast<std::chrono::steady_clock::duration>(REPLAY_WAIT_SLICE));
+    }
+    return false;
+}
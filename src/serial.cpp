@@ -19,12 +19,14 @@
 #include <chrono>
 #include <thread>
 #include <errno.h>
+#include <algorithm>
 
 #include "common.hpp"
 #include "serial.hpp"
 
 #ifdef __linux__
 #include <unistd.h>
+#include <poll.h>
 #endif
 
 Serial::Serial(std::string port)
@@ -35,6 +37,10 @@ Serial::Serial(std::string port)
 
 bool Serial::connect()
 {
+    // Discard bytes buffered from a previous connection
+    buffer_start = 0;
+    buffer_end = 0;
+
     // Open serial port linux
     #ifdef __linux__
     D(std::cout << "[INFO] Opening serial port on LINUX: " << port << "." << std::endl;)
@@ -151,12 +157,15 @@ bool Serial::disconnect()
     }
 
     #endif
-    
+    descriptor = INVALID_FILE_DESCRIPTOR;
+
     return true;
 }
 
 void Serial::closePort()
 {
+    // Nothing to close (avoids closing a descriptor reused by another port)
+    if (descriptor == INVALID_FILE_DESCRIPTOR) return;
     // Close serial port linux
     #ifdef __linux__
     close(descriptor);
@@ -166,6 +175,7 @@ void Serial::closePort()
     // Close serial port
     CloseHandle(descriptor);
     #endif
+    descriptor = INVALID_FILE_DESCRIPTOR;
 }
 
 bool Serial::writeData(std::vector<uint8_t> data)
@@ -239,69 +249,94 @@ bool Serial::writeData(uint8_t data)
 
 std::vector<uint8_t> Serial::readData()
 {
+    // Refill the buffer only if everything read before was already consumed
+    if (!hasBufferedData() && fillBuffer() <= 0)
+    {
+        return std::vector<uint8_t>();
+    }
+
+    // Create a vector with the buffered data and mark it as consumed
+    std::vector<uint8_t> data(buffer + buffer_start, buffer + buffer_end);
+    buffer_start = buffer_end;
+    return data;
+}
+
+int Serial::readByte(uint8_t* byte)
+{
+    // Serve from the buffer when possible, only going to the OS when it is empty
+    if (nextBufferedByte(byte)) return 1;
+
+    int bytes_read = fillBuffer();
+    if (bytes_read <= 0) return bytes_read;
+
+    nextBufferedByte(byte);
+    return 1;
+}
 
-    // Read data from serial port linux
-    int bytes_read;
+int Serial::fillBuffer()
+{
+    buffer_start = 0;
+    buffer_end = 0;
+
+    int bytes_read = 0;
+    // Read everything available from serial port linux
     #ifdef __linux__
-    // Read data from serial port
+    read_calls++;
     bytes_read = read(descriptor, buffer, BUFFER_SIZE);
     if (bytes_read == 0) {
-        // End of file reached
-        D(std::cout << "[INFO] There was no data to read from serial port." << std::endl;);
-        return std::vector<uint8_t>();
+        // End of file reached, the device was disconnected
+        return -1;
     }
     if (bytes_read < 0) {
+        // Non blocking port without data (or interrupted read)
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return 0;
         D(char* errmsg = custom_strerror(errno);
             std::cout << "[ERROR] Error reading data from serial port" << errmsg << "." << std::endl;
             free(errmsg);)
-        return std::vector<uint8_t>();
+        return -1;
     }
     #endif
-    // Read data from serial port windows
+    // Read everything available from serial port windows
     #ifdef _WIN32
+    DWORD errors;
+    COMSTAT status;
+    DWORD to_read = 1;
+    // Ask how many bytes are queued so ReadFile does not block waiting to fill the whole buffer
+    if (ClearCommError(descriptor, &errors, &status) && status.cbInQue > 0)
+    {
+        to_read = status.cbInQue < BUFFER_SIZE ? status.cbInQue : BUFFER_SIZE;
+    }
     DWORD bytes_read_dw;
-    if (!ReadFile(descriptor, buffer, BUFFER_SIZE, &bytes_read_dw, NULL)) {
-        D(char* errmsg = custom_strerror(errno);
-            std::cout << "[ERROR] Error reading data from serial port" << errmsg << "." << std::endl;
-            free(errmsg);)
-        return std::vector<uint8_t>();
+    read_calls++;
+    if (!ReadFile(descriptor, buffer, to_read, &bytes_read_dw, NULL)) {
+        return -1;
     }
     bytes_read = static_cast<int>(bytes_read_dw);
     #endif
 
-    // Create a vector with the data read
-    return std::vector<uint8_t>(buffer, buffer + bytes_read);
+    buffer_end = bytes_read;
+    return bytes_read;
 }
 
-int Serial::readByte(uint8_t* byte)
+bool Serial::waitForData(std::chrono::milliseconds timeout)
 {
-    // Read byte from serial port linux
-    int bytes_read;
+    // Wait for readiness on linux
     #ifdef __linux__
-    // Read byte from serial port
-    bytes_read = read(descriptor, byte, 1);
-    if (bytes_read > 0) {
-        return 1;
-    }
-    if (bytes_read == 0) {
-        return -1;
-    }
+    struct pollfd pfd;
+    pfd.fd = descriptor;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int result = poll(&pfd, 1, static_cast<int>(timeout.count()));
+    // Interrupted by a signal: let the caller check its state and timeout again
+    if (result < 0) return false;
+    // Any event (data, hang up or error) is handled by the next read
+    return result > 0;
     #endif
-    // Read byte from serial port windows
+    // Sleep polling on windows
     #ifdef _WIN32
-    DWORD bytes_read_dw;
-    if (!ReadFile(descriptor, byte, 1, &bytes_read_dw, NULL)) {
-        //D(char* errmsg = custom_strerror(errno);
-        //    std::cout << "[ERROR] Error reading byte from serial port" << errmsg << "." << std::endl;
-        //    free(errmsg);)
-        return -1;
-    }
-    if (bytes_read_dw == 1) {
-        return 1;
-    }
+    std::this_thread::sleep_for(std::min(timeout, std::chrono::milliseconds(10)));
+    return true;
     #endif
-    
-    return 0;
 }
 
 void Serial::flush()
@@ -319,6 +354,9 @@ void Serial::flush()
 
 void Serial::purge()
 {
+    // Drop bytes already read but not consumed
+    buffer_start = 0;
+    buffer_end = 0;
     // Purge serial port linux
     #ifdef __linux__
     // Purge serial port
@@ -0,0 +1,111 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+#include <iostream>
+#include <cstring>
+#include <errno.h>
+
+#include "shm_ring_writer.hpp"
+#include "pcap_builder.hpp"
+
+ShmRingWriter::ShmRingWriter(std::string name, uint32_t slot_count) : name(name), slot_count(slot_count > 0 ? slot_count : 1)
+{
+}
+
+#ifdef __linux__
+
+ShmRingWriter::~ShmRingWriter()
+{
+    if (!header) return;
+    header->writer_active.store(0, std::memory_order_release);
+    munmap(header, shm_ring_size(slot_count));
+    shm_unlink(name.c_str());
+}
+
+bool ShmRingWriter::open()
+{
+    size_t size = shm_ring_size(slot_count);
+    // A ring left by a previous run is replaced (its readers keep the old mapping)
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    void* address = MAP_FAILED;
+    if (fd >= 0 && ftruncate(fd, (off_t)size) == 0)
+    {
+        address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (fd >= 0) close(fd);
+    if (address == MAP_FAILED)
+    {
+        char* errmsg = custom_strerror(errno);
+        std::cout << "[ERROR] Could not create shared memory ring: " << name << errmsg << "." << std::endl;
+        free(errmsg);
+        return false;
+    }
+
+    // The memory is zeroed by ftruncate, so every slot starts as never written
+    header = (shm_ring_header_s*)address;
+    header->magic = SHM_RING_MAGIC;
+    header->version = SHM_RING_VERSION;
+    header->slot_count = slot_count;
+    header->slot_size = sizeof(shm_ring_slot_s);
+    header->write_sequence.store(0, std::memory_order_relaxed);
+    header->writer_active.store(1, std::memory_order_release);
+    D(std::cout << "[INFO] Publishing packets to shared memory ring: " << name << " (" << std::dec << slot_count << " slots)." << std::endl;)
+    return true;
+}
+
+void ShmRingWriter::publish(const packet_queue_s& packet, std::chrono::microseconds start_time)
+{
+    ti_frame_s frame;
+    if (!header || !PcapBuilder::parse_frame(packet, frame)) return;
+    shm_ring_slot_s* slot = shm_ring_slot(header, sequence);
+
+    // Readers that see an odd sequence, or a different one after reading, discard the slot
+    slot->sequence.store(2 * sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    size_t length = frame.payload_size;
+    if (length > SHM_RING_DATA_MAX_SIZE) length = SHM_RING_DATA_MAX_SIZE;
+    slot->timestamp = start_time.count() + frame.device_timestamp;
+    slot->device_id = (uint16_t)packet.id;
+    slot->length = (uint16_t)length;
+    slot->channel = (uint8_t)packet.channel;
+    slot->mode = packet.mode;
+    slot->rssi = static_cast<int8_t>(frame.rssi);
+    slot->fcs_ok = (frame.status & TI_STATUS_FCS_OK) ? 1 : 0;
+    std::memcpy(slot->data, frame.payload, length);
+
+    slot->sequence.store(2 * sequence + 2, std::memory_order_release);
+    sequence++;
+    header->write_sequence.store(sequence, std::memory_order_release);
+}
+
+#else
+
+ShmRingWriter::~ShmRingWriter()
+{
+}
+
+bool ShmRingWriter::open()
+{
+    std::cout << "[ERROR] Shared memory ring output is only available on Linux." << std::endl;
+    return false;
+}
+
+void ShmRingWriter::publish(const packet_queue_s& packet, std::chrono::microseconds start_time)
+{
+    (void)packet;
+    (void)start_time;
+}
+
+#endif
@@ -20,6 +20,7 @@
 #include "common.hpp"
 #include "device.hpp"
 #include "sniffer.hpp"
+#include "reactor.hpp"
 
 
 Sniffer::Sniffer(std::vector<device_s> devices_info, log_s log_settings)
@@ -95,7 +96,9 @@ void Sniffer::initAllDevices()
 
     // Initialize log settings
     D(std::cout << "[INFO] Configuring output manager." << std::endl;)
-    output_manager.configure(devices.size(), readyDevices);
+    std::vector<uint16_t> interfaces;
+    for (auto& device : devices) interfaces.push_back(device.interface_id);
+    output_manager.configure(devices.size(), readyDevices, interfaces);
 }
 
 void Sniffer::streamAll()
@@ -130,7 +133,7 @@ void Sniffer::streamAll()
         }
     }
 
-    output_manager.is_running = false;
+    output_manager.stop();
     // Join the output manager thread
     if (output_manager_thread.joinable()) {
         output_manager_thread.join();
@@ -171,11 +174,61 @@ void Sniffer::streamAll(std::chrono::seconds duration)
         }
     }
 
-    output_manager.is_running = false;
+    output_manager.stop();
     // Join the output manager thread
     if (output_manager_thread.joinable()) {
         output_manager_thread.join();
     }
 
     D(std::cout << "[INFO] All ready devices finished streaming." << std::endl;)
-}
\ No newline at end of file
+}
+
+void Sniffer::streamAllReactor(std::chrono::seconds duration)
+{
+    #ifndef __linux__
+    std::cout << "[WARNING] Reactor mode is only available on Linux. Using one thread per device." << std::endl;
+    if (duration.count() < 0) streamAll();
+    else streamAll(duration);
+    #else
+    // Replayed capture files have no port to poll
+    if (std::any_of(devices.begin(), devices.end(), [](Device& device) { return device.replay != nullptr; })) {
+        std::cout << "[WARNING] Reactor mode is not available when replaying capture files. Using one thread per device." << std::endl;
+        if (duration.count() < 0) streamAll();
+        else streamAll(duration);
+        return;
+    }
+
+    // Check if all devices are ready. At least one must be to start streaming.
+    if (std::all_of(devices.begin(), devices.end(), [](Device& device) { return !device.is_ready; })) {
+        std::cout << "[ERROR] No devices are ready to start streaming." << std::endl;
+        return;
+    }
+
+    // Start the output manager thread
+    output_manager_thread = std::thread(&OutputManager::run, &output_manager);
+
+    // Start every device and register it in the event loop
+    Reactor reactor(coutMutex);
+    for (auto& device : devices) {
+        if(!device.is_ready) continue;
+        if(!device.start()) continue;
+        reactor.add(&device);
+        D(std::cout << "[INFO] Device ID: " << device.id << " added to the reactor." << std::endl;)
+    }
+
+    reactor.run(duration);
+
+    // Stop the devices that are still connected
+    for (auto& device : devices) {
+        if(device.state == State::STARTED) device.stop();
+    }
+
+    output_manager.stop();
+    // Join the output manager thread
+    if (output_manager_thread.joinable()) {
+        output_manager_thread.join();
+    }
+
+    D(std::cout << "[INFO] All ready devices finished streaming." << std::endl;)
+    #endif
+}
@@ -0,0 +1,215 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <atomic>
+#include <errno.h>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+#endif
+
+#include "spill_file.hpp"
+#include "pcap_builder.hpp"
+#include "common.hpp"
+
+SpillFile::SpillFile(const std::string& path, uint64_t capacity, bool recover) : path(path), capacity(capacity), recover_records(recover)
+{
+}
+
+SpillFile::~SpillFile()
+{
+    if (!header) return;
+    bool keep = recover_records && !empty();
+    if (keep)
+    {
+        D(std::cout << "[INFO] " << std::dec << size() << " bytes of packets were not sent and are kept in: " << path << "." << std::endl;)
+    }
+    else if (!empty())
+    {
+        D(std::cout << "[INFO] " << std::dec << size() << " bytes of packets were not sent and are discarded with: " << path << "." << std::endl;)
+    }
+    close();
+    if (!keep) remove(path.c_str());
+}
+
+bool SpillFile::open()
+{
+    if (header) return true;
+    if (open_failed) return false;
+    open_failed = true;
+
+    uint64_t total = SPILL_FILE_DATA_OFFSET + capacity;
+    uint8_t* map = nullptr;
+    #ifdef _WIN32
+        // A previous file is only opened to recover its records
+        file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, recover_records ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file != INVALID_HANDLE_VALUE)
+        {
+            mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)(total >> 32), (DWORD)total, NULL);
+            if (mapping) map = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)total);
+        }
+    #else
+        // The file is sparse: disk space is only used by the records written. A previous file is only kept to recover its records
+        file = ::open(path.c_str(), O_RDWR | O_CREAT | (recover_records ? 0 : O_TRUNC), 0600);
+        if (file >= 0 && ftruncate(file, (off_t)total) == 0)
+        {
+            void* address = mmap(nullptr, (size_t)total, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+            if (address != MAP_FAILED) map = (uint8_t*)address;
+        }
+    #endif
+    if (!map)
+    {
+        D(char* errmsg = custom_strerror(errno);
+            std::cout << "[ERROR] Could not map spill file: " << path << errmsg << "." << std::endl;
+            free(errmsg);)
+        close();
+        return false;
+    }
+    open_failed = false;
+    header = (spill_header_s*)map;
+    data = map + SPILL_FILE_DATA_OFFSET;
+
+    if (recover_records && recover())
+    {
+        if (!empty())
+        {
+            D(std::cout << "[INFO] Recovered " << std::dec << size() << " bytes of packets not sent from spill file: " << path << "." << std::endl;)
+        }
+    }
+    else
+    {
+        std::memset(header, 0, sizeof(spill_header_s));
+        std::memcpy(header->magic, SPILL_FILE_MAGIC, sizeof(header->magic));
+        header->version = SPILL_FILE_VERSION;
+        header->capacity = capacity;
+        D(std::cout << "[INFO] Spill file created: " << path << "." << std::endl;)
+    }
+    return true;
+}
+
+bool SpillFile::recover()
+{
+    if (std::memcmp(header->magic, SPILL_FILE_MAGIC, sizeof(header->magic)) != 0 || header->version != SPILL_FILE_VERSION) return false;
+    // The positions of the records depend on the capacity, so a file with another capacity is reset
+    if (header->capacity != capacity) return false;
+    uint64_t read_offset = header->read_offset;
+    uint64_t write_offset = header->write_offset;
+    if (read_offset > write_offset || write_offset - read_offset > capacity) return false;
+
+    // Keep the records until the first one that is not valid
+    uint64_t offset = read_offset;
+    while (offset < write_offset)
+    {
+        uint64_t record_offset = skip_padding(offset);
+        uint64_t position = record_offset % capacity;
+        if (record_offset + sizeof(pcaprec_hdr_s) > write_offset) break;
+        pcaprec_hdr_s pcaprec_hdr;
+        std::memcpy(&pcaprec_hdr, data + position, sizeof(pcaprec_hdr_s));
+        if (pcaprec_hdr.incl_len != pcaprec_hdr.orig_len || pcaprec_hdr.incl_len > PCAP_RECORD_MAX_SIZE - PCAP_RECORD_HEADER_SIZE) break;
+        uint64_t record_size = sizeof(pcaprec_hdr_s) + pcaprec_hdr.incl_len;
+        if (record_offset + record_size > write_offset || position + record_size > capacity) break;
+        offset = record_offset + record_size;
+    }
+    header->write_offset = offset;
+    return true;
+}
+
+void SpillFile::close()
+{
+    #ifdef _WIN32
+        if (header) UnmapViewOfFile(header);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+    #else
+        if (header) munmap(header, (size_t)(SPILL_FILE_DATA_OFFSET + capacity));
+        if (file >= 0) ::close(file);
+        file = -1;
+    #endif
+    header = nullptr;
+    data = nullptr;
+}
+
+uint64_t SpillFile::skip_padding(uint64_t offset) const
+{
+    if (offset == header->write_offset) return offset;
+    // The end of the file is padding when it can not hold a record header, or when it is marked as such
+    uint64_t position = offset % capacity;
+    if (capacity - position < sizeof(pcaprec_hdr_s)) return offset + capacity - position;
+    pcaprec_hdr_s pcaprec_hdr;
+    std::memcpy(&pcaprec_hdr, data + position, sizeof(pcaprec_hdr_s));
+    if (pcaprec_hdr.incl_len == SPILL_FILE_PADDING) return offset + capacity - position;
+    return offset;
+}
+
+bool SpillFile::append(const uint8_t* record, size_t size)
+{
+    if (!open()) return false;
+    uint64_t write_offset = header->write_offset;
+    uint64_t position = write_offset % capacity;
+    // A record that does not fit before the end of the file goes to the start
+    uint64_t padding = position + size > capacity ? capacity - position : 0;
+    if (size > capacity || write_offset + padding + size - header->read_offset > capacity) return false;
+    if (padding >= sizeof(pcaprec_hdr_s))
+    {
+        pcaprec_hdr_s pcaprec_hdr = {0, 0, SPILL_FILE_PADDING, SPILL_FILE_PADDING};
+        std::memcpy(data + position, &pcaprec_hdr, sizeof(pcaprec_hdr_s));
+    }
+
+    // The record is complete before the offset includes it
+    std::memcpy(data + (write_offset + padding) % capacity, record, size);
+    std::atomic_signal_fence(std::memory_order_release);
+    header->write_offset = write_offset + padding + size;
+    return true;
+}
+
+const uint8_t* SpillFile::front(size_t max_size, size_t* size) const
+{
+    *size = 0;
+    if (empty()) return nullptr;
+    uint64_t read_offset = skip_padding(header->read_offset);
+    uint64_t position = read_offset % capacity;
+    // Only the records before the end of the file are contiguous
+    uint64_t available = header->write_offset - read_offset;
+    if (available > capacity - position) available = capacity - position;
+    if (available < max_size) max_size = (size_t)available;
+
+    // Return only complete records (the padding marker is never a complete record)
+    const uint8_t* records = data + position;
+    size_t complete = 0;
+    while (complete + sizeof(pcaprec_hdr_s) <= max_size)
+    {
+        pcaprec_hdr_s pcaprec_hdr;
+        std::memcpy(&pcaprec_hdr, records + complete, sizeof(pcaprec_hdr_s));
+        uint64_t record_size = sizeof(pcaprec_hdr_s) + (uint64_t)pcaprec_hdr.incl_len;
+        if (complete + record_size > max_size) break;
+        complete += (size_t)record_size;
+    }
+    *size = complete;
+    return records;
+}
+
+void SpillFile::consume(size_t size)
+{
+    if (!header || empty()) return;
+    // The size counts from the record returned by front, after the padding
+    uint64_t read_offset = skip_padding(header->read_offset) + size;
+    if (read_offset > header->write_offset) read_offset = header->write_offset;
+    header->read_offset = read_offset;
+}
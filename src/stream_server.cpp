@@ -0,0 +1,388 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <errno.h>
+
+#ifdef __linux__
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <netdb.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+#endif
+
+#include "stream_server.hpp"
+#include "pcap_builder.hpp"
+
+StreamServer::StreamServer(StreamTransport transport, const stream_entry_s& settings)
+: transport(transport), address(settings.address), drop_slow_clients(settings.slow_client == "drop"), no_delay(settings.no_delay),
+  batch_size((uint64_t)std::max(settings.batch_size_kb, 0) * 1024), batch_delay(std::max(settings.batch_delay_ms, 0)),
+  ring(std::max((size_t)std::max(settings.buffer_size_kb, 0) * 1024, (size_t)STREAM_RING_MIN_SIZE)), record(PCAP_RECORD_MAX_SIZE)
+{
+    // A client cannot lag more than the ring
+    client_limit = (uint64_t)std::max(settings.client_queue_kb, 0) * 1024;
+    if (client_limit == 0 || client_limit > ring.size()) client_limit = ring.size();
+}
+
+void StreamServer::ring_read(uint64_t position, uint8_t* data, size_t size) const
+{
+    size_t offset = (size_t)(position % ring.size());
+    size_t first = std::min(size, ring.size() - offset);
+    std::memcpy(data, ring.data() + offset, first);
+    std::memcpy(data + first, ring.data(), size - first);
+}
+
+void StreamServer::ring_write(uint64_t position, const uint8_t* data, size_t size)
+{
+    size_t offset = (size_t)(position % ring.size());
+    size_t first = std::min(size, ring.size() - offset);
+    std::memcpy(ring.data() + offset, data, first);
+    std::memcpy(ring.data(), data + first, size - first);
+}
+
+size_t StreamServer::record_size(uint64_t position) const
+{
+    pcaprec_hdr_s pcaprec_hdr;
+    ring_read(position, (uint8_t*)&pcaprec_hdr, sizeof(pcaprec_hdr_s));
+    return sizeof(pcaprec_hdr_s) + pcaprec_hdr.incl_len;
+}
+
+void StreamServer::add_packet(const FrameRef& frame, bool isTransportKey)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Capture time set by the output manager, shifted to local time like the legacy pcap files
+    auto start_time_micros = std::chrono::microseconds(frame->clock_offset) + std::chrono::seconds(TIMEZONE);
+    size_t size = PcapBuilder::write_record(*frame, start_time_micros, record.data(), record.size());
+    if (size == 0) return;
+    if (isTransportKey) key_records.insert(key_records.end(), record.data(), record.data() + size);
+    if (client_count == 0) return;
+
+    // Overwrite the oldest records (the clients that did not send them yet are slow)
+    while (head + size - tail > ring.size()) tail += record_size(tail);
+    ring_write(head, record.data(), size);
+    head += size;
+
+    #ifdef __linux__
+        // A single wake up byte is pending at a time, so adding a record is usually only a copy
+        if (!wake_pending.exchange(true))
+        {
+            char byte = 1;
+            if (::write(wake_fds[1], &byte, 1) < 0) wake_pending = false;
+        }
+    #endif
+}
+
+stream_stats_s StreamServer::get_stats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return stats;
+}
+
+#ifdef __linux__
+
+StreamServer::~StreamServer()
+{
+    for (auto& client : clients) ::close(client.fd);
+    if (listen_fd >= 0)
+    {
+        ::close(listen_fd);
+        if (transport == StreamTransport::UNIX) unlink(address.c_str());
+    }
+    if (wake_fds[0] >= 0) ::close(wake_fds[0]);
+    if (wake_fds[1] >= 0) ::close(wake_fds[1]);
+}
+
+bool StreamServer::listen_unix()
+{
+    struct sockaddr_un socket_address;
+    std::memset(&socket_address, 0, sizeof(socket_address));
+    socket_address.sun_family = AF_UNIX;
+    if (address.size() >= sizeof(socket_address.sun_path))
+    {
+        std::cout << "[ERROR] Socket path is too long: " << address << "." << std::endl;
+        return false;
+    }
+    std::strcpy(socket_address.sun_path, address.c_str());
+
+    // A socket left by a previous run is replaced
+    unlink(address.c_str());
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    return listen_fd >= 0 && bind(listen_fd, (struct sockaddr*)&socket_address, sizeof(socket_address)) == 0 && listen(listen_fd, 16) == 0;
+}
+
+bool StreamServer::listen_tcp()
+{
+    // host:port, with an IPv6 host in brackets ([::1]:57012) so its colons are not taken for the port separator
+    std::string host;
+    std::string port;
+    size_t separator = std::string::npos;
+    if (!address.empty() && address.front() == '[')
+    {
+        size_t close = address.find("]:");
+        if (close != std::string::npos)
+        {
+            host = address.substr(1, close - 1);
+            separator = close + 1;
+        }
+    }
+    else if (address.find(':') == address.rfind(':'))
+    {
+        separator = address.find(':');
+        if (separator != std::string::npos) host = address.substr(0, separator);
+    }
+    if (separator == std::string::npos || separator + 1 >= address.size())
+    {
+        std::cout << "[ERROR] TCP address must be host:port, or [address]:port for IPv6: " << address << "." << std::endl;
+        return false;
+    }
+    port = address.substr(separator + 1);
+
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    struct addrinfo* addresses = nullptr;
+    int result = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &addresses);
+    if (result != 0)
+    {
+        std::cout << "[ERROR] Could not resolve TCP address: " << address << " (" << gai_strerror(result) << ")." << std::endl;
+        return false;
+    }
+
+    for (struct addrinfo* candidate = addresses; candidate; candidate = candidate->ai_next)
+    {
+        listen_fd = socket(candidate->ai_family, candidate->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, candidate->ai_protocol);
+        if (listen_fd < 0) continue;
+        int enable = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        if (bind(listen_fd, candidate->ai_addr, candidate->ai_addrlen) == 0 && listen(listen_fd, 16) == 0) break;
+        ::close(listen_fd);
+        listen_fd = -1;
+    }
+    freeaddrinfo(addresses);
+    return listen_fd >= 0;
+}
+
+bool StreamServer::start()
+{
+    if (pipe2(wake_fds, O_NONBLOCK | O_CLOEXEC) < 0)
+    {
+        D(char* errmsg = custom_strerror(errno);
+            std::cout << "[ERROR] Could not create the socket server wake up pipe" << errmsg << "." << std::endl;
+            free(errmsg);)
+        return false;
+    }
+
+    bool listening = transport == StreamTransport::TCP ? listen_tcp() : listen_unix();
+    if (!listening)
+    {
+        char* errmsg = custom_strerror(errno);
+        std::cout << "[ERROR] Could not listen on socket: " << address << errmsg << "." << std::endl;
+        free(errmsg);
+        if (listen_fd >= 0) ::close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+
+    D(std::cout << "[INFO] Waiting for stream clients on: " << address << "." << std::endl;)
+    is_running = true;
+    return true;
+}
+
+void StreamServer::stop()
+{
+    is_running = false;
+    char byte = 1;
+    if (wake_fds[1] >= 0 && ::write(wake_fds[1], &byte, 1) < 0) { /* The run method also wakes up periodically */ }
+}
+
+void StreamServer::accept_clients()
+{
+    while (true)
+    {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+
+        // Small records are sent as soon as possible, batching is done here
+        if (transport == StreamTransport::TCP && no_delay)
+        {
+            int enable = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        }
+
+        stream_client_s client;
+        client.fd = fd;
+        client.last_send = std::chrono::steady_clock::now();
+        client.pending = PcapBuilder::get_global_header();
+        client.pending_sent = 0;
+        {
+            // The client starts with the key packets and the next record
+            std::lock_guard<std::mutex> lock(m_mutex);
+            client.pending.insert(client.pending.end(), key_records.begin(), key_records.end());
+            client.cursor = head;
+            client_count++;
+            stats.clients++;
+        }
+        clients.push_back(std::move(client));
+        D(std::cout << "[INFO] Stream client connected on: " << address << " (" << std::dec << clients.size() << " clients)." << std::endl;)
+    }
+}
+
+bool StreamServer::flush_client(stream_client_s& client)
+{
+    auto now = std::chrono::steady_clock::now();
+    while (true)
+    {
+        // The bytes of the client are sent without the lock, so a send never delays the capture
+        while (client.pending_sent < client.pending.size())
+        {
+            ssize_t sent = send(client.fd, client.pending.data() + client.pending_sent, client.pending.size() - client.pending_sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (sent < 0) return errno == EAGAIN || errno == EWOULDBLOCK;
+            client.pending_sent += (size_t)sent;
+        }
+        client.pending.clear();
+        client.pending_sent = 0;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // The records the client did not send were overwritten, or are over its queue limit
+        if (client.cursor < tail || head - client.cursor > client_limit)
+        {
+            if (drop_slow_clients)
+            {
+                stats.dropped_clients++;
+                std::cout << "[WARNING] Stream client on: " << address << " is too slow. Disconnecting it." << std::endl;
+                return false;
+            }
+            uint64_t oldest = std::max(client.cursor, tail);
+            while (head - oldest > client_limit) oldest += record_size(oldest);
+            stats.skipped_bytes += oldest - client.cursor;
+            D(std::cout << "[WARNING] Stream client on: " << address << " is too slow. Skipping " << std::dec << oldest - client.cursor << " bytes of packets." << std::endl;)
+            client.cursor = oldest;
+        }
+
+        if (client.cursor == head || !batch_ready(client, now)) return true;
+        client.last_send = now;
+
+        // Copy whole records (at least one, up to STREAM_MAX_SEND_SIZE), so the cursor is always at a record
+        uint64_t end = client.cursor + record_size(client.cursor);
+        while (end < head && end + record_size(end) - client.cursor <= STREAM_MAX_SEND_SIZE) end += record_size(end);
+        client.pending.resize((size_t)(end - client.cursor));
+        ring_read(client.cursor, client.pending.data(), client.pending.size());
+        client.cursor = end;
+    }
+}
+
+bool StreamServer::batch_ready(const stream_client_s& client, std::chrono::steady_clock::time_point now, std::chrono::milliseconds* wait) const
+{
+    if (batch_size == 0 || client.pending_sent < client.pending.size() || head - client.cursor >= batch_size) return true;
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - client.last_send);
+    if (elapsed >= batch_delay) return true;
+    if (wait && client.cursor < head) *wait = std::min(*wait, batch_delay - elapsed);
+    return false;
+}
+
+void StreamServer::run()
+{
+    std::vector<struct pollfd> fds;
+    while (is_running)
+    {
+        // The timeout keeps checking is_running, and ends the batch delays
+        std::chrono::milliseconds timeout(100);
+        auto now = std::chrono::steady_clock::now();
+        fds.clear();
+        fds.push_back({wake_fds[0], POLLIN, 0});
+        fds.push_back({listen_fd, POLLIN, 0});
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (const auto& client : clients)
+            {
+                bool ready = has_pending(client) && batch_ready(client, now, &timeout);
+                fds.push_back({client.fd, (short)(POLLIN | (ready ? POLLOUT : 0)), 0});
+            }
+        }
+
+        if (poll(fds.data(), fds.size(), (int)timeout.count()) < 0 && errno != EINTR) break;
+
+        if (fds[0].revents & POLLIN)
+        {
+            char buffer[64];
+            while (::read(wake_fds[0], buffer, sizeof(buffer)) > 0) {}
+            wake_pending = false;
+        }
+
+        // Send to every client, closing the ones that disconnected (clients only send to tell they closed)
+        size_t kept = 0;
+        for (size_t i = 0; i < clients.size(); i++)
+        {
+            stream_client_s& client = clients[i];
+            bool connected = !(fds[i + 2].revents & (POLLHUP | POLLERR));
+            if (connected && (fds[i + 2].revents & POLLIN))
+            {
+                char buffer[256];
+                ssize_t received = recv(client.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+                connected = received > 0 || (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+            }
+            if (connected) connected = flush_client(client);
+            if (!connected)
+            {
+                ::close(client.fd);
+                std::lock_guard<std::mutex> lock(m_mutex);
+                client_count--;
+                D(std::cout << "[INFO] Stream client disconnected from: " << address << "." << std::endl;)
+                continue;
+            }
+            if (kept != i) clients[kept] = std::move(client);
+            kept++;
+        }
+        clients.resize(kept);
+
+        if (fds[1].revents & POLLIN) accept_clients();
+    }
+
+    // Send what is left in the batches (without waiting for the clients)
+    batch_size = 0;
+    for (auto& client : clients) flush_client(client);
+}
+
+#else
+
+StreamServer::~StreamServer()
+{
+}
+
+bool StreamServer::start()
+{
+    std::cout << "[ERROR] Socket streaming is only available on Linux." << std::endl;
+    return false;
+}
+
+void StreamServer::stop()
+{
+    is_running = false;
+}
+
+void StreamServer::run()
+{
+}
+
+#endif
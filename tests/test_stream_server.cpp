@@ -0,0 +1,300 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////
+// Company:  Aceno Digital Tecnologia em Sistemas Ltda.
+// Homepage: http://www.aceno.com
+// Project:  Tuxniffer
+// Version:  1.1.3
+// Date:     2025
+//
+// Copyright (C) 2002-2025 Aceno Tecnologia.
+// All rights reserved.
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstring>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "stream_server.hpp"
+#include "frame_pool.hpp"
+#include "pcap_builder.hpp"
+
+static int failures = 0;
+
+#define CHECK(condition) do { if (!(condition)) { std::cout << "[FAIL] " << __FILE__ << ":" << std::dec << __LINE__ << ": " << #condition << std::endl; failures++; } } while (0)
+
+/**
+ * @brief Gets a free TCP port of the loopback interface.
+ */
+static int free_port()
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    int port = -1;
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) == 0 && getsockname(fd, (struct sockaddr*)&address, &length) == 0) port = ntohs(address.sin_port);
+    close(fd);
+    return port;
+}
+
+/**
+ * @brief Connects to a port of the IPv4 or IPv6 loopback interface.
+ */
+static int connect_loopback(int port, bool ipv6)
+{
+    int fd = socket(ipv6 ? AF_INET6 : AF_INET, SOCK_STREAM, 0);
+    int result;
+    if (ipv6)
+    {
+        struct sockaddr_in6 address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin6_family = AF_INET6;
+        address.sin6_addr = in6addr_loopback;
+        address.sin6_port = htons((uint16_t)port);
+        result = connect(fd, (struct sockaddr*)&address, sizeof(address));
+    }
+    else
+    {
+        struct sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons((uint16_t)port);
+        result = connect(fd, (struct sockaddr*)&address, sizeof(address));
+    }
+    if (result != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Reads from a socket until it got size bytes or the timeout expired.
+ * 
+ * @return size_t Number of bytes read.
+ */
+static size_t read_bytes(int fd, std::vector<uint8_t>& data, size_t size, std::chrono::milliseconds timeout)
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    size_t received = 0;
+    data.resize(size);
+    while (received < size)
+    {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) break;
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, (int)left.count()) <= 0) break;
+        ssize_t result = recv(fd, data.data() + received, size - received, 0);
+        if (result <= 0) break;
+        received += (size_t)result;
+    }
+    data.resize(received);
+    return received;
+}
+
+/**
+ * @brief Takes a frame of the pool holding a TI data frame with a payload of payload_size bytes, all equal to sequence.
+ */
+static FrameRef make_frame(FramePool& pool, uint8_t sequence, size_t payload_size)
+{
+    uint8_t data[FRAME_MAX_SIZE];
+    size_t length = payload_size + TI_FRAME_OVERHEAD;
+    data[0] = 0x40;
+    data[1] = 0x53;
+    data[2] = 0xC0;
+    data[3] = (uint8_t)((payload_size + 9) & 0xFF);
+    data[4] = (uint8_t)((payload_size + 9) >> 8);
+    uint64_t device_time = (uint64_t)sequence * 1000;
+    for (size_t i = 0; i < 6; i++) data[5 + i] = (uint8_t)(device_time >> (i * 8));
+    data[11] = 0x00;
+    std::memset(data + 12, sequence, payload_size);
+    data[12 + payload_size] = 0xD0;
+    data[13 + payload_size] = TI_STATUS_FCS_OK;
+    data[14 + payload_size] = 0x40;
+    data[15 + payload_size] = 0x45;
+
+    FrameRef frame = pool.acquire();
+    frame->id = 0;
+    frame->interface_id = 0;
+    frame->channel = 20;
+    frame->mode = 20;
+    frame->clock_offset = 0;
+    frame->set_packet(data, length);
+    return frame;
+}
+
+/**
+ * @brief Size of the pcap record of a payload in the stream.
+ */
+static size_t record_size(size_t payload_size)
+{
+    return PCAP_RECORD_HEADER_SIZE + payload_size;
+}
+
+/**
+ * @brief Starts a TCP stream server and runs it in a thread.
+ */
+static bool start_server(StreamServer& server, std::thread& thread)
+{
+    if (!server.start()) return false;
+    thread = std::thread(&StreamServer::run, &server);
+    return true;
+}
+
+/**
+ * @brief Reads the pcap global header, which also tells that the server accepted the client.
+ */
+static bool read_global_header(int fd)
+{
+    std::vector<uint8_t> data;
+    if (read_bytes(fd, data, sizeof(pcap_hdr_s), std::chrono::milliseconds(2000)) != sizeof(pcap_hdr_s)) return false;
+    pcap_hdr_s pcap_hdr;
+    std::memcpy(&pcap_hdr, data.data(), sizeof(pcap_hdr));
+    return pcap_hdr.magic_number == 0xA1B2C3D4;
+}
+
+/**
+ * @brief Every packet reaches the client as one complete pcap record, in order.
+ */
+static void test_framing()
+{
+    FramePool pool;
+    int port = free_port();
+    StreamServer server(StreamTransport::TCP, {true, "127.0.0.1:" + std::to_string(port), 256, "skip", 0, true, 0, 0});
+    std::thread thread;
+    CHECK(start_server(server, thread));
+    if (!thread.joinable()) return;
+
+    int fd = connect_loopback(port, false);
+    CHECK(fd >= 0);
+    CHECK(fd >= 0 && read_global_header(fd));
+
+    // Payloads of every size, so records end at every alignment
+    const size_t packets = 120;
+    size_t expected = 0;
+    for (size_t i = 0; i < packets; i++)
+    {
+        server.add_packet(make_frame(pool, (uint8_t)i, i + 1));
+        expected += record_size(i + 1);
+    }
+
+    std::vector<uint8_t> data;
+    CHECK(fd >= 0 && read_bytes(fd, data, expected, std::chrono::milliseconds(2000)) == expected);
+    size_t offset = 0;
+    for (size_t i = 0; i < packets && offset + sizeof(pcaprec_hdr_s) <= data.size(); i++)
+    {
+        pcaprec_hdr_s pcaprec_hdr;
+        std::memcpy(&pcaprec_hdr, data.data() + offset, sizeof(pcaprec_hdr));
+        CHECK(pcaprec_hdr.incl_len == PCAP_ENCAPSULATION_SIZE + i + 1);
+        CHECK(pcaprec_hdr.orig_len == pcaprec_hdr.incl_len);
+        CHECK(offset + sizeof(pcaprec_hdr) + pcaprec_hdr.incl_len <= data.size());
+        if (offset + sizeof(pcaprec_hdr) + pcaprec_hdr.incl_len > data.size()) break;
+        // The payload follows the encapsulation
+        const uint8_t* payload = data.data() + offset + PCAP_RECORD_HEADER_SIZE;
+        CHECK(payload[0] == (uint8_t)i && payload[i] == (uint8_t)i);
+        offset += sizeof(pcaprec_hdr) + pcaprec_hdr.incl_len;
+    }
+    CHECK(offset == expected);
+
+    if (fd >= 0) close(fd);
+    server.stop();
+    thread.join();
+}
+
+/**
+ * @brief Records wait for a batch size of them, or for the batch delay.
+ */
+static void test_batching()
+{
+    FramePool pool;
+    int port = free_port();
+    StreamServer server(StreamTransport::TCP, {true, "127.0.0.1:" + std::to_string(port), 256, "skip", 0, true, 1, 500});
+    std::thread thread;
+    CHECK(start_server(server, thread));
+    if (!thread.joinable()) return;
+
+    int fd = connect_loopback(port, false);
+    CHECK(fd >= 0);
+    CHECK(fd >= 0 && read_global_header(fd));
+
+    // A single record is held until the delay expires
+    std::vector<uint8_t> data;
+    auto added = std::chrono::steady_clock::now();
+    server.add_packet(make_frame(pool, 1, 20));
+    CHECK(read_bytes(fd, data, record_size(20), std::chrono::milliseconds(200)) == 0);
+    CHECK(read_bytes(fd, data, record_size(20), std::chrono::milliseconds(2000)) == record_size(20));
+    CHECK(std::chrono::steady_clock::now() - added >= std::chrono::milliseconds(400));
+
+    // A full batch (1 KiB) is sent right away
+    const size_t packets = 20;
+    for (size_t i = 0; i < packets; i++) server.add_packet(make_frame(pool, (uint8_t)i, 60));
+    CHECK(read_bytes(fd, data, packets * record_size(60), std::chrono::milliseconds(250)) == packets * record_size(60));
+
+    if (fd >= 0) close(fd);
+    server.stop();
+    thread.join();
+}
+
+/**
+ * @brief IPv6 hosts must be in brackets, and are served when they are.
+ */
+static void test_addresses()
+{
+    int port = free_port();
+    StreamServer unbracketed(StreamTransport::TCP, {true, "::1:" + std::to_string(port), 256, "skip", 0, true, 0, 0});
+    CHECK(!unbracketed.start());
+    StreamServer no_port(StreamTransport::TCP, {true, "127.0.0.1", 256, "skip", 0, true, 0, 0});
+    CHECK(!no_port.start());
+
+    // The IPv6 loopback may be disabled in the test environment
+    int probe = socket(AF_INET6, SOCK_STREAM, 0);
+    struct sockaddr_in6 address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin6_family = AF_INET6;
+    address.sin6_addr = in6addr_loopback;
+    bool ipv6 = probe >= 0 && bind(probe, (struct sockaddr*)&address, sizeof(address)) == 0;
+    if (probe >= 0) close(probe);
+    if (!ipv6)
+    {
+        std::cout << "[INFO] IPv6 loopback not available, skipping the bracketed address test." << std::endl;
+        return;
+    }
+
+    StreamServer server(StreamTransport::TCP, {true, "[::1]:" + std::to_string(port), 256, "skip", 0, true, 0, 0});
+    std::thread thread;
+    CHECK(start_server(server, thread));
+    if (!thread.joinable()) return;
+    int fd = connect_loopback(port, true);
+    CHECK(fd >= 0);
+    CHECK(fd >= 0 && read_global_header(fd));
+    if (fd >= 0) close(fd);
+    server.stop();
+    thread.join();
+}
+
+int main()
+{
+    test_framing();
+    test_batching();
+    test_addresses();
+
+    if (failures > 0)
+    {
+        std::cout << "[ERROR] " << std::dec << failures << " checks failed." << std::endl;
+        return 1;
+    }
+    std::cout << "[INFO] Stream server tests passed." << std::endl;
+    return 0;
+}